@@ -31,6 +31,7 @@
 #include <unordered_map>
 #include <queue>
 #include <unordered_set>
+#include <chrono>
 
 
 /******************************
@@ -83,6 +84,18 @@ const int CAPACITOR = 5;
  ******************************/
 enum ControlObjective {MINIMIZE_L2_NORM};
 
+// method used in the inner loop of the solver
+enum InnerLoopMethod {PROJECTED_GRADIENT, ACCELERATED_PROJECTED_GRADIENT, BARZILAI_BORWEIN, ADMM_TEMPORAL_DECOMPOSITION, QUASI_NEWTON, INTERIOR_POINT};
+
+// quantities the line search needs at a tentative point, computed in one pass
+struct ControlEvaluation {
+    bool _voltageViolation;                 // true if any voltage is out of range
+    double _objectiveValue;                 // undefined if _voltageViolation
+    double _updateSize;                     // maximum power update size over buses
+    double _expectedObjectiveValueChange;   // first order estimate of objective change
+    ControlEvaluation() : _voltageViolation(false), _objectiveValue(0.0), _updateSize(0.0), _expectedObjectiveValueChange(0.0) {}
+};
+
 
 /******************************
  used in event queue
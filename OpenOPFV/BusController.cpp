@@ -22,6 +22,7 @@
 #include "LineController.h"
 #include "LoadController.h"
 #include "Load.h"
+#include "VoltageViolationCollector.h"
 
 /******************************
  basic functions
@@ -54,8 +55,12 @@ _oldAggregateLoads(numberOfSlots, bus->aggregateLoad()) {
         _beta[phaseId] = complex_type(cos(angle), sin(angle));
     }
     _sumDown.assign(numberOfSlots, ColumnVector<double>(phase));
+    _sumDownLoad.assign(numberOfSlots, ColumnVector<double>(phase));
+    _sumDownLower.assign(numberOfSlots, ColumnVector<double>(phase));
+    _sumDownUpper.assign(numberOfSlots, ColumnVector<double>(phase));
     _sumUp.assign(numberOfSlots, ColumnVector<complex_type>(phase));
     _gradient.assign(numberOfSlots, ColumnVector<complex_type>(phase));
+    _oldGradient.assign(numberOfSlots, ColumnVector<complex_type>(phase));
 }
 
 // copy constructor
@@ -73,8 +78,12 @@ _voltageMin(controller._voltageMin),
 _voltageMax(controller._voltageMax),
 _beta(controller._beta),
 _sumDown(controller._sumDown),
+_sumDownLoad(controller._sumDownLoad),
+_sumDownLower(controller._sumDownLower),
+_sumDownUpper(controller._sumDownUpper),
 _sumUp(controller._sumUp),
 _gradient(controller._gradient),
+_oldGradient(controller._oldGradient),
 _oldAggregateLoads(controller._oldAggregateLoads) {
 }
 
@@ -89,8 +98,12 @@ void BusController::clear() {
     _loadArray.clear();
     _phaseIndicesInParentBus.clear();
     _sumDown.clear();
+    _sumDownLoad.clear();
+    _sumDownLower.clear();
+    _sumDownUpper.clear();
     _sumUp.clear();
     _gradient.clear();
+    _oldGradient.clear();
     _oldAggregateLoads.clear();
 }
 
@@ -118,8 +131,12 @@ void BusController::operator=(const BusController &controller) {
     
     _beta = controller._beta;
     _sumDown = controller._sumDown;
+    _sumDownLoad = controller._sumDownLoad;
+    _sumDownLower = controller._sumDownLower;
+    _sumDownUpper = controller._sumDownUpper;
     _sumUp = controller._sumUp;
     _gradient = controller._gradient;
+    _oldGradient = controller._oldGradient;
     _oldAggregateLoads = controller._oldAggregateLoads;
 }
 
@@ -235,6 +252,45 @@ double BusController::computeCurrentOnFromLineOverHorizon() {
     return updateSize;
 }
 
+// compute current by backward sweep, and accumulate the parts of sumDown on the way
+double BusController::computeCurrentAndSumDownPartsAtTime(int timeSlotId) {
+    double updateSize = computeCurrentOnFromLineAtTime(timeSlotId);
+    
+    // local contributions, with the voltages of the previous forward sweep
+    ColumnVector<complex_type> result = _aggregateLoads[timeSlotId]._admittance * _beta;
+    for (int i = 0; i < result.size(); i ++) {
+        _sumDownLoad[timeSlotId][i] = ( result[i] * std::conj(_beta[i]) ).real();
+        if (_hasVoltageConstraint) {
+            _sumDownLower[timeSlotId][i] = 1.0 / ( std::norm(_voltages[timeSlotId][i]) - _voltageMin * _voltageMin );
+            _sumDownUpper[timeSlotId][i] = 1.0 / (_voltageMax * _voltageMax - std::norm(_voltages[timeSlotId][i]));
+        }
+        else {
+            _sumDownLower[timeSlotId][i] = 0.0;
+            _sumDownUpper[timeSlotId][i] = 0.0;
+        }
+    }
+    
+    // add contributions from downstream buses, whose parts were accumulated earlier in this sweep
+    for (int lineId = 0; lineId < _toLineArray.size(); lineId ++) {
+        BusController *toBus = _toLineArray[lineId]->_toBus;
+        _sumDownLoad[timeSlotId].addToIndices(toBus->_sumDownLoad[timeSlotId], toBus->_phaseIndicesInParentBus);
+        _sumDownLower[timeSlotId].addToIndices(toBus->_sumDownLower[timeSlotId], toBus->_phaseIndicesInParentBus);
+        _sumDownUpper[timeSlotId].addToIndices(toBus->_sumDownUpper[timeSlotId], toBus->_phaseIndicesInParentBus);
+    }
+    
+    return updateSize;
+}
+
+double BusController::computeCurrentAndSumDownPartsOverHorizon() {
+    double updateSize = 0.0;
+    for (int timeSlotId = 0; timeSlotId < _aggregateLoads.size(); timeSlotId ++) {
+        double thisUpdateSize = computeCurrentAndSumDownPartsAtTime(timeSlotId);
+        if (updateSize < thisUpdateSize)
+            updateSize = thisUpdateSize;
+    }
+    return updateSize;
+}
+
 // compute voltage by forward sweep
 double BusController::computeVoltageOnSelfAtTime(int timeSlotId) {
     // compute voltage according to Kirchoff's law
@@ -292,6 +348,22 @@ void BusController::computeSumDownOverHorizon(double muLower, double muUpper, co
     }
 }
 
+// compute sumDown from the parts accumulated in the power flow sweep
+// every phase of the subtree maps to the same root phase, so price factors out of the subtree sum
+void BusController::computeSumDownFromPartsAtTime(double muLower, double muUpper, const vector<double> &price, const int &timeSlotId) {
+    for (int i = 0; i < _sumDown[timeSlotId].size(); i ++) {
+        _sumDown[timeSlotId][i] = _sumDownLoad[timeSlotId][i] * price[i]
+                                - _sumDownLower[timeSlotId][i] * muLower
+                                + _sumDownUpper[timeSlotId][i] * muUpper;
+    }
+}
+
+void BusController::computeSumDownFromPartsOverHorizon(double muLower, double muUpper, const vector<double> &price) {
+    for (int timeSlotId = 0; timeSlotId < _sumDown.size(); timeSlotId ++) {
+        computeSumDownFromPartsAtTime(muLower, muUpper, price, timeSlotId);
+    }
+}
+
 // compute sumUp
 void BusController::computeSumUpAtTime(const int &timeSlotId) {
     // compute local contribution
@@ -397,49 +469,114 @@ void BusController::resetPowerOverHorizon(unordered_set<LoadType> &enabledInCont
     // _oldAggregateLoads = _aggregateLoads;
 }
 
-// check if there is voltage violation downstream
-bool BusController::downstreamVoltageViolationAtTime(const int &timeSlotId) const {
-    // check local bus
-    if (_hasVoltageConstraint) {
-        for (int phaseId = 0; phaseId < _phaseIndicesInParentBus.size(); phaseId ++) {
-            double voltageMagnitude = std::sqrt( std::norm( _voltages[timeSlotId]._data[phaseId] ) );
-            if (voltageMagnitude < _voltageMin ||
-                voltageMagnitude > _voltageMax) {
-                std::cout << "bus " << _bus->name() << " (" << _bus->phase()[phaseId] << ")\n";
-                std::cout << "\tvoltage = " << voltageMagnitude << " at time slot with index " << timeSlotId << '\n';
-                return true;
-            }
-        }
+// extrapolate power consumption of loads by momentum
+void BusController::extrapolatePowerAtTime(const double &momentum, const int &timeSlotId, unordered_set<LoadType> &enabledInControl) {
+    for (int loadId = 0; loadId < _loadArray.size(); loadId ++) {
+        LoadController *load = _loadArray[loadId];
+        if (enabledInControl.find(load->_load->type()) != enabledInControl.end())
+            load->extrapolatePowerAtTime(momentum, timeSlotId);
+    }
+    computeAggregateLoadOnSelfAtTime(timeSlotId);
+    _oldAggregateLoads[timeSlotId] = _aggregateLoads[timeSlotId];
+}
+
+void BusController::extrapolatePowerOverHorizon(const double &momentum, unordered_set<LoadType> &enabledInControl) {
+    for (int loadId = 0; loadId < _loadArray.size(); loadId ++) {
+        LoadController *load = _loadArray[loadId];
+        if (enabledInControl.find(load->_load->type()) != enabledInControl.end())
+            load->extrapolatePowerOverHorizon(momentum);
     }
+    computeAggregateLoadOnSelfOverHorizon();
+    _oldAggregateLoads = _aggregateLoads;
+}
+
+// move power consumption of loads part of the way from their last accepted iterate
+void BusController::interpolatePowerAtTime(const double &weight, const int &timeSlotId, unordered_set<LoadType> &enabledInControl) {
+    for (int loadId = 0; loadId < _loadArray.size(); loadId ++) {
+        LoadController *load = _loadArray[loadId];
+        if (enabledInControl.find(load->_load->type()) != enabledInControl.end())
+            load->interpolatePowerAtTime(weight, timeSlotId);
+    }
+    computeAggregateLoadOnSelfAtTime(timeSlotId);
+}
+
+// set power consumption of loads to their last accepted iterate
+void BusController::rollBackPowerOverHorizon(unordered_set<LoadType> &enabledInControl) {
+    for (int loadId = 0; loadId < _loadArray.size(); loadId ++) {
+        LoadController *load = _loadArray[loadId];
+        if (enabledInControl.find(load->_load->type()) != enabledInControl.end())
+            load->rollBackPowerOverHorizon();
+    }
+    computeAggregateLoadOnSelfOverHorizon();
+    _oldAggregateLoads = _aggregateLoads;
+}
+
+// add inner products of the last step of loads
+void BusController::addStepProductsOverHorizon(double &stepSquare, double &stepDotGradientChange, unordered_set<LoadType> &enabledInControl) const {
+    for (int loadId = 0; loadId < _loadArray.size(); loadId ++) {
+        LoadController *load = _loadArray[loadId];
+        if (enabledInControl.find(load->_load->type()) != enabledInControl.end())
+            load->addStepProductsOverHorizon(stepSquare, stepDotGradientChange);
+    }
+}
+
+// check if there is voltage violation on this bus
+bool BusController::voltageViolationAtTime(const int &timeSlotId, VoltageViolationCollector *collector) const {
+    if (! _hasVoltageConstraint)
+        return false;
     
-    // check downstream buses
-    for (int lineId = 0; lineId < _toLineArray.size(); lineId ++) {
-        if (_toLineArray[lineId]->_toBus->downstreamVoltageViolationAtTime(timeSlotId))
+    for (int phaseId = 0; phaseId < _phaseIndicesInParentBus.size(); phaseId ++) {
+        double voltageMagnitude = std::sqrt( std::norm( _voltages[timeSlotId]._data[phaseId] ) );
+        if (voltageMagnitude < _voltageMin ||
+            voltageMagnitude > _voltageMax) {
+            if (collector != NULL)
+                collector->record(this, phaseId, timeSlotId, voltageMagnitude, _voltageMin, _voltageMax);
             return true;
+        }
     }
-    
     return false;
 }
 
-bool BusController::downstreamVoltageViolationOverHorizon() const {
-    for (int timeSlotId = 0; timeSlotId < _aggregateLoads.size(); timeSlotId ++) {
-        if (downstreamVoltageViolationAtTime(timeSlotId) == true)
+bool BusController::voltageViolationOverHorizon(VoltageViolationCollector *collector) const {
+    if (! _hasVoltageConstraint)
+        return false;
+    
+    for (int timeSlotId = 0; timeSlotId < _voltages.size(); timeSlotId ++) {
+        if (voltageViolationAtTime(timeSlotId, collector))
             return true;
     }
     return false;
 }
 
-// compute aggregated downstream objective value
-// store result in _objectiveValueDownstream
-double BusController::downstreamObjectiveValueAtTime(const double &muLower, const double &muUpper, const int &timeSlotId) const {
+// record every voltage violation on this bus
+void BusController::collectVoltageViolationsAtTime(const int &timeSlotId, VoltageViolationCollector &collector) const {
+    if (! _hasVoltageConstraint)
+        return;
+    
+    for (int phaseId = 0; phaseId < _phaseIndicesInParentBus.size(); phaseId ++) {
+        double voltageMagnitude = std::sqrt( std::norm( _voltages[timeSlotId]._data[phaseId] ) );
+        if (voltageMagnitude < _voltageMin ||
+            voltageMagnitude > _voltageMax)
+            collector.record(this, phaseId, timeSlotId, voltageMagnitude, _voltageMin, _voltageMax);
+    }
+}
+
+void BusController::collectVoltageViolationsOverHorizon(VoltageViolationCollector &collector) const {
+    for (int timeSlotId = 0; timeSlotId < _voltages.size(); timeSlotId ++) {
+        collectVoltageViolationsAtTime(timeSlotId, collector);
+    }
+}
+
+// compute objective value contributed by this bus and its loads
+double BusController::objectiveValueAtTime(const double &muLower, const double &muUpper, const int &timeSlotId) const {
     double result = 0.0;
 
-    // local contribution from loads
+    // contribution from loads
     for (int loadId = 0; loadId < _loadArray.size(); loadId ++) {
         result += _loadArray[loadId]->objectiveValueAtTime(timeSlotId);
     }
     
-    // local contribution from voltages
+    // contribution from voltages
     if (_hasVoltageConstraint) {
         double voltageMinSquare = _voltageMin * _voltageMin;
         double voltageMaxSquare = _voltageMax * _voltageMax;
@@ -449,103 +586,130 @@ double BusController::downstreamObjectiveValueAtTime(const double &muLower, cons
         }
     }
     
-    // contribution from downstream buses
-    for (int lineId = 0; lineId < _toLineArray.size(); lineId ++) {
-        BusController *toBus = _toLineArray[lineId]->_toBus;
-        result += toBus->downstreamObjectiveValueAtTime(muLower, muUpper, timeSlotId);
-    }
-    
     return result;
 }
 
-double BusController::downstreamObjectiveValueOverHorizon(const double &muLower, const double &muUpper) const {
+double BusController::objectiveValueOverHorizon(const double &muLower, const double &muUpper) const {
     double result = 0.0;
     
-    // local contribution from loads
+    // contribution from loads
     for (int loadId = 0; loadId < _loadArray.size(); loadId ++) {
         result += _loadArray[loadId]->objectiveValueOverHorizon();
     }
     
-    // local contribution from voltages
+    // contribution from voltages, time slots in the inner loop
     if (_hasVoltageConstraint) {
         double voltageMinSquare = _voltageMin * _voltageMin;
         double voltageMaxSquare = _voltageMax * _voltageMax;
-        for (int timeSlotId = 0; timeSlotId < _aggregateLoads.size(); timeSlotId ++) {
-            for (int phaseId = 0; phaseId < _phaseIndicesInParentBus.size(); phaseId ++) {
+        int numberOfSlots = int( _voltages.size() );
+        for (int phaseId = 0; phaseId < _phaseIndicesInParentBus.size(); phaseId ++) {
+            for (int timeSlotId = 0; timeSlotId < numberOfSlots; timeSlotId ++) {
                 double voltageSquare = std::norm( _voltages[timeSlotId]._data[phaseId] );
                 result -= muLower * log(voltageSquare - voltageMinSquare) + muUpper * log(voltageMaxSquare - voltageSquare);
             }
         }
     }
     
-    // contribution from downstream buses
-    for (int lineId = 0; lineId < _toLineArray.size(); lineId ++) {
-        BusController *toBus = _toLineArray[lineId]->_toBus;
-        result += toBus->downstreamObjectiveValueOverHorizon(muLower, muUpper);
-    }
-    
     return result;
 }
 
-// compute aggregated downstream power update size
-// store result in _powerUpdateSize
-double BusController::downstreamUpdateSizeAtTime(const int &timeSlotId) const {
-    double result = 0.0;
-    
-    // local size
-    // if (_bus->type() != SUBSTATION)
-        result = norm(_aggregateLoads[timeSlotId]._power - _oldAggregateLoads[timeSlotId]._power);
-    
-    // downstream size;
-    for (int lineId = 0; lineId < _toLineArray.size(); lineId ++) {
-        double updateSize = _toLineArray[lineId]->_toBus->downstreamUpdateSizeAtTime(timeSlotId);
-        if (result < updateSize)
-            result = updateSize;
-    }
-    
-    return result;
+// compute power update size on this bus
+double BusController::updateSizeAtTime(const int &timeSlotId) const {
+    return norm(_aggregateLoads[timeSlotId]._power - _oldAggregateLoads[timeSlotId]._power);
 }
 
-double BusController::downstreamUpdateSizeOverHorizon() const {
+double BusController::updateSizeOverHorizon() const {
     double result = 0.0;
     for (int timeSlotId = 0; timeSlotId < _aggregateLoads.size(); timeSlotId ++) {
-        double updateSize = downstreamUpdateSizeAtTime(timeSlotId);
+        double updateSize = updateSizeAtTime(timeSlotId);
         if (result < updateSize)
             result = updateSize;
     }
     return result;
 }
 
-// compute expected downstream expected objective value change
-// store result in _expectedObjectiveValueUpdate
-double BusController::downstreamExpectedObjectiveValueChangeAtTime(const int &timeSlotId) const {
+// compute expected objective value change contributed by loads on this bus
+double BusController::expectedObjectiveValueChangeAtTime(const int &timeSlotId) const {
     double result = 0.0;
-    
-    // local contribution
     for (int loadId = 0; loadId < _loadArray.size(); loadId ++) {
         result += _loadArray[loadId]->expectedObjectiveValueChangeAtTime(timeSlotId);
     }
-    
-    // downstream contributions
-    for (int lineId = 0; lineId < _toLineArray.size(); lineId ++) {
-        result += _toLineArray[lineId]->_toBus->downstreamExpectedObjectiveValueChangeAtTime(timeSlotId);
-    }
-    
     return result;
 }
 
-double BusController::downstreamExpectedObjectiveValueChangeOverHorizon() const {
+double BusController::expectedObjectiveValueChangeOverHorizon() const {
     double result = 0.0;
-    
-    // local contribution
     for (int loadId = 0; loadId < _loadArray.size(); loadId ++) {
         result += _loadArray[loadId]->expectedObjectiveValueChangeOverHorizon();
     }
+    return result;
+}
+
+// add all of the above for this bus to evaluation in a single pass
+// barrier terms are skipped once a voltage violation is found
+void BusController::evaluateAtTime(const double &muLower, const double &muUpper, const int &timeSlotId, ControlEvaluation &evaluation, VoltageViolationCollector *collector) const {
+    // contribution from loads
+    for (int loadId = 0; loadId < _loadArray.size(); loadId ++) {
+        LoadController *load = _loadArray[loadId];
+        evaluation._objectiveValue += load->objectiveValueAtTime(timeSlotId);
+        evaluation._expectedObjectiveValueChange += load->expectedObjectiveValueChangeAtTime(timeSlotId);
+    }
     
-    // downstream contributions
-    for (int lineId = 0; lineId < _toLineArray.size(); lineId ++) {
-        result += _toLineArray[lineId]->_toBus->downstreamExpectedObjectiveValueChangeOverHorizon();
+    // update size
+    double updateSize = updateSizeAtTime(timeSlotId);
+    if (evaluation._updateSize < updateSize)
+        evaluation._updateSize = updateSize;
+    
+    // voltage check and barrier terms share the voltage magnitude
+    if (_hasVoltageConstraint) {
+        double voltageMinSquare = _voltageMin * _voltageMin;
+        double voltageMaxSquare = _voltageMax * _voltageMax;
+        for (int phaseId = 0; phaseId < _phaseIndicesInParentBus.size(); phaseId ++) {
+            double voltageSquare = std::norm( _voltages[timeSlotId]._data[phaseId] );
+            double voltageMagnitude = std::sqrt( voltageSquare );
+            if (voltageMagnitude < _voltageMin ||
+                voltageMagnitude > _voltageMax) {
+                if (collector != NULL)
+                    collector->record(this, phaseId, timeSlotId, voltageMagnitude, _voltageMin, _voltageMax);
+                evaluation._voltageViolation = true;
+                return;
+            }
+            evaluation._objectiveValue -= muLower * log(voltageSquare - voltageMinSquare) + muUpper * log(voltageMaxSquare - voltageSquare);
+        }
+    }
+}
+
+void BusController::evaluateOverHorizon(const double &muLower, const double &muUpper, ControlEvaluation &evaluation, VoltageViolationCollector *collector) const {
+    // contribution from loads
+    for (int loadId = 0; loadId < _loadArray.size(); loadId ++) {
+        LoadController *load = _loadArray[loadId];
+        evaluation._objectiveValue += load->objectiveValueOverHorizon();
+        evaluation._expectedObjectiveValueChange += load->expectedObjectiveValueChangeOverHorizon();
     }
     
-    return result;
+    // update size
+    double updateSize = updateSizeOverHorizon();
+    if (evaluation._updateSize < updateSize)
+        evaluation._updateSize = updateSize;
+    
+    // voltage check and barrier terms share the voltage magnitude, time slots in the inner loop
+    if (_hasVoltageConstraint) {
+        double voltageMinSquare = _voltageMin * _voltageMin;
+        double voltageMaxSquare = _voltageMax * _voltageMax;
+        int numberOfSlots = int( _voltages.size() );
+        for (int phaseId = 0; phaseId < _phaseIndicesInParentBus.size(); phaseId ++) {
+            for (int timeSlotId = 0; timeSlotId < numberOfSlots; timeSlotId ++) {
+                double voltageSquare = std::norm( _voltages[timeSlotId]._data[phaseId] );
+                double voltageMagnitude = std::sqrt( voltageSquare );
+                if (voltageMagnitude < _voltageMin ||
+                    voltageMagnitude > _voltageMax) {
+                    if (collector != NULL)
+                        collector->record(this, phaseId, timeSlotId, voltageMagnitude, _voltageMin, _voltageMax);
+                    evaluation._voltageViolation = true;
+                    return;
+                }
+                evaluation._objectiveValue -= muLower * log(voltageSquare - voltageMinSquare) + muUpper * log(voltageMaxSquare - voltageSquare);
+            }
+        }
+    }
 }
@@ -26,6 +26,7 @@ class Bus;
 class LineController;
 class LoadController;
 class Load;
+class VoltageViolationCollector;
 
 class BusController {
 public:
@@ -60,8 +61,12 @@ public:
      ******************************/
     ColumnVector<complex_type> _beta;               // see paper
     vector<ColumnVector<double>> _sumDown;          // see paper
+    vector<ColumnVector<double>> _sumDownLoad;      // part of sumDown scaled by price, from the power flow sweep
+    vector<ColumnVector<double>> _sumDownLower;     // part of sumDown scaled by muLower, from the power flow sweep
+    vector<ColumnVector<double>> _sumDownUpper;     // part of sumDown scaled by muUpper, from the power flow sweep
     vector<ColumnVector<complex_type>> _sumUp;      // see paper
     vector<ColumnVector<complex_type>> _gradient;   // see paper
+    vector<ColumnVector<complex_type>> _oldGradient;// gradient at the previous iterate
     vector<LoadValue> _oldAggregateLoads;
     
     
@@ -117,6 +122,11 @@ public:
     double computeCurrentOnFromLineAtTime(int timeSlotId);
     double computeCurrentOnFromLineOverHorizon();
     
+    // compute current by backward sweep, and accumulate the parts of sumDown on the way
+    // the parts do not depend on price or mu, see computeSumDownFromPartsAtTime
+    double computeCurrentAndSumDownPartsAtTime(int timeSlotId);
+    double computeCurrentAndSumDownPartsOverHorizon();
+    
     // compute voltage by forward sweep
     double computeVoltageOnSelfAtTime(int timeSlotId);
     double computeVoltageOnSelfOverHorizon();
@@ -130,6 +140,11 @@ public:
     void computeSumDownAtTime(double muLower, double muUpper, const vector<double> &price, const int &timeSlotId);
     void computeSumDownOverHorizon(double muLower, double muUpper, const vector<double> &price);
     
+    // compute sumDown from the parts accumulated in the power flow sweep
+    // no traversal of the tree is needed
+    void computeSumDownFromPartsAtTime(double muLower, double muUpper, const vector<double> &price, const int &timeSlotId);
+    void computeSumDownFromPartsOverHorizon(double muLower, double muUpper, const vector<double> &price);
+    
     // compute sumUp
     void computeSumUpAtTime(const int &timeSlotId);
     void computeSumUpOverHorizon();
@@ -156,24 +171,45 @@ public:
     void resetPowerAtTime(const int &timeSlotId, unordered_set<LoadType> &enabledInControl);
     void resetPowerOverHorizon(unordered_set<LoadType> &enabledInControl);
     
-    // check if there is voltage violation downstream
-    bool downstreamVoltageViolationAtTime(const int &timeSlotId) const;
-    bool downstreamVoltageViolationOverHorizon() const;
+    // extrapolate power consumption of loads by momentum, see LoadController
+    void extrapolatePowerAtTime(const double &momentum, const int &timeSlotId, unordered_set<LoadType> &enabledInControl);
+    void extrapolatePowerOverHorizon(const double &momentum, unordered_set<LoadType> &enabledInControl);
+    
+    // move power consumption of loads part of the way from their last accepted iterate, see LoadController
+    // _oldAggregateLoads[timeSlotId] unchanged
+    void interpolatePowerAtTime(const double &weight, const int &timeSlotId, unordered_set<LoadType> &enabledInControl);
+    
+    // set power consumption of loads to their last accepted iterate
+    void rollBackPowerOverHorizon(unordered_set<LoadType> &enabledInControl);
+    
+    // add inner products of the last step of loads, see LoadController
+    void addStepProductsOverHorizon(double &stepSquare, double &stepDotGradientChange, unordered_set<LoadType> &enabledInControl) const;
+    
+    // check if there is voltage violation on this bus
+    // the first violation found is recorded in collector if it is not NULL
+    bool voltageViolationAtTime(const int &timeSlotId, VoltageViolationCollector *collector = NULL) const;
+    bool voltageViolationOverHorizon(VoltageViolationCollector *collector = NULL) const;
+    
+    // record every voltage violation on this bus in collector
+    void collectVoltageViolationsAtTime(const int &timeSlotId, VoltageViolationCollector &collector) const;
+    void collectVoltageViolationsOverHorizon(VoltageViolationCollector &collector) const;
+    
+    // compute objective value contributed by this bus and its loads
+    double objectiveValueAtTime(const double &muLower, const double &muUpper, const int &timeSlotId) const;
+    double objectiveValueOverHorizon(const double &muLower, const double &muUpper) const;
     
-    // compute aggregated downstream objective value
-    // store result in _objectiveValueDownstream
-    double downstreamObjectiveValueAtTime(const double &muLower, const double &muUpper, const int &timeSlotId) const;
-    double downstreamObjectiveValueOverHorizon(const double &muLower, const double &muUpper) const;
+    // compute power update size on this bus
+    double updateSizeAtTime(const int &timeSlotId) const;
+    double updateSizeOverHorizon() const;
     
-    // compute aggregated downstream power update size
-    // store result in _powerUpdateSize
-    double downstreamUpdateSizeAtTime(const int &timeSlotId) const;
-    double downstreamUpdateSizeOverHorizon() const;
+    // compute expected objective value change contributed by loads on this bus
+    double expectedObjectiveValueChangeAtTime(const int &timeSlotId) const;
+    double expectedObjectiveValueChangeOverHorizon() const;
     
-    // compute expected downstream expected objective value change
-    // store result in _expectedObjectiveValueUpdate
-    double downstreamExpectedObjectiveValueChangeAtTime(const int &timeSlotId) const;
-    double downstreamExpectedObjectiveValueChangeOverHorizon() const;
+    // add all of the above for this bus to evaluation in a single pass
+    // barrier terms are skipped once a voltage violation is found, which is recorded in collector if it is not NULL
+    void evaluateAtTime(const double &muLower, const double &muUpper, const int &timeSlotId, ControlEvaluation &evaluation, VoltageViolationCollector *collector = NULL) const;
+    void evaluateOverHorizon(const double &muLower, const double &muUpper, ControlEvaluation &evaluation, VoltageViolationCollector *collector = NULL) const;
 };
 
 #endif /* defined(__OptimalPowerFlowVisualization__BusController__) */
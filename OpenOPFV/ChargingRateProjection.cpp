@@ -0,0 +1,107 @@
+/***********************************************************************
+ * Copyright (c) 2014 Energy Adaptive Networks Corp. All rights reserved.
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License v2 or Energy Adaptive Networks
+ * Commercial License, which accompanies this distribution.
+ * Any use, reproduction or distribution of the program constitutes the
+ * recipient’s acceptance of this agreement.
+ * http://www.eclipse.org/legal/epl-v20.html
+ *
+ * Contributors:
+ *    Energy Adaptive Networks Corp. - dev API
+ *    Lingwen Gan - initial flow implementation
+ *    Peter Enescu - initial implementation, test, docs
+ *
+ * Project OpenOPFV - Optimal Power Flow Visualizer – 7/20/2019
+ * Module ChargingRateProjection.cpp
+ *
+ ***********************************************************************/
+
+#include "ChargingRateProjection.h"
+#include "ElectricVehicleController.h"
+
+/******************************
+ basic functions
+ ******************************/
+
+// default constructor
+ChargingRateProjection::ChargingRateProjection() {
+}
+
+// forget the fleet and the buffers
+void ChargingRateProjection::clear() {
+    _devices.clear();
+    _offsets.clear();
+    _maxChargingRates.clear();
+    _energyRequests.clear();
+    _rates.clear();
+    _weights.clear();
+    _breakpoints.clear();
+}
+
+// one slice per EV
+void ChargingRateProjection::initialize(const vector<ElectricVehicleController *> &devices) {
+    clear();
+    _devices = devices;
+    _offsets.assign(_devices.size() + 1, 0);
+    _maxChargingRates.assign(_devices.size(), 0.0);
+    _energyRequests.assign(_devices.size(), 0.0);
+}
+
+
+/******************************
+ projection
+ ******************************/
+
+// gradient step of every EV into its slice, projection of every slice, then write back
+void ChargingRateProjection::attemptPowerOverHorizon(const double &stepSize) {
+    int numberOfDevices = int( _devices.size() );
+    
+    // lay the slices out
+    int numberOfEntries = 0;
+    int longestSlice = 0;
+    for (int deviceId = 0; deviceId < numberOfDevices; deviceId ++) {
+        int numberOfSlots = _devices[deviceId]->numberOfChargingSlots();
+        _offsets[deviceId] = numberOfEntries;
+        numberOfEntries += numberOfSlots;
+        if (numberOfSlots > longestSlice)
+            longestSlice = numberOfSlots;
+    }
+    _offsets[numberOfDevices] = numberOfEntries;
+    if (_rates.size() < numberOfEntries) {
+        _rates.resize(numberOfEntries);
+        _weights.resize(numberOfEntries);
+    }
+    if (_breakpoints.size() < longestSlice)
+        _breakpoints.resize(longestSlice);
+    
+    // gather, EV without a charging slot in the horizon report it themselves
+    for (int deviceId = 0; deviceId < numberOfDevices; deviceId ++) {
+        ElectricVehicleController *device = _devices[deviceId];
+        int offset = _offsets[deviceId];
+        if (_offsets[deviceId + 1] == offset) {
+            device->attemptPowerOverHorizon(stepSize);
+            continue;
+        }
+        device->tentativeChargingRatesOverHorizon(stepSize, &_rates[offset], &_weights[offset]);
+        _maxChargingRates[deviceId] = ((ElectricVehicle *)device->_load)->_maxChargingRate;
+        _energyRequests[deviceId] = device->energyRequestInSlots();
+    }
+    
+    // project
+    for (int deviceId = 0; deviceId < numberOfDevices; deviceId ++) {
+        int offset = _offsets[deviceId];
+        int numberOfSlots = _offsets[deviceId + 1] - offset;
+        if (numberOfSlots > 0)
+            ElectricVehicleController::projectChargingRates(&_rates[offset], &_weights[offset], numberOfSlots,
+                                                            _maxChargingRates[deviceId], _energyRequests[deviceId],
+                                                            _breakpoints.data());
+    }
+    
+    // scatter
+    for (int deviceId = 0; deviceId < numberOfDevices; deviceId ++) {
+        int offset = _offsets[deviceId];
+        if (_offsets[deviceId + 1] > offset)
+            _devices[deviceId]->setChargingRatesOverHorizon(&_rates[offset]);
+    }
+}
@@ -0,0 +1,73 @@
+/***********************************************************************
+ * Copyright (c) 2014 Energy Adaptive Networks Corp. All rights reserved.
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License v2 or Energy Adaptive Networks
+ * Commercial License, which accompanies this distribution.
+ * Any use, reproduction or distribution of the program constitutes the
+ * recipient’s acceptance of this agreement.
+ * http://www.eclipse.org/legal/epl-v20.html
+ *
+ * Contributors:
+ *    Energy Adaptive Networks Corp. - dev API
+ *    Lingwen Gan - initial flow implementation
+ *    Peter Enescu - initial implementation, test, docs
+ *
+ * Project OpenOPFV - Optimal Power Flow Visualizer – 7/20/2019
+ * Module ChargingRateProjection.h
+ *
+ ***********************************************************************/
+
+#ifndef __OptimalPowerFlowVisualization__ChargingRateProjection__
+#define __OptimalPowerFlowVisualization__ChargingRateProjection__
+
+#include "BasicDataType.h"
+
+class ElectricVehicleController;
+
+// gradient step and projection of the charging schedules of all EV, batched over the fleet
+// the charging slots of every EV are laid out as one slice of flat arrays, filled in one pass over the fleet,
+// projected slice by slice with the exact projection of ElectricVehicleController, and written back in another,
+// where the arrays only grow, so that a step allocates nothing once the fleet has been through one
+class ChargingRateProjection {
+public:
+    /******************************
+     fleet
+     ******************************/
+    vector<ElectricVehicleController *> _devices;   // EV enabled in control
+    vector<int> _offsets;                           // first entry of the slice of every EV, and the number of entries
+    vector<double> _maxChargingRates;               // per EV
+    vector<double> _energyRequests;                 // per EV, in rate times length of the first slot
+    
+    
+    /******************************
+     pass buffers
+     ******************************/
+    vector<double> _rates;                          // charging rate of every charging slot of every EV
+    vector<double> _weights;                        // slot weight of the above
+    vector<std::pair<double, double>> _breakpoints; // of the slice being projected
+    
+    
+public:
+    /******************************
+     basic functions
+     ******************************/
+    
+    // default constructor
+    ChargingRateProjection();
+    
+    // forget the fleet and the buffers
+    void clear();
+    
+    // one slice per EV, sized at every step since the charging slots move with the horizon
+    void initialize(const vector<ElectricVehicleController *> &devices);
+    
+    
+    /******************************
+     projection
+     ******************************/
+    
+    // set the tentative charging rates of every EV over the horizon, as ElectricVehicleController::attemptPowerOverHorizon
+    void attemptPowerOverHorizon(const double &stepSize);
+};
+
+#endif /* defined(__OptimalPowerFlowVisualization__ChargingRateProjection__) */
@@ -17,6 +17,7 @@
  *
  ***********************************************************************/
 
+#include <algorithm>
 #include "ElectricVehicleController.h"
 #include "BusController.h"
 
@@ -30,6 +31,7 @@ ElectricVehicleController::ElectricVehicleController(ElectricVehicle *ev,
                                                      time_type timeSlotLengthInMinutes) :
 LoadController(ev, numberOfSlots) {
     _slotLengthInMinutes = timeSlotLengthInMinutes;
+    _consensusPenalty = 0.0;
 }
 
 // copy constructor
@@ -37,6 +39,12 @@ ElectricVehicleController::ElectricVehicleController(const ElectricVehicleContro
     _plugInTimeSlotId = ev._plugInTimeSlotId;
     _deadlineTimeSlotId = ev._deadlineTimeSlotId;
     _slotLengthInMinutes = ev._slotLengthInMinutes;
+    _consensusPenalty = ev._consensusPenalty;
+    _consensusRates = ev._consensusRates;
+    _scaledDuals = ev._scaledDuals;
+    _projectedRates = ev._projectedRates;
+    _projectedWeights = ev._projectedWeights;
+    _breakpoints = ev._breakpoints;
 }
 
 // destructor
@@ -49,6 +57,12 @@ void ElectricVehicleController::operator=(const ElectricVehicleController &ev) {
     _plugInTimeSlotId = ev._plugInTimeSlotId;
     _deadlineTimeSlotId = ev._deadlineTimeSlotId;
     _slotLengthInMinutes = ev._slotLengthInMinutes;
+    _consensusPenalty = ev._consensusPenalty;
+    _consensusRates = ev._consensusRates;
+    _scaledDuals = ev._scaledDuals;
+    _projectedRates = ev._projectedRates;
+    _projectedWeights = ev._projectedWeights;
+    _breakpoints = ev._breakpoints;
 }
 
 // print
@@ -62,90 +76,274 @@ ostream &operator<<(ostream &cout, const ElectricVehicleController *ev) {
  ******************************/
 
 // compute tentative power consumption, _oldValueArray[timeSlotId] unchanged
+// the energy request couples the slots, so a single slot only moves against the consensus penalty
+void ElectricVehicleController::attemptPowerAtTime(const double &stepSize, const int &timeSlotId) {
+    if (_consensusPenalty <= 0.0 ||
+        timeSlotId < _plugInTimeSlotId ||
+        timeSlotId >= _deadlineTimeSlotId)
+        return;
+    
+    // gradient of the network objective and the penalty
+    double rate = _oldValueArray[timeSlotId]._power[0].real();
+    double grad = searchGradientAtTime(timeSlotId, 0).real();
+    grad += _consensusPenalty * (rate - _consensusRates[timeSlotId] + _scaledDuals[timeSlotId]) / slotWeight(timeSlotId);
+    
+    // move and project onto the rate limits
+    rate -= stepSize * grad;
+    double maxChargingRate = ((ElectricVehicle *)_load)->_maxChargingRate;
+    if (rate < 0.0)
+        rate = 0.0;
+    if (rate > maxChargingRate)
+        rate = maxChargingRate;
+    _valueArray[timeSlotId]._power[0] = rate;
+}
+
 void ElectricVehicleController::attemptPowerOverHorizon(const double &stepSize) {
     // must satisfy _deadlineTimeSlotId > _plugInTimeSlotId >= 0
-    if (_deadlineTimeSlotId <= _plugInTimeSlotId ||
-        _plugInTimeSlotId < 0 ||
-        _deadlineTimeSlotId > _valueArray.size()) {
+    int numberOfSlots = numberOfChargingSlots();
+    if (numberOfSlots == 0) {
         std::cout << "Unexpected time slot information to optimize over!" << std::endl;
         return;
     }
     
-    // get gradient from location bus
-    vector<double> grad(_valueArray.size(), 0.0);
-    for (int timeSlotId = 0; timeSlotId < grad.size(); timeSlotId ++)
-        grad[timeSlotId] = _locationBus->_gradient[timeSlotId][_phaseIndicesInLocationBus[0]].real();
-    
-    // move along the negative gradient direction by step size
-    vector<double> tentativeProfileInChargingSlots(_deadlineTimeSlotId - _plugInTimeSlotId, 0.0);
+    // move along the negative gradient direction by step size, then project back to the feasible set
+    _projectedRates.resize(numberOfSlots);
+    _projectedWeights.resize(numberOfSlots);
+    _breakpoints.resize(numberOfSlots);
+    tentativeChargingRatesOverHorizon(stepSize, _projectedRates.data(), _projectedWeights.data());
+    projectChargingRates(_projectedRates.data(), _projectedWeights.data(), numberOfSlots,
+                         ((ElectricVehicle *)_load)->_maxChargingRate, energyRequestInSlots(), _breakpoints.data());
+    setChargingRatesOverHorizon(_projectedRates.data());
+}
+
+// penalty of the distance to the consensus rate
+double ElectricVehicleController::objectiveValueAtTime(const int &timeSlotId) {
+    if (_consensusPenalty <= 0.0 ||
+        timeSlotId < _plugInTimeSlotId ||
+        timeSlotId >= _deadlineTimeSlotId)
+        return 0.0;
+    double residual = _valueArray[timeSlotId]._power[0].real() - _consensusRates[timeSlotId] + _scaledDuals[timeSlotId];
+    return _consensusPenalty / 2.0 * residual * residual;
+}
+
+// compute the expected change of the objective value
+double ElectricVehicleController::expectedObjectiveValueChangeAtTime(const int &timeSlotId) {
+    double result = LoadController::expectedObjectiveValueChangeAtTime(timeSlotId);
+    if (_consensusPenalty <= 0.0 ||
+        timeSlotId < _plugInTimeSlotId ||
+        timeSlotId >= _deadlineTimeSlotId)
+        return result;
+    double oldRate = _oldValueArray[timeSlotId]._power[0].real();
+    double residual = oldRate - _consensusRates[timeSlotId] + _scaledDuals[timeSlotId];
+    return result + _consensusPenalty * residual * (_valueArray[timeSlotId]._power[0].real() - oldRate);
+}
+
+// only charging rates inside the charging slots and away from the rate limits move,
+// and the free rates deliver no energy in total
+void ElectricVehicleController::projectOntoFreeDirectionsOverHorizon(vector<ColumnVector<complex_type>> &direction) const {
+    double maxChargingRate = ((ElectricVehicle *)_load)->_maxChargingRate;
+    vector<bool> free(direction.size(), false);
+    double energy = 0.0;
+    double weightSquare = 0.0;
     for (int timeSlotId = _plugInTimeSlotId; timeSlotId < _deadlineTimeSlotId; timeSlotId ++) {
-        tentativeProfileInChargingSlots[timeSlotId - _plugInTimeSlotId] = _oldValueArray[timeSlotId]._power[0].real() - stepSize * grad[timeSlotId];
+        double rate = _oldValueArray[timeSlotId]._power._data[0].real();
+        double gradient = _locationBus->_gradient[timeSlotId]._data[_phaseIndicesInLocationBus[0]].real();
+        free[timeSlotId] = ! (rate <= 0.0 && gradient > 0.0) && ! (rate >= maxChargingRate && gradient < 0.0);
+        if ( free[timeSlotId] ) {
+            double weight = slotWeight(timeSlotId);
+            energy += weight * direction[timeSlotId]._data[0].real();
+            weightSquare += weight * weight;
+        }
     }
-    
-    // projection back to the feasible set
-    // get the range of moving
-    double minRate = tentativeProfileInChargingSlots[0];
-    double maxRate = tentativeProfileInChargingSlots[0];
-    for (int timeSlotId = 1; timeSlotId < tentativeProfileInChargingSlots.size(); timeSlotId ++) {
-        double rate = tentativeProfileInChargingSlots[timeSlotId];
-        if (rate < minRate)
-            minRate = rate;
-        if (rate > maxRate)
-            maxRate = rate;
+    for (int timeSlotId = 0; timeSlotId < direction.size(); timeSlotId ++) {
+        double value = free[timeSlotId] ? direction[timeSlotId]._data[0].real() - energy / weightSquare * slotWeight(timeSlotId) : 0.0;
+        direction[timeSlotId]._data[0] = complex_type(value, 0.0);
     }
-    double maxChargingRate = ((ElectricVehicle *)_load)->_maxChargingRate;
+}
+
+// projection onto the feasible set of charging rates
+// distances in longer slots weigh more, so that all rates move by the same amount
+void ElectricVehicleController::projectChargingRates(vector<double> &rates) {
+    int numberOfSlots = int( rates.size() );
+    _projectedWeights.resize(numberOfSlots);
+    _breakpoints.resize(numberOfSlots);
+    for (int timeSlotId = 0; timeSlotId < numberOfSlots; timeSlotId ++)
+        _projectedWeights[timeSlotId] = slotWeight(_plugInTimeSlotId + timeSlotId);
+    projectChargingRates(rates.data(), _projectedWeights.data(), numberOfSlots,
+                         ((ElectricVehicle *)_load)->_maxChargingRate, energyRequestInSlots(), _breakpoints.data());
+}
+
+// the energy sum_t weight_t * clamp(rate_t + move, 0, maxChargingRate) is piecewise linear in move,
+// with slope the weight of the slots strictly between the bounds, changing at -rate_t and maxChargingRate - rate_t
+void ElectricVehicleController::projectChargingRates(double *rates, const double *weights, int numberOfSlots,
+                                                     double maxChargingRate, double energyRequest,
+                                                     std::pair<double, double> *breakpoints) {
     double minChargingRate = 0.0;
-    double energyRequest = ((ElectricVehicle *)_load)->_futureEnergyRequest * 60 / _slotLengthInMinutes;
-    double maxMove = maxChargingRate - minRate;
-    double minMove = minChargingRate - maxRate;
+    double maxEnergy = 0.0;
+    for (int timeSlotId = 0; timeSlotId < numberOfSlots; timeSlotId ++)
+        maxEnergy += weights[timeSlotId] * maxChargingRate;
     
-    // modified bijection method to speed up projection
-    vector<double> tentativeProfileAfterProjection(tentativeProfileInChargingSlots);
-    while (maxMove > minMove + 1e-4) {
-        double move = (maxMove + minMove) / 2.0;
-        double sumRate = 0.0;
-        int activeLowerBound = 0.0;
-        int activeUpperBound = 0.0;
-        
-        // get the profile after moving with step size move
-        for (int timeSlotId = 0; timeSlotId < tentativeProfileInChargingSlots.size(); timeSlotId ++) {
-            double rate = move + tentativeProfileInChargingSlots[timeSlotId];
-            if (rate < minChargingRate) {
-                rate = minChargingRate;
-                activeLowerBound ++;
-            }
-            else if (rate > maxChargingRate) {
-                rate = maxChargingRate;
-                activeUpperBound ++;
-            }
-            tentativeProfileAfterProjection[timeSlotId] = rate;
-            sumRate += rate;
-        }
-        
-        // find how to upate maxMove and minMove
-        if (sumRate == energyRequest) {
-            maxMove = move;
-            minMove = move;
-        }
-        else if (sumRate < energyRequest)
-            minMove = move + (energyRequest - sumRate) / (tentativeProfileInChargingSlots.size() - activeUpperBound);
+    // requests out of reach take the closest bound
+    if (energyRequest <= 0.0 || energyRequest >= maxEnergy) {
+        double rate = energyRequest <= 0.0 ? minChargingRate : maxChargingRate;
+        for (int timeSlotId = 0; timeSlotId < numberOfSlots; timeSlotId ++)
+            rates[timeSlotId] = rate;
+        return;
+    }
+    
+    // sort the points where slots leave the lower bound, gaining slope,
+    // the points where they reach the upper bound, losing it, come in the same order maxChargingRate later
+    for (int timeSlotId = 0; timeSlotId < numberOfSlots; timeSlotId ++)
+        breakpoints[timeSlotId] = std::make_pair(minChargingRate - rates[timeSlotId], weights[timeSlotId]);
+    std::sort(breakpoints, breakpoints + numberOfSlots);
+    
+    // walk the pieces in merged order until the energy reaches the request,
+    // all rates are at the lower bound before the first point
+    double move = breakpoints[0].first;
+    double energy = 0.0;
+    double freeWeight = 0.0;
+    int lowerPointId = 0;
+    int upperPointId = 0;
+    while (upperPointId < numberOfSlots) {
+        double upperPoint = breakpoints[upperPointId].first + maxChargingRate - minChargingRate;
+        bool lower = lowerPointId < numberOfSlots && breakpoints[lowerPointId].first <= upperPoint;
+        double point = lower ? breakpoints[lowerPointId].first : upperPoint;
+        double nextEnergy = energy + freeWeight * (point - move);
+        if (nextEnergy >= energyRequest)
+            break;
+        energy = nextEnergy;
+        move = point;
+        if (lower)
+            freeWeight += breakpoints[lowerPointId ++].second;
         else
-            maxMove = move - (sumRate - energyRequest) / (tentativeProfileInChargingSlots.size() - activeLowerBound);
+            freeWeight -= breakpoints[upperPointId ++].second;
     }
+    if (freeWeight > 0.0)
+        move += (energyRequest - energy) / freeWeight;
     
-    // set tentativeProfileInChargingSlots
-    double move = (maxMove + minMove) / 2.0;
-    for (int timeSlotId = 0; timeSlotId < tentativeProfileInChargingSlots.size(); timeSlotId ++) {
-        double rate = move + tentativeProfileInChargingSlots[timeSlotId];
+    // set rates
+    for (int timeSlotId = 0; timeSlotId < numberOfSlots; timeSlotId ++) {
+        double rate = move + rates[timeSlotId];
         if (rate < minChargingRate)
             rate = minChargingRate;
         if (rate > maxChargingRate)
             rate = maxChargingRate;
-        tentativeProfileInChargingSlots[timeSlotId] = rate;
+        rates[timeSlotId] = rate;
+    }
+}
+
+// number of charging slots
+int ElectricVehicleController::numberOfChargingSlots() const {
+    if (_deadlineTimeSlotId <= _plugInTimeSlotId ||
+        _plugInTimeSlotId < 0 ||
+        _deadlineTimeSlotId > _valueArray.size())
+        return 0;
+    return _deadlineTimeSlotId - _plugInTimeSlotId;
+}
+
+// energy request in rate times first slot lengths
+double ElectricVehicleController::energyRequestInSlots() const {
+    return ((ElectricVehicle *)_load)->_futureEnergyRequest * 60 / _slotLengthInMinutes;
+}
+
+// move along the negative gradient direction by step size, from _oldValueArray
+void ElectricVehicleController::tentativeChargingRatesOverHorizon(const double &stepSize, double *rates, double *weights) const {
+    for (int timeSlotId = _plugInTimeSlotId; timeSlotId < _deadlineTimeSlotId; timeSlotId ++) {
+        rates[timeSlotId - _plugInTimeSlotId] = _oldValueArray[timeSlotId]._power._data[0].real() - stepSize * searchGradientAtTime(timeSlotId, 0).real();
+        weights[timeSlotId - _plugInTimeSlotId] = slotWeight(timeSlotId);
     }
+}
+
+// write back to _valueArray
+void ElectricVehicleController::setChargingRatesOverHorizon(const double *rates) {
+    for (int timeSlotId = _plugInTimeSlotId; timeSlotId < _deadlineTimeSlotId; timeSlotId ++)
+        _valueArray[timeSlotId]._power[0] = rates[timeSlotId - _plugInTimeSlotId];
+}
+
+// take the charging schedule from the kept solution
+void ElectricVehicleController::warmStartOverHorizon(const vector<int> &sourceSlotIds) {
+    if (_warmStartValueArray.size() != _valueArray.size() ||
+        _deadlineTimeSlotId <= _plugInTimeSlotId ||
+        _plugInTimeSlotId < 0 ||
+        _deadlineTimeSlotId > _valueArray.size())
+        return;
     
-    // write back to _valueArray
+    // shift the schedule, slots beyond the last horizon start empty
+    vector<double> rates(_deadlineTimeSlotId - _plugInTimeSlotId, 0.0);
     for (int timeSlotId = _plugInTimeSlotId; timeSlotId < _deadlineTimeSlotId; timeSlotId ++) {
-        _valueArray[timeSlotId]._power[0] = tentativeProfileInChargingSlots[timeSlotId - _plugInTimeSlotId];
+        if (sourceSlotIds[timeSlotId] >= 0)
+            rates[timeSlotId - _plugInTimeSlotId] = _warmStartValueArray[sourceSlotIds[timeSlotId]]._power[0].real();
     }
+    
+    // the energy request may have changed since
+    projectChargingRates(rates);
+    for (int timeSlotId = _plugInTimeSlotId; timeSlotId < _deadlineTimeSlotId; timeSlotId ++) {
+        _valueArray[timeSlotId]._power[0] = rates[timeSlotId - _plugInTimeSlotId];
+    }
+}
+
+
+/******************************
+ consensus in temporal decomposition
+ ******************************/
+
+// turn consensus on
+void ElectricVehicleController::startConsensus(double penalty) {
+    _consensusPenalty = penalty;
+    _consensusRates.assign(_valueArray.size(), 0.0);
+    _scaledDuals.assign(_valueArray.size(), 0.0);
+    for (int timeSlotId = 0; timeSlotId < _valueArray.size(); timeSlotId ++) {
+        _consensusRates[timeSlotId] = _valueArray[timeSlotId]._power[0].real();
+        if (timeSlotId >= _plugInTimeSlotId && timeSlotId < _deadlineTimeSlotId)
+            _scaledDuals[timeSlotId] = - _locationBus->_gradient[timeSlotId][_phaseIndicesInLocationBus[0]].real() / penalty;
+    }
+}
+
+// consensus and dual update of ADMM
+void ElectricVehicleController::updateConsensus(double &primalResidualSquare, double &dualResidualSquare) {
+    if (_deadlineTimeSlotId <= _plugInTimeSlotId ||
+        _plugInTimeSlotId < 0 ||
+        _deadlineTimeSlotId > _valueArray.size())
+        return;
+    
+    // project rates plus duals
+    vector<double> rates(_deadlineTimeSlotId - _plugInTimeSlotId, 0.0);
+    for (int timeSlotId = _plugInTimeSlotId; timeSlotId < _deadlineTimeSlotId; timeSlotId ++) {
+        rates[timeSlotId - _plugInTimeSlotId] = _valueArray[timeSlotId]._power[0].real() + _scaledDuals[timeSlotId];
+    }
+    projectChargingRates(rates);
+    
+    // update consensus rates and duals
+    for (int timeSlotId = _plugInTimeSlotId; timeSlotId < _deadlineTimeSlotId; timeSlotId ++) {
+        double consensusChange = rates[timeSlotId - _plugInTimeSlotId] - _consensusRates[timeSlotId];
+        _consensusRates[timeSlotId] = rates[timeSlotId - _plugInTimeSlotId];
+        double residual = _valueArray[timeSlotId]._power[0].real() - _consensusRates[timeSlotId];
+        _scaledDuals[timeSlotId] += residual;
+        primalResidualSquare += residual * residual;
+        dualResidualSquare += _consensusPenalty * _consensusPenalty * consensusChange * consensusChange;
+    }
+}
+
+// set the schedule to the consensus rates
+void ElectricVehicleController::finishConsensus() {
+    if (_consensusPenalty > 0.0) {
+        for (int timeSlotId = _plugInTimeSlotId; timeSlotId < _deadlineTimeSlotId; timeSlotId ++) {
+            _valueArray[timeSlotId]._power[0] = _consensusRates[timeSlotId];
+        }
+    }
+    _consensusPenalty = 0.0;
+}
+
+// consensus on a single slot
+void ElectricVehicleController::startTerminalCostAtTime(double penalty, double plannedRate, double plannedPrice, const int &timeSlotId) {
+    _consensusPenalty = penalty;
+    _consensusRates.assign(_valueArray.size(), 0.0);
+    _scaledDuals.assign(_valueArray.size(), 0.0);
+    _consensusRates[timeSlotId] = plannedRate;
+    _scaledDuals[timeSlotId] = - plannedPrice / penalty;
+}
+
+// turn consensus off
+void ElectricVehicleController::stopConsensus() {
+    _consensusPenalty = 0.0;
 }
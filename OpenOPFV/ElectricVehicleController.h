@@ -30,7 +30,23 @@ public:
      ******************************/
     int _plugInTimeSlotId;
     int _deadlineTimeSlotId;
-    time_type _slotLengthInMinutes;
+    time_type _slotLengthInMinutes;     // length of the first slot, the others are _slotWeights times longer
+    
+    
+    /******************************
+     consensus in temporal decomposition
+     ******************************/
+    double _consensusPenalty;           // ADMM penalty, 0 outside of the ADMM solver
+    vector<double> _consensusRates;     // charging rates that deliver the energy request, per slot
+    vector<double> _scaledDuals;        // scaled dual variables of rate = consensus rate, per slot
+    
+    
+    /******************************
+     projection buffers
+     ******************************/
+    vector<double> _projectedRates;     // charging rates of the charging slots, reused across projections
+    vector<double> _projectedWeights;   // slot weights of the charging slots
+    vector<std::pair<double, double>> _breakpoints;   // moves where rates leave the lower bound, and the slot weights
     
     
 public:
@@ -62,7 +78,68 @@ public:
      ******************************/
     
     // compute tentative power consumption, _oldValueArray[timeSlotId] unchanged
+    // a single slot only moves while consensus is on, within [0, _maxChargingRate]
+    virtual void attemptPowerAtTime(const double &stepSize, const int &timeSlotId);
     virtual void attemptPowerOverHorizon(const double &stepSize);
+    
+    // penalty of the distance to the consensus rate while consensus is on, 0 otherwise
+    virtual double objectiveValueAtTime(const int &timeSlotId);
+    
+    // compute the expected change of the objective value, including the consensus penalty
+    virtual double expectedObjectiveValueChangeAtTime(const int &timeSlotId);
+    
+    // only charging rates inside the charging slots and away from the rate limits move, keeping the energy delivered
+    virtual void projectOntoFreeDirectionsOverHorizon(vector<ColumnVector<complex_type>> &direction) const;
+    
+    // project charging rates in slots [_plugInTimeSlotId, _deadlineTimeSlotId) onto the feasible set,
+    // where rates are within [0, _maxChargingRate] and deliver _futureEnergyRequest over the slot lengths
+    // distances are weighted by slot weights, as are the steps of searchGradientAtTime
+    void projectChargingRates(vector<double> &rates);
+    
+    // exact projection of numberOfSlots rates with the given slot weights, in place and in O(n log n),
+    // rates become clamp(rate + move, 0, maxChargingRate) with move found by sorting the points where they leave 0
+    // breakpoints holds at least numberOfSlots entries
+    static void projectChargingRates(double *rates, const double *weights, int numberOfSlots,
+                                     double maxChargingRate, double energyRequest,
+                                     std::pair<double, double> *breakpoints);
+    
+    // number of slots in [_plugInTimeSlotId, _deadlineTimeSlotId), 0 if they are not a range within the horizon
+    int numberOfChargingSlots() const;
+    
+    // energy request in rate times length of the first slot
+    double energyRequestInSlots() const;
+    
+    // rates of the charging slots after moving along the negative gradient by stepSize, and their slot weights
+    void tentativeChargingRatesOverHorizon(const double &stepSize, double *rates, double *weights) const;
+    
+    // set the tentative power consumption of the charging slots
+    void setChargingRatesOverHorizon(const double *rates);
+    
+    // take the charging schedule from the kept solution, projected onto the new feasible set
+    virtual void warmStartOverHorizon(const vector<int> &sourceSlotIds);
+    
+    
+    /******************************
+     consensus in temporal decomposition
+     ******************************/
+    
+    // turn consensus on with the current schedule as consensus rates
+    // duals start from the gradient at the location bus, where the slot problems are stationary
+    void startConsensus(double penalty);
+    
+    // project rates plus duals onto the feasible set as new consensus rates, then update the duals
+    // adds squared primal residual |rate - consensus|^2 and dual residual |penalty * consensus change|^2
+    void updateConsensus(double &primalResidualSquare, double &dualResidualSquare);
+    
+    // set the schedule to the consensus rates and turn consensus off
+    void finishConsensus();
+    
+    // turn consensus on in timeSlotId alone, around plannedRate with plannedPrice the gradient of a plan there,
+    // so that the slot problem is stationary at the plan, with a quadratic model of the cost of the other slots
+    void startTerminalCostAtTime(double penalty, double plannedRate, double plannedPrice, const int &timeSlotId);
+    
+    // turn consensus off and keep the schedule
+    void stopConsensus();
 };
 
 #endif /* defined(__optimalpowerflowvisualization__ElectricVehicleController__) */
@@ -31,7 +31,8 @@ _load(load),
 _valueArray(numberOfSlots, load->value()),
 _locationBus(NULL),
 _phaseIndicesInLocationBus(load->phaseIndicesInLocationBus()),
-_oldValueArray(numberOfSlots, load->value()) {
+_oldValueArray(numberOfSlots, load->value()),
+_acceptedValueArray(numberOfSlots, load->value()) {
 }
 
 // copy constructor
@@ -40,7 +41,11 @@ _load(controller._load),
 _valueArray(controller._valueArray),
 _locationBus(controller._locationBus),
 _phaseIndicesInLocationBus(controller._phaseIndicesInLocationBus),
-_oldValueArray(controller._oldValueArray) {
+_oldValueArray(controller._oldValueArray),
+_acceptedValueArray(controller._acceptedValueArray),
+_warmStartValueArray(controller._warmStartValueArray),
+_scaledGradient(controller._scaledGradient),
+_slotWeights(controller._slotWeights) {
 }
 
 // destructor
@@ -50,6 +55,8 @@ LoadController::~LoadController() {
     _locationBus = NULL;
     _phaseIndicesInLocationBus.clear();
     _oldValueArray.clear();
+    _acceptedValueArray.clear();
+    _warmStartValueArray.clear();
 }
 
 // assignment
@@ -59,6 +66,10 @@ void LoadController::operator=(const LoadController &controller) {
     _locationBus = controller._locationBus;
     _phaseIndicesInLocationBus = controller._phaseIndicesInLocationBus;
     _oldValueArray = controller._oldValueArray;
+    _acceptedValueArray = controller._acceptedValueArray;
+    _warmStartValueArray = controller._warmStartValueArray;
+    _scaledGradient = controller._scaledGradient;
+    _slotWeights = controller._slotWeights;
 }
 
 // print
@@ -97,6 +108,83 @@ void LoadController::resetPowerOverHorizon() {
     _valueArray = _oldValueArray;
 }
 
+// move power consumption along the change since the last accepted iterate
+void LoadController::extrapolatePowerAtTime(const double &momentum, const int &timeSlotId) {
+    ColumnVector<complex_type> change = _valueArray[timeSlotId]._power - _acceptedValueArray[timeSlotId]._power;
+    _acceptedValueArray[timeSlotId] = _valueArray[timeSlotId];
+    if (momentum != 0.0)
+        _valueArray[timeSlotId]._power = _valueArray[timeSlotId]._power + change * complex_type(momentum, 0.0);
+    _oldValueArray[timeSlotId] = _valueArray[timeSlotId];
+}
+
+void LoadController::extrapolatePowerOverHorizon(const double &momentum) {
+    for (int timeSlotId = 0; timeSlotId < _valueArray.size(); timeSlotId ++) {
+        extrapolatePowerAtTime(momentum, timeSlotId);
+    }
+}
+
+// move power consumption part of the way from the last accepted iterate
+void LoadController::interpolatePowerAtTime(const double &weight, const int &timeSlotId) {
+    ColumnVector<complex_type> change = _valueArray[timeSlotId]._power - _acceptedValueArray[timeSlotId]._power;
+    _valueArray[timeSlotId]._power = _acceptedValueArray[timeSlotId]._power + change * complex_type(weight, 0.0);
+}
+
+// set power consumption to the last accepted iterate
+void LoadController::rollBackPowerOverHorizon() {
+    _valueArray = _acceptedValueArray;
+    _oldValueArray = _acceptedValueArray;
+}
+
+// inner products of the last step, used in Barzilai-Borwein step sizes
+void LoadController::addStepProductsOverHorizon(double &stepSquare, double &stepDotGradientChange) const {
+    for (int timeSlotId = 0; timeSlotId < _valueArray.size(); timeSlotId ++) {
+        const ColumnVector<complex_type> &gradient = _locationBus->_gradient[timeSlotId];
+        const ColumnVector<complex_type> &oldGradient = _locationBus->_oldGradient[timeSlotId];
+        for (int phaseId = 0; phaseId < _phaseIndicesInLocationBus.size(); phaseId ++) {
+            complex_type step = _valueArray[timeSlotId]._power._data[phaseId] - _acceptedValueArray[timeSlotId]._power._data[phaseId];
+            complex_type gradientChange = gradient._data[_phaseIndicesInLocationBus[phaseId]] - oldGradient._data[_phaseIndicesInLocationBus[phaseId]];
+            stepSquare += std::norm(step);
+            stepDotGradientChange += step.real() * gradientChange.real() + step.imag() * gradientChange.imag();
+        }
+    }
+}
+
+// gradient that attempts move along
+// length of a slot relative to the first one
+double LoadController::slotWeight(const int &timeSlotId) const {
+    if (_slotWeights.empty())
+        return 1.0;
+    return _slotWeights[timeSlotId];
+}
+
+complex_type LoadController::searchGradientAtTime(const int &timeSlotId, int phaseId) const {
+    if ( ! _scaledGradient.empty() )
+        return _scaledGradient[timeSlotId]._data[phaseId];
+    return _locationBus->_gradient[timeSlotId]._data[_phaseIndicesInLocationBus[phaseId]] / slotWeight(timeSlotId);
+}
+
+// uncontrollable loads cannot move
+void LoadController::projectOntoFreeDirectionsAtTime(const int &timeSlotId, ColumnVector<complex_type> &direction) const {
+    direction.reset();
+}
+
+void LoadController::projectOntoFreeDirectionsOverHorizon(vector<ColumnVector<complex_type>> &direction) const {
+    for (int timeSlotId = 0; timeSlotId < direction.size(); timeSlotId ++)
+        projectOntoFreeDirectionsAtTime(timeSlotId, direction[timeSlotId]);
+}
+
+// keep the solution for the next slow control
+void LoadController::saveWarmStartOverHorizon() {
+    _warmStartValueArray = _valueArray;
+}
+
+// uncontrollable loads keep the prediction
+void LoadController::warmStartOverHorizon(const vector<int> &sourceSlotIds) {
+}
+
+void LoadController::holdSetPointAtTime(const LoadValue &setPoint, const int &timeSlotId) {
+}
+
 // compute objective value
 double LoadController::objectiveValueAtTime(const int &timeSlotId) {
     return 0.0;
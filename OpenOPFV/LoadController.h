@@ -40,6 +40,10 @@ public:
     BusController *_locationBus;
     vector<int> _phaseIndicesInLocationBus;
     vector<LoadValue> _oldValueArray;
+    vector<LoadValue> _acceptedValueArray;  // last accepted iterate in accelerated methods
+    vector<LoadValue> _warmStartValueArray; // solution of the last slow control, empty if none
+    vector<ColumnVector<complex_type>> _scaledGradient; // gradient scaled by the quasi-Newton solver, per slot, empty if not used
+    vector<double> _slotWeights;        // length of every slot relative to the first one, empty if all are equal
     
     
 public:
@@ -80,6 +84,49 @@ public:
     void resetPowerAtTime(const int &timeSlotId);
     void resetPowerOverHorizon();
     
+    // move _valueArray and _oldValueArray by momentum times the change since _acceptedValueArray,
+    // and set _acceptedValueArray to the power consumption before moving
+    void extrapolatePowerAtTime(const double &momentum, const int &timeSlotId);
+    void extrapolatePowerOverHorizon(const double &momentum);
+    
+    // move _valueArray[timeSlotId] to _acceptedValueArray[timeSlotId] plus weight times the change since, _oldValueArray unchanged
+    void interpolatePowerAtTime(const double &weight, const int &timeSlotId);
+    
+    // set _valueArray and _oldValueArray to _acceptedValueArray
+    void rollBackPowerOverHorizon();
+    
+    // add squared norm of the power change since _acceptedValueArray to stepSquare,
+    // and its inner product with the gradient change at the location bus to stepDotGradientChange
+    void addStepProductsOverHorizon(double &stepSquare, double &stepDotGradientChange) const;
+    
+    // length of a slot relative to the first one, which also weighs the cost of the slot
+    double slotWeight(const int &timeSlotId) const;
+    
+    // gradient that attempts move phaseId along at timeSlotId,
+    // _scaledGradient if set, otherwise the gradient at the location bus divided by the slot weight,
+    // so that the cost of longer slots does not shorten the steps of all slots
+    complex_type searchGradientAtTime(const int &timeSlotId, int phaseId) const;
+    
+    // project direction, indexed by phases of this load, onto the directions this load can move along
+    // from _oldValueArray without leaving its feasible set at once: uncontrolled parts and parts at a bound
+    // the gradient pushes against are zeroed, and over the horizon equality constraints are kept as well
+    // by default nothing moves, and the horizon is projected slot by slot
+    virtual void projectOntoFreeDirectionsAtTime(const int &timeSlotId, ColumnVector<complex_type> &direction) const;
+    virtual void projectOntoFreeDirectionsOverHorizon(vector<ColumnVector<complex_type>> &direction) const;
+    
+    // keep _valueArray as the starting point of the next slow control
+    void saveWarmStartOverHorizon();
+    
+    // start from the kept solution, where _valueArray holds the new prediction and
+    // sourceSlotIds[timeSlotId] is the slot of the kept solution to start timeSlotId from, -1 if none
+    // uncontrollable loads keep the prediction
+    virtual void warmStartOverHorizon(const vector<int> &sourceSlotIds);
+    
+    // take the controllable part of setPoint into _valueArray[timeSlotId], projected onto the feasible set
+    // left by the measured part already in _valueArray[timeSlotId]
+    // uncontrollable loads keep the measurement
+    virtual void holdSetPointAtTime(const LoadValue &setPoint, const int &timeSlotId);
+    
     // compute objective value
     virtual double objectiveValueAtTime(const int &timeSlotId);
     virtual double objectiveValueOverHorizon();
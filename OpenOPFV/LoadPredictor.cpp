@@ -59,7 +59,7 @@ ostream &operator<<(ostream &cout, const LoadPredictor &loadPredictor) {
 
 // make prediction for "control", using data from "futureData"
 // prediction starts from "startTime" and lasts for "predictionWindow"
-// each time slot is of length "slowControlPeriod"
+// data is sampled every "slowControlPeriod", and averaged over every slot of "control"
 void LoadPredictor::makePrediction(NetworkControl *control,
                                    FutureData *futureData,
                                    const time_type &startTimeInMinutes,
@@ -80,11 +80,19 @@ void LoadPredictor::makePrediction(NetworkControl *control,
                     time_type time = startTimeInMinutes;
                     int timeSlotId = 0;
                     while (timeSlotId < load->_valueArray.size()) {
-                        BaseLoadData *data = (BaseLoadData *) futureData->fetchFutureDataForLoad(name, type, time);
-                        load->_valueArray[timeSlotId] = data->_loadValue;
-                        delete data;
+                        int numberOfSamples = numberOfSamplesInSlot(control, timeSlotId, slowControlPeriodInMinutes);
+                        for (int sampleId = 0; sampleId < numberOfSamples; sampleId ++) {
+                            BaseLoadData *data = (BaseLoadData *) futureData->fetchFutureDataForLoad(name, type, time + sampleId * slowControlPeriodInMinutes);
+                            if (sampleId == 0)
+                                load->_valueArray[timeSlotId] = data->_loadValue;
+                            else
+                                load->_valueArray[timeSlotId] += data->_loadValue;
+                            delete data;
+                        }
+                        if (numberOfSamples > 1)
+                            load->_valueArray[timeSlotId] = load->_valueArray[timeSlotId] / numberOfSamples;
+                        time += control->slotLengthInMinutes(timeSlotId);
                         timeSlotId ++;
-                        time += slowControlPeriodInMinutes;
                     }
                     break;
                 }
@@ -94,12 +102,17 @@ void LoadPredictor::makePrediction(NetworkControl *control,
                     time_type time = startTimeInMinutes;
                     int timeSlotId = 0;
                     while (timeSlotId < load->_valueArray.size()) {
-                        PhotoVoltaicData *data = (PhotoVoltaicData *) futureData->fetchFutureDataForLoad(name, type, time);
+                        int numberOfSamples = numberOfSamplesInSlot(control, timeSlotId, slowControlPeriodInMinutes);
+                        double realPower = 0.0;
+                        for (int sampleId = 0; sampleId < numberOfSamples; sampleId ++) {
+                            PhotoVoltaicData *data = (PhotoVoltaicData *) futureData->fetchFutureDataForLoad(name, type, time + sampleId * slowControlPeriodInMinutes);
+                            realPower += data->_realPower;
+                            delete data;
+                        }
                         load->_valueArray[timeSlotId].reset();
-                        load->_valueArray[timeSlotId]._power[0] = - data->_realPower;
-                        delete data;
+                        load->_valueArray[timeSlotId]._power[0] = - realPower / numberOfSamples;
+                        time += control->slotLengthInMinutes(timeSlotId);
                         timeSlotId ++;
-                        time += slowControlPeriodInMinutes;
                     }
                     break;
                 }
@@ -111,20 +124,21 @@ void LoadPredictor::makePrediction(NetworkControl *control,
                     time_type time = startTimeInMinutes;
                     int timeSlotId = 0;
                     while (timeSlotId < load->_valueArray.size()) {
+                        time_type slotLengthInMinutes = control->slotLengthInMinutes(timeSlotId);
                         load->_valueArray[timeSlotId].reset();
                         if (time >= ev->_plugInTime &&
                             time <= ev->_deadline) {
-                            double fullRate = capacity * 60 / slowControlPeriodInMinutes;
+                            double fullRate = capacity * 60 / slotLengthInMinutes;
                             if (fullRate < ev->_maxChargingRate)
                                 load->_valueArray[timeSlotId]._power[0] = fullRate;
                             else
                                 load->_valueArray[timeSlotId]._power[0] = ev->_maxChargingRate;
-                            capacity -= load->_valueArray[timeSlotId]._power[0].real() * slowControlPeriodInMinutes / 60.0;
+                            capacity -= load->_valueArray[timeSlotId]._power[0].real() * slotLengthInMinutes / 60.0;
                             if (capacity < 0.0)
                                 capacity = 0.0;
                         }
                         timeSlotId ++;
-                        time += slowControlPeriodInMinutes;
+                        time += slotLengthInMinutes;
                     }
                     break;
                 }
@@ -134,3 +148,11 @@ void LoadPredictor::makePrediction(NetworkControl *control,
         }
     }
 }
+
+// number of data samples every "slowControlPeriod" in a slot of "control", at least 1
+int LoadPredictor::numberOfSamplesInSlot(NetworkControl *control,
+                                         const int &timeSlotId,
+                                         const time_type &slowControlPeriodInMinutes) {
+    int result = int( control->slotLengthInMinutes(timeSlotId) / slowControlPeriodInMinutes + 0.5 );
+    return result < 1 ? 1 : result;
+}
@@ -56,11 +56,17 @@ public:
     
     // make prediction for "control", using data from "futureData"
     // prediction starts from "startTime" and lasts for "predictionWindow"
-    // each time slot is of length "slowControlPeriod"
+    // data is sampled every "slowControlPeriod", and averaged over every slot of "control"
     void makePrediction(NetworkControl *control,
                         FutureData *futureData,
                         const time_type &startTimeInMinutes,
                         const time_type &slowControlPeriodInMinutes);
+    
+private:
+    // number of data samples every "slowControlPeriod" in a slot of "control", at least 1
+    static int numberOfSamplesInSlot(NetworkControl *control,
+                                     const int &timeSlotId,
+                                     const time_type &slowControlPeriodInMinutes);
 };
 
 #endif /* defined(__OptimalPowerFlowVisualization__LoadPredictor__) */
@@ -17,6 +17,8 @@
  *
  ***********************************************************************/
 
+#include <algorithm>
+#include <sstream>
 #include "NetworkControl.h"
 #include "PhotoVoltaicController.h"
 #include "ElectricVehicleController.h"
@@ -30,6 +32,50 @@ NetworkControl::NetworkControl() {
     _substationVoltage = 1.0;
     _quadCoef = 1.0;
     _linCoef = 0.0;
+    _fuseGradientWithPowerFlow = false;
+    _checkNewtonSteps = false;
+    _fastControlDeadlineInSeconds = 0.0;
+    _fastControlDeadlineHit = false;
+    _voltVarFallback = false;
+    _voltVarFallbacks = 0;
+    _fastControlLoadTrigger = 0.0;
+    _fastControlVoltageTrigger = 0.0;
+    _fastControlSkipped = false;
+    _skippedFastControls = 0;
+    _numberOfAreas = 0;
+    _areaIterationsPerRound = 1;
+    _boundaryPenalty = 0.0;
+    _boundaryMismatch = 0.0;
+    _numberOfStepSizeCandidates = 1;
+    _predictStepSize = false;
+    _admmPenalty = 1.0;
+    _admmMaxIterations = 50;
+    _admmTolerance = 1e-2;
+    _slowControlMethod = PROJECTED_GRADIENT;
+    _fastControlMethod = PROJECTED_GRADIENT;
+    _slowControlIterations = 0;
+    _powerFlowEvaluations = 0;
+    _lineSearchBacktracks = 0;
+    _targetGap = 0.0;
+    _muReductionFactor = 0.1;
+    _muReductionExponent = 1.5;
+    _warmStartSlowControl = false;
+    _warmStartTime = -1.0;
+    _warmStartMu = 0.0;
+    _warmStarted = false;
+    _handOffSlowControlPlan = false;
+    _planStartTime = -1.0;
+    _planEndTime = -1.0;
+    _planMu = 0.0;
+    _handedOff = false;
+    _useSolutionCache = false;
+    _fingerprintLength = 4;
+    _cacheHit = false;
+    _cacheIterations = 0;
+    _numberOfThreads = int( std::thread::hardware_concurrency() );
+    if (_numberOfThreads < 1)
+        _numberOfThreads = 1;
+    _threadPool = NULL;
 }
 
 // copy constructor
@@ -41,14 +87,88 @@ _enabledInFastControl(control._enabledInFastControl),
 _enabledInSlowControl(control._enabledInSlowControl),
 _numberOfSlots(control._numberOfSlots),
 _slotLengthInMinutes(control._slotLengthInMinutes),
+_slotLengthsInMinutes(control._slotLengthsInMinutes),
 _quadCoef(control._quadCoef),
 _linCoef(control._linCoef),
+_slowControlMethod(control._slowControlMethod),
+_fastControlMethod(control._fastControlMethod),
 _busPhaseIndicesInRoot(control._busPhaseIndicesInRoot),
+_voltageSensitivity(control._voltageSensitivity),
+_kktSolver(control._kktSolver),
+_checkNewtonSteps(control._checkNewtonSteps),
+_chargingRateProjection(control._chargingRateProjection),
+_enabledBesideFleet(control._enabledBesideFleet),
 _muLower(control._muLower),
 _muUpper(control._muUpper),
 _stepSize(control._stepSize),
 _oldObjectiveValue(control._oldObjectiveValue),
-_substationVoltage(control._substationVoltage) {
+_slowControlIterations(control._slowControlIterations),
+_powerFlowEvaluations(control._powerFlowEvaluations.load()),
+_lineSearchBacktracks(control._lineSearchBacktracks.load()),
+_substationVoltage(control._substationVoltage),
+_fuseGradientWithPowerFlow(control._fuseGradientWithPowerFlow),
+_fastControlDeadlineInSeconds(control._fastControlDeadlineInSeconds),
+_fastControlStartTime(control._fastControlStartTime),
+_fastControlDeadlineHit(control._fastControlDeadlineHit),
+_voltVarFallback(control._voltVarFallback),
+_voltVarDroop(control._voltVarDroop),
+_voltVarFallbacks(control._voltVarFallbacks),
+_targetGap(control._targetGap),
+_muReductionFactor(control._muReductionFactor),
+_muReductionExponent(control._muReductionExponent),
+_warmStartSlowControl(control._warmStartSlowControl),
+_warmStartTime(control._warmStartTime),
+_warmStartMu(control._warmStartMu),
+_warmStartVoltages(control._warmStartVoltages),
+_warmStarted(control._warmStarted),
+_handOffSlowControlPlan(control._handOffSlowControlPlan),
+_planStartTime(control._planStartTime),
+_planEndTime(control._planEndTime),
+_planMu(control._planMu),
+_plannedSetPoints(control._plannedSetPoints),
+_plannedPrices(control._plannedPrices),
+_handedOff(control._handedOff),
+_useSolutionCache(control._useSolutionCache),
+_solutionCache(control._solutionCache),
+_fingerprintLength(control._fingerprintLength),
+_cacheKey(control._cacheKey),
+_cacheFingerprint(control._cacheFingerprint),
+_cacheHit(control._cacheHit),
+_cacheIterations(control._cacheIterations),
+_admmPenalty(control._admmPenalty),
+_admmMaxIterations(control._admmMaxIterations),
+_admmTolerance(control._admmTolerance),
+_numberOfAreas(control._numberOfAreas),
+_areaIterationsPerRound(control._areaIterationsPerRound),
+_areaBusIds(control._areaBusIds),
+_areaRootIds(control._areaRootIds),
+_coordinatorBusIds(control._coordinatorBusIds),
+_boundaryMarginalPrice(control._boundaryMarginalPrice),
+_boundaryPenalty(control._boundaryPenalty),
+_areaBoundaryPowers(control._areaBoundaryPowers),
+_boundaryMismatch(control._boundaryMismatch),
+_numberOfStepSizeCandidates(control._numberOfStepSizeCandidates),
+_stepSizeReplicas(control._stepSizeReplicas),
+_stepSizeCandidates(control._stepSizeCandidates),
+_stepSizeEvaluations(control._stepSizeEvaluations),
+_predictStepSize(control._predictStepSize),
+_predictedInjections(control._predictedInjections),
+_predictedVoltageChanges(control._predictedVoltageChanges),
+_phaseOneResiduals(control._phaseOneResiduals),
+_phaseOnePrices(control._phaseOnePrices),
+_numberOfThreads(control._numberOfThreads),
+_threadPool(control._threadPool),
+_marginalPriceBuffers(control._marginalPriceBuffers),
+_priceBuffers(control._priceBuffers),
+_fastControlLoadTrigger(control._fastControlLoadTrigger),
+_fastControlVoltageTrigger(control._fastControlVoltageTrigger),
+_triggerLoadValues(control._triggerLoadValues),
+_triggerSetPoints(control._triggerSetPoints),
+_triggerVoltages(control._triggerVoltages),
+_fastControlSkipped(control._fastControlSkipped),
+_skippedFastControls(control._skippedFastControls),
+_voltageViolations(control._voltageViolations),
+_telemetry(control._telemetry) {
 }
 
 // clear allocated spaces
@@ -67,6 +187,36 @@ void NetworkControl::clear() {
     _enabledInSlowControl.clear();
     
     _busPhaseIndicesInRoot.clear();
+    _voltageSensitivity.clear();
+    _kktSolver.clear();
+    _chargingRateProjection.clear();
+    
+    _warmStartTime = -1.0;
+    _warmStartVoltages.clear();
+    
+    _planStartTime = -1.0;
+    _plannedSetPoints.clear();
+    _plannedPrices.clear();
+    
+    _triggerLoadValues.clear();
+    _triggerSetPoints.clear();
+    _triggerVoltages.clear();
+    
+    _areaBusIds.clear();
+    _areaRootIds.clear();
+    _coordinatorBusIds.clear();
+    _areaBoundaryPowers.clear();
+    
+    for (int replicaId = 0; replicaId < _stepSizeReplicas.size(); replicaId ++)
+        delete _stepSizeReplicas[replicaId];
+    _stepSizeReplicas.clear();
+    _stepSizeCandidates.clear();
+    _stepSizeEvaluations.clear();
+    
+    delete _threadPool;
+    _threadPool = NULL;
+    _marginalPriceBuffers.clear();
+    _priceBuffers.clear();
 }
 
 // deconstructor
@@ -83,14 +233,88 @@ void NetworkControl::operator=(const NetworkControl &control) {
     _enabledInSlowControl = control._enabledInSlowControl;
     _numberOfSlots = control._numberOfSlots;
     _slotLengthInMinutes = control._slotLengthInMinutes;
+    _slotLengthsInMinutes = control._slotLengthsInMinutes;
     _quadCoef = control._quadCoef;
     _linCoef = control._linCoef;
+    _slowControlMethod = control._slowControlMethod;
+    _fastControlMethod = control._fastControlMethod;
     _busPhaseIndicesInRoot = control._busPhaseIndicesInRoot;
+    _voltageSensitivity = control._voltageSensitivity;
+    _kktSolver = control._kktSolver;
+    _checkNewtonSteps = control._checkNewtonSteps;
+    _chargingRateProjection = control._chargingRateProjection;
+    _enabledBesideFleet = control._enabledBesideFleet;
     _muLower = control._muLower;
     _muUpper = control._muUpper;
     _stepSize = control._stepSize;
     _oldObjectiveValue = control._oldObjectiveValue;
+    _slowControlIterations = control._slowControlIterations;
+    _powerFlowEvaluations = control._powerFlowEvaluations.load();
+    _lineSearchBacktracks = control._lineSearchBacktracks.load();
     _substationVoltage = control._substationVoltage;
+    _fuseGradientWithPowerFlow = control._fuseGradientWithPowerFlow;
+    _fastControlDeadlineInSeconds = control._fastControlDeadlineInSeconds;
+    _fastControlStartTime = control._fastControlStartTime;
+    _fastControlDeadlineHit = control._fastControlDeadlineHit;
+    _voltVarFallback = control._voltVarFallback;
+    _voltVarDroop = control._voltVarDroop;
+    _voltVarFallbacks = control._voltVarFallbacks;
+    _fastControlLoadTrigger = control._fastControlLoadTrigger;
+    _fastControlVoltageTrigger = control._fastControlVoltageTrigger;
+    _triggerLoadValues = control._triggerLoadValues;
+    _triggerSetPoints = control._triggerSetPoints;
+    _triggerVoltages = control._triggerVoltages;
+    _fastControlSkipped = control._fastControlSkipped;
+    _skippedFastControls = control._skippedFastControls;
+    _targetGap = control._targetGap;
+    _muReductionFactor = control._muReductionFactor;
+    _muReductionExponent = control._muReductionExponent;
+    _warmStartSlowControl = control._warmStartSlowControl;
+    _numberOfAreas = control._numberOfAreas;
+    _areaIterationsPerRound = control._areaIterationsPerRound;
+    _areaBusIds = control._areaBusIds;
+    _areaRootIds = control._areaRootIds;
+    _coordinatorBusIds = control._coordinatorBusIds;
+    _boundaryMarginalPrice = control._boundaryMarginalPrice;
+    _boundaryPenalty = control._boundaryPenalty;
+    _areaBoundaryPowers = control._areaBoundaryPowers;
+    _boundaryMismatch = control._boundaryMismatch;
+    _numberOfStepSizeCandidates = control._numberOfStepSizeCandidates;
+    _stepSizeReplicas = control._stepSizeReplicas;
+    _stepSizeCandidates = control._stepSizeCandidates;
+    _stepSizeEvaluations = control._stepSizeEvaluations;
+    _predictStepSize = control._predictStepSize;
+    _predictedInjections = control._predictedInjections;
+    _predictedVoltageChanges = control._predictedVoltageChanges;
+    _phaseOneResiduals = control._phaseOneResiduals;
+    _phaseOnePrices = control._phaseOnePrices;
+    _admmPenalty = control._admmPenalty;
+    _admmMaxIterations = control._admmMaxIterations;
+    _admmTolerance = control._admmTolerance;
+    _warmStartTime = control._warmStartTime;
+    _warmStartMu = control._warmStartMu;
+    _warmStartVoltages = control._warmStartVoltages;
+    _warmStarted = control._warmStarted;
+    _handOffSlowControlPlan = control._handOffSlowControlPlan;
+    _planStartTime = control._planStartTime;
+    _planEndTime = control._planEndTime;
+    _planMu = control._planMu;
+    _plannedSetPoints = control._plannedSetPoints;
+    _plannedPrices = control._plannedPrices;
+    _handedOff = control._handedOff;
+    _useSolutionCache = control._useSolutionCache;
+    _solutionCache = control._solutionCache;
+    _fingerprintLength = control._fingerprintLength;
+    _cacheKey = control._cacheKey;
+    _cacheFingerprint = control._cacheFingerprint;
+    _cacheHit = control._cacheHit;
+    _cacheIterations = control._cacheIterations;
+    _numberOfThreads = control._numberOfThreads;
+    _threadPool = control._threadPool;
+    _marginalPriceBuffers = control._marginalPriceBuffers;
+    _priceBuffers = control._priceBuffers;
+    _voltageViolations = control._voltageViolations;
+    _telemetry = control._telemetry;
 }
 
 // print
@@ -329,6 +553,15 @@ void NetworkControl::printViolatedVoltages(ostream &cout) {
 // must be called before running initalize(model)
 void NetworkControl::setNumberOfSlots(int numberOfSlots) {
     _numberOfSlots = numberOfSlots;
+    _slotLengthsInMinutes.clear();
+}
+
+// set numberOfSlots and the length of every slot
+void NetworkControl::setSlotLengths(const vector<time_type> &slotLengthsInMinutes) {
+    _numberOfSlots = int( slotLengthsInMinutes.size() );
+    _slotLengthsInMinutes = slotLengthsInMinutes;
+    if ( ! _slotLengthsInMinutes.empty() )
+        _slotLengthInMinutes = _slotLengthsInMinutes[0];
 }
 
 // set substation voltage
@@ -336,6 +569,118 @@ void NetworkControl::setSubstationVoltage(const double &substationVoltage) {
     _substationVoltage = substationVoltage;
 }
 
+// set number of threads used over the horizon
+void NetworkControl::setNumberOfThreads(int numberOfThreads) {
+    if (numberOfThreads < 1)
+        numberOfThreads = 1;
+    if (_threadPool != NULL && numberOfThreads == _numberOfThreads)
+        return;
+    _numberOfThreads = numberOfThreads;
+    if (_threadPool != NULL) {
+        delete _threadPool;
+        _threadPool = new ThreadPool(_numberOfThreads);
+        initGradientBuffers();
+    }
+}
+
+// set whether the gradient reuses the power flow backward sweep
+void NetworkControl::setFuseGradientWithPowerFlow(bool fuseGradientWithPowerFlow) {
+    _fuseGradientWithPowerFlow = fuseGradientWithPowerFlow;
+}
+
+// set method used in the inner loop of slow control
+void NetworkControl::setSlowControlMethod(InnerLoopMethod method) {
+    _slowControlMethod = method;
+}
+
+// set method used in the inner loop of fast control
+void NetworkControl::setFastControlMethod(InnerLoopMethod method) {
+    _fastControlMethod = method;
+}
+
+// set whether Newton steps are checked against a dense solve
+void NetworkControl::setCheckNewtonSteps(bool checkNewtonSteps) {
+    _checkNewtonSteps = checkNewtonSteps;
+}
+
+// set number of areas fast control is decomposed into
+void NetworkControl::setNumberOfAreas(int numberOfAreas, int areaIterationsPerRound) {
+    _numberOfAreas = numberOfAreas < 0 ? 0 : numberOfAreas;
+    _areaIterationsPerRound = areaIterationsPerRound < 1 ? 1 : areaIterationsPerRound;
+    if ( ! _buses.empty() )
+        partitionNetwork();
+}
+
+// set number of step sizes tried at once in the line search of slow control
+void NetworkControl::setNumberOfStepSizeCandidates(int numberOfCandidates) {
+    _numberOfStepSizeCandidates = numberOfCandidates < 1 ? 1 : numberOfCandidates;
+    _stepSizeCandidates.clear();
+    _stepSizeEvaluations.clear();
+}
+
+// set whether line searches start from the predicted step size
+void NetworkControl::setPredictStepSize(bool predictStepSize) {
+    _predictStepSize = predictStepSize;
+}
+
+// set parameters of ADMM_TEMPORAL_DECOMPOSITION
+void NetworkControl::setAdmmParameters(double penalty, int maxIterations, double tolerance) {
+    _admmPenalty = penalty;
+    _admmMaxIterations = maxIterations;
+    _admmTolerance = tolerance;
+}
+
+// set adaptive barrier continuation
+void NetworkControl::setBarrierContinuation(double targetGap, double reductionFactor, double reductionExponent) {
+    _targetGap = targetGap;
+    _muReductionFactor = reductionFactor;
+    _muReductionExponent = reductionExponent;
+}
+
+// set whether slow control starts from the last solution shifted in time
+void NetworkControl::setWarmStartSlowControl(bool warmStartSlowControl) {
+    _warmStartSlowControl = warmStartSlowControl;
+    _warmStartTime = -1.0;
+}
+
+// set whether fast control inside the first slot of the last slow control starts from its plan
+void NetworkControl::setHandOffSlowControlPlan(bool handOffSlowControlPlan) {
+    _handOffSlowControlPlan = handOffSlowControlPlan;
+    _planStartTime = -1.0;
+}
+
+// set whether slow control starts from the nearest solution at the same time of past days
+void NetworkControl::setSolutionCache(bool useSolutionCache, const string &fileName) {
+    _useSolutionCache = useSolutionCache;
+    if (_useSolutionCache)
+        _solutionCache.open(fileName);
+    else
+        _solutionCache.clear();
+}
+
+// set wall clock budget of fast control
+void NetworkControl::setFastControlDeadlineInSeconds(double deadlineInSeconds) {
+    _fastControlDeadlineInSeconds = deadlineInSeconds;
+}
+
+// set whether PV follow Volt/VAR droop curves when fast control hits the deadline
+void NetworkControl::setVoltVarFallback(bool voltVarFallback) {
+    _voltVarFallback = voltVarFallback;
+    _voltVarFallbacks = 0;
+    _voltVarDroop.clear();
+}
+
+// set the changes since the last solve that trigger fast control
+void NetworkControl::setFastControlTrigger(double loadChange, double voltageChange) {
+    _fastControlLoadTrigger = loadChange;
+    _fastControlVoltageTrigger = voltageChange;
+    _triggerLoadValues.clear();
+    _triggerSetPoints.clear();
+    _triggerVoltages.clear();
+    _fastControlSkipped = false;
+    _skippedFastControls = 0;
+}
+
 // initialize networkControl according to networkModel
 void NetworkControl::initialize(const NetworkModel &model) {
     // set up network description
@@ -372,6 +717,16 @@ void NetworkControl::initialize(const NetworkModel &model) {
         }
         _busPhaseIndicesInRoot.push_back(phaseLoc);
     }
+    
+    // set up voltage sensitivities
+    _voltageSensitivity.initialize(_buses, _busPhaseIndicesInRoot);
+    _kktSolver.initialize(_voltageSensitivity);
+    partitionNetwork();
+    
+    // set up parallel computation
+    if (_threadPool == NULL)
+        _threadPool = new ThreadPool(_numberOfThreads);
+    initGradientBuffers();
 }
 
 // add a bus
@@ -430,12 +785,28 @@ void NetworkControl::addALoad(Load *load) {
     BusController *bus = _busToControllerHashTable[load->locationBus()];
     control->_locationBus = bus;
     bus->addALoad(control);
+    if ( ! _slotLengthsInMinutes.empty() ) {
+        for (int timeSlotId = 0; timeSlotId < _numberOfSlots; timeSlotId ++)
+            control->_slotWeights.push_back(slotWeight(timeSlotId));
+    }
+    
+    // the kept state no longer lines up with the loads
+    _triggerLoadValues.clear();
+    _triggerSetPoints.clear();
+    _plannedSetPoints.clear();
+    _voltVarDroop.clear();
+    _chargingRateProjection.clear();
 }
 
 // delete a load
 void NetworkControl::deleteALoad(Load *load) {
     BusController *bus = _busToControllerHashTable[load->locationBus()];
     bus->deleteALoad(load);
+    _triggerLoadValues.clear();
+    _triggerSetPoints.clear();
+    _plannedSetPoints.clear();
+    _voltVarDroop.clear();
+    _chargingRateProjection.clear();
 }
 
 
@@ -444,17 +815,87 @@ void NetworkControl::deleteALoad(Load *load) {
  ******************************/
 
 // do fast control
-void NetworkControl::fastControl() {
+void NetworkControl::fastControl(time_type time) {
+    _powerFlowEvaluations = 0;
+    _lineSearchBacktracks = 0;
+    _telemetry.clear();
+    _telemetry._numberOfSolves = 1;
+    _fastControlStartTime = std::chrono::steady_clock::now();
+    _fastControlDeadlineHit = false;
+    _fastControlSkipped = false;
+    
+    // event triggered, start from the last set-points, or keep them if nothing moved
+    if (_fastControlLoadTrigger > 0.0) {
+        _fastControlSkipped = fastControlStateUnchanged();
+        if (_fastControlSkipped)
+            _skippedFastControls ++;
+        else
+            saveFastControlLoadValues();
+        holdFastControlSetPoints();
+        if (_fastControlSkipped) {
+            _telemetry._initializeSeconds = SolverTelemetry::secondsSince(_fastControlStartTime);
+            return;
+        }
+    }
+    
+    _handedOff = planCoversTime(time);
     fastControlInitialize();
+    if (_handedOff)
+        startFastControlFromPlan();
+    _telemetry._initializeSeconds = SolverTelemetry::secondsSince(_fastControlStartTime);
     fastControlOuterLoop();
+    std::chrono::steady_clock::time_point finalizeStartTime = std::chrono::steady_clock::now();
+    if (_handedOff)
+        finishFastControlFromPlan();
+    if (_voltVarFallback && _fastControlDeadlineHit)
+        fallBackToVoltVarDroop();
+    else if (_voltVarFallback)
+        fitVoltVarDroop();
     applyControl();
+    if (_fastControlLoadTrigger > 0.0)
+        saveFastControlSetPoints();
+    _telemetry._finalizeSeconds = SolverTelemetry::secondsSince(finalizeStartTime);
+    _telemetry._powerFlowEvaluations = _powerFlowEvaluations;
+    _telemetry._lineSearchBacktracks = _lineSearchBacktracks;
+}
+
+// check the fast control deadline
+bool NetworkControl::fastControlDeadlinePassed() {
+    if (_fastControlDeadlineInSeconds <= 0.0)
+        return false;
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - _fastControlStartTime;
+    if (elapsed.count() >= _fastControlDeadlineInSeconds)
+        _fastControlDeadlineHit = true;
+    return _fastControlDeadlineHit;
 }
 
 // do slow control
 void NetworkControl::slowControl(time_type time) {
+    _powerFlowEvaluations = 0;
+    _lineSearchBacktracks = 0;
+    _telemetry.clear();
+    _telemetry._numberOfSolves = 1;
+    std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
     slowControlInitialize(time);
+    _telemetry._initializeSeconds = SolverTelemetry::secondsSince(startTime);
     slowControlOuterLoop();
+    std::chrono::steady_clock::time_point finalizeStartTime = std::chrono::steady_clock::now();
+    if (_useSolutionCache) {
+        int iterations = _telemetry.innerIterations() + _telemetry._feasibilityIterations;
+        if (_cacheHit)
+            _telemetry._cacheIterationsSaved = _cacheIterations - iterations;
+        storeInSolutionCache(_cacheHit ? _cacheIterations : iterations);
+    }
+    if (_warmStartSlowControl)
+        saveWarmStart(time);
+    if (_handOffSlowControlPlan)
+        savePlanForFastControl(time);
+    if (_voltVarFallback)
+        fitVoltVarDroop();
     applyControl();
+    _telemetry._finalizeSeconds = SolverTelemetry::secondsSince(finalizeStartTime);
+    _telemetry._powerFlowEvaluations = _powerFlowEvaluations;
+    _telemetry._lineSearchBacktracks = _lineSearchBacktracks;
     // printSlowControlResult(std::cout);
 }
 
@@ -471,6 +912,48 @@ void NetworkControl::applyControl() {
 }
 
 
+/******************************
+ time slots
+ ******************************/
+
+time_type NetworkControl::slotLengthInMinutes(int timeSlotId) const {
+    if (_slotLengthsInMinutes.empty())
+        return _slotLengthInMinutes;
+    return _slotLengthsInMinutes[timeSlotId];
+}
+
+time_type NetworkControl::slotStartInMinutes(int timeSlotId) const {
+    if (_slotLengthsInMinutes.empty())
+        return _slotLengthInMinutes * timeSlotId;
+    time_type result = 0.0;
+    for (int slotId = 0; slotId < timeSlotId; slotId ++)
+        result += _slotLengthsInMinutes[slotId];
+    return result;
+}
+
+// slot that covers an offset from the start of the horizon
+// past the horizon, slots go on at the length of the last slot
+int NetworkControl::slotIdAtTime(time_type offsetInMinutes) const {
+    if (offsetInMinutes <= 0.0)
+        return 0;
+    if (_slotLengthsInMinutes.empty())
+        return int( offsetInMinutes / _slotLengthInMinutes );
+    int timeSlotId = 0;
+    while (timeSlotId < _numberOfSlots - 1 && offsetInMinutes >= _slotLengthsInMinutes[timeSlotId]) {
+        offsetInMinutes -= _slotLengthsInMinutes[timeSlotId];
+        timeSlotId ++;
+    }
+    return timeSlotId + int( offsetInMinutes / _slotLengthsInMinutes[timeSlotId] );
+}
+
+// weight of the cost of a slot
+double NetworkControl::slotWeight(int timeSlotId) const {
+    if (_slotLengthsInMinutes.empty())
+        return 1.0;
+    return _slotLengthsInMinutes[timeSlotId] / _slotLengthsInMinutes[0];
+}
+
+
 /******************************
  power flow computation
  ******************************/
@@ -504,6 +987,8 @@ void NetworkControl::initVoltageOverHorizon() {
 void NetworkControl::computePowerFlowAtTime(int timeSlotId,
                                             const int &maxIteration,
                                             const double &updateSizeThreshold) {
+    _powerFlowEvaluations ++;
+    
     // initialize voltage if necessary
     if (_buses[0]->_voltages[timeSlotId][0].real() < 0.5)
         initVoltageAtTime(timeSlotId);
@@ -513,14 +998,31 @@ void NetworkControl::computePowerFlowAtTime(int timeSlotId,
         _buses[busId]->computeAggregateLoadOnSelfAtTime(timeSlotId);
     }
     
+    solvePowerFlowAtTime(timeSlotId, maxIteration, updateSizeThreshold);
+}
+
+void NetworkControl::computePowerFlowOverHorizon(const int &maxIteration,
+                                                 const double &updateSizeThreshold) {
+    for (int timeSlotId = 0; timeSlotId < _numberOfSlots; timeSlotId ++) {
+        computePowerFlowAtTime(timeSlotId, maxIteration, updateSizeThreshold);
+    }
+}
+
+// backward-forward sweep with the aggregate loads as they are
+void NetworkControl::solvePowerFlowAtTime(int timeSlotId,
+                                          const int &maxIteration,
+                                          const double &updateSizeThreshold) {
     // doing backward-forward sweep until maxIteration hit or updateSize small
     int iteration = 0;
     double updateSize = updateSizeThreshold + 1.0;
     while (iteration < maxIteration && updateSize >= updateSizeThreshold) {
         updateSize = 0.0;
         // backward sweep to update currents
+        // if fused, also accumulate the parts of sumDown, and the last iteration leaves them for the gradient
         for (int busId = int( _buses.size() - 1 ); busId > 0; busId --) {
-            double updateSizeTmp = _buses[busId]->computeCurrentOnFromLineAtTime(timeSlotId);
+            double updateSizeTmp = _fuseGradientWithPowerFlow ?
+                _buses[busId]->computeCurrentAndSumDownPartsAtTime(timeSlotId) :
+                _buses[busId]->computeCurrentOnFromLineAtTime(timeSlotId);
             if (updateSizeTmp > updateSize)
                 updateSize = updateSizeTmp;
         }
@@ -565,62 +1067,76 @@ void NetworkControl::computePowerFlowAtTime(int timeSlotId,
     substation->_aggregateLoads[timeSlotId] = loadValue;
 }
 
-void NetworkControl::computePowerFlowOverHorizon(const int &maxIteration,
-                                                 const double &updateSizeThreshold) {
-    for (int timeSlotId = 0; timeSlotId < _numberOfSlots; timeSlotId ++) {
-        computePowerFlowAtTime(timeSlotId, maxIteration, updateSizeThreshold);
-    }
-}
-
 
 /******************************
  gradient estimation
  ******************************/
 
+// allocate per-thread price buffers
+void NetworkControl::initGradientBuffers() {
+    int numberOfBus = int( _buses.size() );
+    int numberOfThreads = _threadPool == NULL ? 1 : _threadPool->_numberOfThreads;
+    int numberOfPhasesAtRoot = numberOfBus == 0 ? 0 : int( _buses[0]->_bus->phase().size() );
+    _marginalPriceBuffers.assign(numberOfThreads, vector<double>(numberOfPhasesAtRoot, 0.0));
+    _priceBuffers.assign(numberOfThreads, vector<vector<double>>(numberOfBus));
+    for (int threadId = 0; threadId < numberOfThreads; threadId ++) {
+        for (int busId = 0; busId < numberOfBus; busId ++) {
+            _priceBuffers[threadId][busId].assign(_busPhaseIndicesInRoot[busId].size(), 0.0);
+        }
+    }
+}
+
 // compute gradients
-void NetworkControl::computeGradientAtTime(int timeSlotId) {
+void NetworkControl::computeGradientAtTime(int timeSlotId, int threadId) {
     int numberOfBus = int( _buses.size() );
     
     // compute marginal price
     int numberOfPhasesAtRoot = int( _buses[0]->_bus->phase().size() );
-    vector<double> marginalPrice(numberOfPhasesAtRoot, 0.0);
+    vector<double> &marginalPrice = _marginalPriceBuffers[threadId];
+    double weight = slotWeight(timeSlotId);
     for (int phaseId = 0; phaseId < numberOfPhasesAtRoot; phaseId ++) {
-        marginalPrice[phaseId] = 2 * _quadCoef * _buses[0]->_aggregateLoads[timeSlotId]._power[phaseId].real() + _linCoef;
+        marginalPrice[phaseId] = weight * (2 * _quadCoef * _buses[0]->_aggregateLoads[timeSlotId]._power[phaseId].real() + _linCoef);
+    }
+    
+    // gather price at every bus from the root phases
+    vector<vector<double>> &prices = _priceBuffers[threadId];
+    for (int busId = 1; busId < numberOfBus; busId ++) {
+        const vector<int> &phaseIndicesInRoot = _busPhaseIndicesInRoot[busId];
+        vector<double> &price = prices[busId];
+        for (int phaseId = 0; phaseId < phaseIndicesInRoot.size(); phaseId ++) {
+            price[phaseId] = marginalPrice[phaseIndicesInRoot[phaseId]];
+        }
     }
     
     // backward sweep to compute sumDown
-    for (int busId = numberOfBus - 1; busId > 0; busId --) {
-        BusController *bus = _buses[busId];
-        int numberOfPhasesAtBus = int( bus->_phaseIndicesInParentBus.size() );
-        vector<double> price(numberOfPhasesAtBus, 0.0);
-        for (int phaseId = 0; phaseId < numberOfPhasesAtBus; phaseId ++) {
-            price[phaseId] = marginalPrice[_busPhaseIndicesInRoot[busId][phaseId]];
+    // not needed if the power flow sweep has accumulated its parts
+    if ( !_fuseGradientWithPowerFlow ) {
+        for (int busId = numberOfBus - 1; busId > 0; busId --) {
+            _buses[busId]->computeSumDownAtTime(_muLower, _muUpper, prices[busId], timeSlotId);
         }
-        _buses[busId]->computeSumDownAtTime(_muLower, _muUpper, price, timeSlotId);
     }
     
-    // forward sweep to compute sumUp
+    // forward sweep to compute sumUp and gradient
     _buses[0]->_sumUp[timeSlotId].reset();
     for (int busId = 1; busId < numberOfBus; busId ++) {
+        if (_fuseGradientWithPowerFlow)
+            _buses[busId]->computeSumDownFromPartsAtTime(_muLower, _muUpper, prices[busId], timeSlotId);
         _buses[busId]->computeSumUpAtTime(timeSlotId);
-    }
-    
-    // compute gradient
-    for (int busId = 1; busId < numberOfBus; busId ++) {
-        BusController *bus = _buses[busId];
-        int numberOfPhasesAtBus = int( bus->_phaseIndicesInParentBus.size() );
-        vector<double> price(numberOfPhasesAtBus, 0.0);
-        for (int phaseId = 0; phaseId < numberOfPhasesAtBus; phaseId ++) {
-            price[phaseId] = marginalPrice[_busPhaseIndicesInRoot[busId][phaseId]];
-        }
-        _buses[busId]->computeGradientAtTime(price, timeSlotId);
+        _buses[busId]->computeGradientAtTime(prices[busId], timeSlotId);
     }
 }
 
+// time slots only share read-only data, so they are computed in parallel
 void NetworkControl::computeGradientOverHorizon() {
-    for (int timeSlotId = 0; timeSlotId < _numberOfSlots; timeSlotId ++) {
-        computeGradientAtTime(timeSlotId);
+    if (_threadPool == NULL) {
+        for (int timeSlotId = 0; timeSlotId < _numberOfSlots; timeSlotId ++) {
+            computeGradientAtTime(timeSlotId);
+        }
+        return;
     }
+    _threadPool->parallelFor(0, _numberOfSlots, [this](int timeSlotId, int threadId) {
+        computeGradientAtTime(timeSlotId, threadId);
+    });
 }
 
 
@@ -636,8 +1152,32 @@ void NetworkControl::attemptPowerAtTime(const int &timeSlotId, unordered_set<Loa
 }
 
 void NetworkControl::attemptPowerOverHorizon(unordered_set<LoadType> &enabledInControl) {
+    if (enabledInControl.find(ELECTRIC_VEHICLE) == enabledInControl.end()) {
+        for (int busId = 1; busId < _buses.size(); busId ++)
+            _buses[busId]->attemptPowerOverHorizon(_stepSize, enabledInControl);
+        computePowerFlowOverHorizon();
+        return;
+    }
+    
+    // collect the fleet the first time, and after the loads change
+    if (_chargingRateProjection._offsets.empty()) {
+        vector<ElectricVehicleController *> devices;
+        for (int busId = 1; busId < _buses.size(); busId ++) {
+            const vector<LoadController *> &loads = _buses[busId]->_loadArray;
+            for (int loadId = 0; loadId < loads.size(); loadId ++) {
+                if (loads[loadId]->_load->type() == ELECTRIC_VEHICLE)
+                    devices.push_back( (ElectricVehicleController *)loads[loadId] );
+            }
+        }
+        _chargingRateProjection.initialize(devices);
+    }
+    _chargingRateProjection.attemptPowerOverHorizon(_stepSize);
+    
+    // then the other loads, which also sums the EV into the aggregate loads
+    _enabledBesideFleet = enabledInControl;
+    _enabledBesideFleet.erase(ELECTRIC_VEHICLE);
     for (int busId = 1; busId < _buses.size(); busId ++)
-        _buses[busId]->attemptPowerOverHorizon(_stepSize, enabledInControl);
+        _buses[busId]->attemptPowerOverHorizon(_stepSize, _enabledBesideFleet);
     computePowerFlowOverHorizon();
 }
 
@@ -667,35 +1207,83 @@ void NetworkControl::resetPowerOverHorizon(unordered_set<LoadType> &enabledInCon
     computePowerFlowOverHorizon();
 }
 
+// extrapolate power consumption by momentum from the last accepted iterate
+void NetworkControl::extrapolatePowerOverHorizon(const double &momentum, unordered_set<LoadType> &enabledInControl) {
+    for (int busId = 1; busId < _buses.size(); busId ++)
+        _buses[busId]->extrapolatePowerOverHorizon(momentum, enabledInControl);
+    if (momentum != 0.0)
+        computePowerFlowOverHorizon();
+    _buses[0]->_oldAggregateLoads = _buses[0]->_aggregateLoads;
+}
+
+// set power consumption to the last accepted iterate
+void NetworkControl::rollBackPowerOverHorizon(unordered_set<LoadType> &enabledInControl) {
+    for (int busId = 1; busId < _buses.size(); busId ++)
+        _buses[busId]->rollBackPowerOverHorizon(enabledInControl);
+    computePowerFlowOverHorizon();
+    _buses[0]->_oldAggregateLoads = _buses[0]->_aggregateLoads;
+}
+
 // check if there is voltage vilation
-bool NetworkControl::voltageViolationAtTime(const int &timeSlotId) const {
-    return _buses[0]->downstreamVoltageViolationAtTime(timeSlotId);
+// buses are sorted by breadth first search, so every check below is a linear pass over _buses
+// the first violation found is kept in _voltageViolations
+bool NetworkControl::voltageViolationAtTime(const int &timeSlotId) {
+    _voltageViolations.clear();
+    for (int busId = 0; busId < _buses.size(); busId ++) {
+        if (_buses[busId]->voltageViolationAtTime(timeSlotId, &_voltageViolations))
+            return true;
+    }
+    return false;
 }
 
-bool NetworkControl::voltageViolationOverHorizon() const {
-    for (int timeSlotId = 0; timeSlotId < _numberOfSlots; timeSlotId ++) {
-        if (voltageViolationAtTime(timeSlotId))
+bool NetworkControl::voltageViolationOverHorizon() {
+    _voltageViolations.clear();
+    for (int busId = 0; busId < _buses.size(); busId ++) {
+        if (_buses[busId]->voltageViolationOverHorizon(&_voltageViolations))
             return true;
     }
     return false;
 }
 
+// record every voltage violation in _voltageViolations
+int NetworkControl::collectVoltageViolationsAtTime(const int &timeSlotId) {
+    _voltageViolations.clear();
+    for (int busId = 0; busId < _buses.size(); busId ++) {
+        _buses[busId]->collectVoltageViolationsAtTime(timeSlotId, _voltageViolations);
+    }
+    return _voltageViolations.numberOfRecords();
+}
+
+int NetworkControl::collectVoltageViolationsOverHorizon() {
+    _voltageViolations.clear();
+    for (int busId = 0; busId < _buses.size(); busId ++) {
+        _buses[busId]->collectVoltageViolationsOverHorizon(_voltageViolations);
+    }
+    return _voltageViolations.numberOfRecords();
+}
+
 // compute objective value
 double NetworkControl::objectiveValueAtTime(const int &timeSlotId) const {
-    double result = _buses[0]->downstreamObjectiveValueAtTime(_muLower, _muUpper, timeSlotId);
+    double result = 0.0;
+    for (int busId = 0; busId < _buses.size(); busId ++) {
+        result += _buses[busId]->objectiveValueAtTime(_muLower, _muUpper, timeSlotId);
+    }
     for (int phaseId = 0; phaseId < _buses[0]->_bus->phase().size(); phaseId ++) {
         double power = _buses[0]->_aggregateLoads[timeSlotId]._power[phaseId].real();
-        result += _quadCoef * power * power + _linCoef * power;
+        result += slotWeight(timeSlotId) * (_quadCoef * power * power + _linCoef * power);
     }
     return result;
 }
 
 double NetworkControl::objectiveValueOverHorizon() const {
-    double result = _buses[0]->downstreamObjectiveValueOverHorizon(_muLower, _muUpper);
+    double result = 0.0;
+    for (int busId = 0; busId < _buses.size(); busId ++) {
+        result += _buses[busId]->objectiveValueOverHorizon(_muLower, _muUpper);
+    }
     for (int timeSlotId = 0; timeSlotId < _numberOfSlots; timeSlotId ++) {
         for (int phaseId = 0; phaseId < _buses[0]->_bus->phase().size(); phaseId ++) {
             double power = _buses[0]->_aggregateLoads[timeSlotId]._power[phaseId].real();
-            result += _quadCoef * power * power + _linCoef * power;
+            result += slotWeight(timeSlotId) * (_quadCoef * power * power + _linCoef * power);
         }
     }
     return result;
@@ -703,423 +1291,2167 @@ double NetworkControl::objectiveValueOverHorizon() const {
 
 // compute power update size
 double NetworkControl::updateSizeAtTime(const int &timeSlotId) const {
-    return _buses[0]->downstreamUpdateSizeAtTime(timeSlotId);
+    double result = 0.0;
+    for (int busId = 0; busId < _buses.size(); busId ++) {
+        double updateSize = _buses[busId]->updateSizeAtTime(timeSlotId);
+        if (result < updateSize)
+            result = updateSize;
+    }
+    return result;
 }
 
 double NetworkControl::updateSizeOverHorizon() const {
-    return _buses[0]->downstreamUpdateSizeOverHorizon();
+    double result = 0.0;
+    for (int busId = 0; busId < _buses.size(); busId ++) {
+        double updateSize = _buses[busId]->updateSizeOverHorizon();
+        if (result < updateSize)
+            result = updateSize;
+    }
+    return result;
 }
 
 // compute expected objective value change
 double NetworkControl::expectedObjectiveValueChangeAtTime(const int &timeSlotId) const {
-    return _buses[0]->downstreamExpectedObjectiveValueChangeAtTime(timeSlotId);
+    double result = 0.0;
+    for (int busId = 0; busId < _buses.size(); busId ++) {
+        result += _buses[busId]->expectedObjectiveValueChangeAtTime(timeSlotId);
+    }
+    return result;
 }
 
 double NetworkControl::expectedObjectiveValueChangeOverHorizon() const {
-    return _buses[0]->downstreamExpectedObjectiveValueChangeOverHorizon();
+    double result = 0.0;
+    for (int busId = 0; busId < _buses.size(); busId ++) {
+        result += _buses[busId]->expectedObjectiveValueChangeOverHorizon();
+    }
+    return result;
+}
+
+// compute all of the above in a single pass over the buses
+// objective value is not computed once a voltage violation is found, which is kept in _voltageViolations
+ControlEvaluation NetworkControl::evaluateAtTime(const int &timeSlotId) {
+    _voltageViolations.clear();
+    return evaluateAtTime(timeSlotId, &_voltageViolations);
+}
+
+ControlEvaluation NetworkControl::evaluateAtTime(const int &timeSlotId, VoltageViolationCollector *collector) const {
+    ControlEvaluation evaluation;
+    for (int busId = 0; busId < _buses.size(); busId ++) {
+        _buses[busId]->evaluateAtTime(_muLower, _muUpper, timeSlotId, evaluation, collector);
+        if (evaluation._voltageViolation)
+            return evaluation;
+    }
+    for (int phaseId = 0; phaseId < _buses[0]->_bus->phase().size(); phaseId ++) {
+        double power = _buses[0]->_aggregateLoads[timeSlotId]._power[phaseId].real();
+        evaluation._objectiveValue += slotWeight(timeSlotId) * (_quadCoef * power * power + _linCoef * power);
+    }
+    return evaluation;
+}
+
+ControlEvaluation NetworkControl::evaluateOverHorizon() {
+    ControlEvaluation evaluation;
+    _voltageViolations.clear();
+    for (int busId = 0; busId < _buses.size(); busId ++) {
+        _buses[busId]->evaluateOverHorizon(_muLower, _muUpper, evaluation, &_voltageViolations);
+        if (evaluation._voltageViolation)
+            return evaluation;
+    }
+    for (int timeSlotId = 0; timeSlotId < _numberOfSlots; timeSlotId ++) {
+        for (int phaseId = 0; phaseId < _buses[0]->_bus->phase().size(); phaseId ++) {
+            double power = _buses[0]->_aggregateLoads[timeSlotId]._power[phaseId].real();
+            evaluation._objectiveValue += slotWeight(timeSlotId) * (_quadCoef * power * power + _linCoef * power);
+        }
+    }
+    return evaluation;
 }
 
 
 /******************************
- solve the power flow problem
+ sensitivity predicted step size
  ******************************/
 
-// initialize algorithm variables for fast control
-void NetworkControl::fastControlInitialize() {
-    // read data from real network
-    // voltage
-    BusController *substation = _buses[0];
-    _substationVoltage = std::sqrt(std::norm(substation->_bus->voltage()[0]));
-    initVoltageAtTime(0);
-    
-    // loads
+// linearized change of voltage magnitudes from the accepted loads to the attempted ones
+void NetworkControl::predictVoltageChangesAtTime(int timeSlotId) {
+    int numberOfPhases = _voltageSensitivity._numberOfPhasesAtRoot;
+    _predictedInjections.assign(_buses.size() * numberOfPhases, complex_type(0.0, 0.0));
     for (int busId = 1; busId < _buses.size(); busId ++) {
-        vector<LoadController *> loads = _buses[busId]->_loadArray;
-        for (int loadId = 0; loadId < loads.size(); loadId ++) {
-            loads[loadId]->_valueArray[0] = loads[loadId]->_load->value();
-            loads[loadId]->_oldValueArray[0] = loads[loadId]->_load->value();
+        BusController *bus = _buses[busId];
+        const vector<int> &phaseIndicesInRoot = _busPhaseIndicesInRoot[busId];
+        for (int phaseId = 0; phaseId < phaseIndicesInRoot.size(); phaseId ++) {
+            _predictedInjections[busId * numberOfPhases + phaseIndicesInRoot[phaseId]] =
+                bus->_oldAggregateLoads[timeSlotId]._power[phaseId] - bus->_aggregateLoads[timeSlotId]._power[phaseId];
         }
-        _buses[busId]->computeAggregateLoadOnSelfAtTime(0);
-        _buses[busId]->_oldAggregateLoads[0] = _buses[busId]->_aggregateLoads[0];
     }
-    
-    // initialize substation oldAggregateLoads
-    computePowerFlowAtTime(0);
-    substation->_oldAggregateLoads[0] = substation->_aggregateLoads[0];
+    _voltageSensitivity.voltageChanges(_predictedInjections, _predictedVoltageChanges);
 }
 
-void NetworkControl::slowControlInitialize(time_type time) {
-    // read data from real network
-    // voltage
-    BusController *substation = _buses[0];
-    _substationVoltage = std::sqrt(std::norm(substation->_bus->voltage()[0]));
-    initVoltageOverHorizon();
+// largest fraction of the tentative step that keeps predicted voltages in range
+double NetworkControl::predictedStepFractionAtTime(int timeSlotId) {
+    int numberOfPhases = _voltageSensitivity._numberOfPhasesAtRoot;
+    predictVoltageChangesAtTime(timeSlotId);
     
-    // loads
+    // voltages move linearly along the step
+    double fraction = 1.0;
     for (int busId = 1; busId < _buses.size(); busId ++) {
         BusController *bus = _buses[busId];
-        for (int loadId = 0; loadId < bus->_loadArray.size(); loadId ++) {
-            LoadController *load = bus->_loadArray[loadId];
-            load->_oldValueArray = load->_valueArray;
-            if (load->_load->type() == ELECTRIC_VEHICLE) {
-                ElectricVehicleController *evController = (ElectricVehicleController *)load;
-                ElectricVehicle *ev = (ElectricVehicle *)(load->_load);
-                evController->_plugInTimeSlotId = int( (ev->_plugInTime - time) / evController->_slotLengthInMinutes );
-                if (evController->_plugInTimeSlotId < 0)
-                    evController->_plugInTimeSlotId = 0;
-                evController->_deadlineTimeSlotId = int( (ev->_deadline - time) / evController->_slotLengthInMinutes );
-                if (evController->_deadlineTimeSlotId < 0)
-                    evController->_deadlineTimeSlotId = 0;
-            }
+        if (! bus->_hasVoltageConstraint)
+            continue;
+        const vector<int> &phaseIndicesInRoot = _busPhaseIndicesInRoot[busId];
+        for (int phaseId = 0; phaseId < phaseIndicesInRoot.size(); phaseId ++) {
+            double change = _predictedVoltageChanges[busId * numberOfPhases + phaseIndicesInRoot[phaseId]];
+            double voltageMagnitude = std::sqrt( std::norm( bus->_voltages[timeSlotId]._data[phaseId] ) );
+            if (voltageMagnitude + change > bus->_voltageMax)
+                fraction = std::min(fraction, (bus->_voltageMax - voltageMagnitude) / change);
+            if (voltageMagnitude + change < bus->_voltageMin)
+                fraction = std::min(fraction, (bus->_voltageMin - voltageMagnitude) / change);
         }
-        _buses[busId]->computeAggregateLoadOnSelfOverHorizon();
-        _buses[busId]->_oldAggregateLoads = _buses[busId]->_aggregateLoads;
     }
-    
-    // initialize substation oldAggregateLoads
-    computePowerFlowOverHorizon();
-    substation->_oldAggregateLoads = substation->_aggregateLoads;
+    return std::max(fraction, 0.0);
 }
 
-// outer loop of the solver
-// in each iteration of the outer loop, use a different log-barrier function
-// return the computed objective value
-// muArray is an array of the mu values to be used in the inner loop, alpha is the backoff parameter, beta is the linearization quantification parameter, and epsilon is the threshold of power consumptions update
-double NetworkControl::fastControlOuterLoop(std::vector<double> muArray, double alpha, double beta, double epsilon) {
-    /******************************
-     get a feasible point
-     via optimizations
-     ******************************/
-    double voltageLowerBound = _buses.back()->_voltageMin;
-    double voltageUpperBound = _buses.back()->_voltageMax;
-    for (int iteration = 0; ; iteration ++) {
-        double voltageMin = _substationVoltage;
-        double voltageMax = _substationVoltage;
-        bool voltageViolation = false;
-        
-        // compute current voltageMin, voltageMax, and voltageViolation
-        for (int busId = 0; busId < _buses.size(); busId ++) {
-            if (! _buses[busId]->_hasVoltageConstraint)
-                continue;
-            BusController *bus = _buses[busId];
-            ColumnVector<complex_type> voltage = bus->_voltages[0];
-            for (int phaseId = 0; phaseId < voltage.size(); phaseId ++) {
-                double voltageMagnitude = std::sqrt(std::norm(voltage[phaseId]));
-                if ( voltageMagnitude > voltageMax )
-                    voltageMax = voltageMagnitude;
-                if ( voltageMagnitude < voltageMin )
-                    voltageMin = voltageMagnitude;
-            }
+// back off _stepSize until the predicted fraction is 1
+// the back offs needed for a fraction are taken at once, and projections of loads may need a few more rounds
+void NetworkControl::predictStepSizeAtTime(const int &timeSlotId, double alpha, unordered_set<LoadType> &enabledInControl) {
+    for (int round = 0; round < 32; round ++) {
+        for (int busId = 1; busId < _buses.size(); busId ++)
+            _buses[busId]->attemptPowerAtTime(_stepSize, timeSlotId, enabledInControl);
+        double fraction = predictedStepFractionAtTime(timeSlotId);
+        if (fraction >= 1.0)
+            return;
+        int backOffs = fraction > 0.0 ? int( std::ceil( std::log(fraction) / std::log(alpha) ) ) : 1;
+        _stepSize *= std::pow(alpha, std::max(backOffs, 1));
+    }
+}
+
+void NetworkControl::predictStepSizeOverHorizon(double alpha, unordered_set<LoadType> &enabledInControl) {
+    for (int round = 0; round < 32; round ++) {
+        for (int busId = 1; busId < _buses.size(); busId ++)
+            _buses[busId]->attemptPowerOverHorizon(_stepSize, enabledInControl);
+        double fraction = 1.0;
+        for (int timeSlotId = 0; timeSlotId < _numberOfSlots; timeSlotId ++)
+            fraction = std::min(fraction, predictedStepFractionAtTime(timeSlotId));
+        if (fraction >= 1.0)
+            return;
+        int backOffs = fraction > 0.0 ? int( std::ceil( std::log(fraction) / std::log(alpha) ) ) : 1;
+        _stepSize *= std::pow(alpha, std::max(backOffs, 1));
+    }
+}
+
+
+/******************************
+ speculative line search
+ ******************************/
+
+// make this a copy of the buses and lines of control without loads
+void NetworkControl::initializeReplica(const NetworkControl &control) {
+    clear();
+    _numberOfSlots = control._numberOfSlots;
+    _slotLengthInMinutes = control._slotLengthInMinutes;
+    _slotLengthsInMinutes = control._slotLengthsInMinutes;
+    _quadCoef = control._quadCoef;
+    _linCoef = control._linCoef;
+    _substationVoltage = control._substationVoltage;
+    _fuseGradientWithPowerFlow = control._fuseGradientWithPowerFlow;
+    _busPhaseIndicesInRoot = control._busPhaseIndicesInRoot;
+    _numberOfThreads = 1;
+    
+    // copy buses and lines, then point them at each other
+    unordered_map<const LineController *, LineController *> lineCopies;
+    for (int lineId = 0; lineId < control._lines.size(); lineId ++) {
+        LineController *line = new LineController(*control._lines[lineId]);
+        _lines.push_back(line);
+        lineCopies[control._lines[lineId]] = line;
+    }
+    for (int busId = 0; busId < control._buses.size(); busId ++) {
+        BusController *bus = new BusController(*control._buses[busId]);
+        bus->_loadArray.clear();
+        if (bus->_fromLine != NULL) {
+            bus->_fromLine = lineCopies[bus->_fromLine];
+            bus->_fromLine->_toBus = bus;
         }
-        if (voltageMin < voltageLowerBound)
-            voltageViolation = true;
-        if (voltageMax > voltageUpperBound)
-            voltageViolation = true;
-        
-        // escape if voltage is within range
-        if (!voltageViolation)  {
-            for (int busId = 0; busId < _buses.size(); busId ++) {
-                _buses[busId]->_voltageMin = voltageLowerBound;
-                _buses[busId]->_voltageMax = voltageUpperBound;
-            }
-            break;
+        for (int lineId = 0; lineId < bus->_toLineArray.size(); lineId ++) {
+            bus->_toLineArray[lineId] = lineCopies[bus->_toLineArray[lineId]];
+            bus->_toLineArray[lineId]->_fromBus = bus;
         }
-        
-        if (iteration == 15) {
-            std::cout << "failed to find a feasible solution to start computation!" << std::endl;
-            return 0.0;
+        _buses.push_back(bus);
+        _busToControllerHashTable[bus->_bus] = bus;
+    }
+}
+
+// copy voltage bounds, aggregate loads, voltages, currents and sumDown parts over the horizon
+// bounds are copied every time since the feasibility loops widen them after replicas are built
+void NetworkControl::copyPowerFlowOverHorizon(const NetworkControl &control) {
+    for (int busId = 0; busId < _buses.size(); busId ++) {
+        BusController *bus = _buses[busId];
+        const BusController *source = control._buses[busId];
+        bus->_voltageMin = source->_voltageMin;
+        bus->_voltageMax = source->_voltageMax;
+        bus->_aggregateLoads = source->_aggregateLoads;
+        bus->_oldAggregateLoads = source->_oldAggregateLoads;
+        bus->_voltages = source->_voltages;
+        if (_fuseGradientWithPowerFlow) {
+            bus->_sumDownLoad = source->_sumDownLoad;
+            bus->_sumDownLower = source->_sumDownLower;
+            bus->_sumDownUpper = source->_sumDownUpper;
         }
-        
-        // do optimization to drive voltage away from boundary
-        voltageMin -= 0.001;
-        if (voltageMin > voltageLowerBound)
-            voltageMin = voltageLowerBound;
-        voltageMax += 0.001;
-        if (voltageMax < voltageUpperBound)
-            voltageMax = voltageUpperBound;
-        std::cout << "\tvoltageMin = " << voltageMin << std::endl;
-        std::cout << "\tvoltageMax = " << voltageMax << std::endl;
-        for (int busId = 0; busId < _buses.size(); busId ++) {
-            _buses[busId]->_voltageMin = voltageMin;
-            _buses[busId]->_voltageMax = voltageMax;
+    }
+    for (int lineId = 0; lineId < _lines.size(); lineId ++) {
+        _lines[lineId]->_currentArray = control._lines[lineId]->_currentArray;
+    }
+}
+
+// attempt _stepSize over the horizon and evaluate it
+ControlEvaluation NetworkControl::attemptAndEvaluateOverHorizon(double alpha, unordered_set<LoadType> &enabledInControl) {
+    if (_numberOfStepSizeCandidates <= 1) {
+        attemptPowerOverHorizon(enabledInControl);
+        return evaluateOverHorizon();
+    }
+    
+    // a step size of the last batch is only materialized
+    int numberOfBus = int( _buses.size() );
+    for (int candidateId = 0; candidateId < _stepSizeCandidates.size(); candidateId ++) {
+        if (_stepSizeCandidates[candidateId] != _stepSize)
+            continue;
+        for (int busId = 1; busId < numberOfBus; busId ++)
+            _buses[busId]->attemptPowerOverHorizon(_stepSize, enabledInControl);
+        copyPowerFlowOverHorizon(*_stepSizeReplicas[candidateId]);
+        _voltageViolations = _stepSizeReplicas[candidateId]->_voltageViolations;
+        return _stepSizeEvaluations[candidateId];
+    }
+    
+    // set up replicas the first time, and after the network or the slot lengths change
+    if (_stepSizeReplicas.size() != _numberOfStepSizeCandidates ||
+        _stepSizeReplicas[0]->_buses.size() != numberOfBus ||
+        _stepSizeReplicas[0]->_numberOfSlots != _numberOfSlots ||
+        _stepSizeReplicas[0]->_slotLengthInMinutes != _slotLengthInMinutes ||
+        _stepSizeReplicas[0]->_slotLengthsInMinutes != _slotLengthsInMinutes) {
+        for (int replicaId = 0; replicaId < _stepSizeReplicas.size(); replicaId ++)
+            delete _stepSizeReplicas[replicaId];
+        _stepSizeReplicas.clear();
+        for (int replicaId = 0; replicaId < _numberOfStepSizeCandidates; replicaId ++) {
+            NetworkControl *replica = new NetworkControl();
+            replica->initializeReplica(*this);
+            _stepSizeReplicas.push_back(replica);
         }
-        
-        double mu = 1.0;
-        _muLower = mu;
-        _muUpper = mu;
-        slowControlInnerLoop(alpha, beta, epsilon);
     }
     
-    // set muArray to default value if empty
-    if (muArray.size() == 0) {
-        int numBus = (int) _buses.size();
-        muArray.push_back(1.00/numBus);
-        muArray.push_back(0.10/numBus);
-        muArray.push_back(0.01/numBus);
-        muArray.push_back(0.001/numBus);
+    // attempts only cost a pass over the loads, so they are done here and handed to the replicas,
+    // along with the load terms of the evaluation
+    _stepSizeCandidates.clear();
+    _stepSizeEvaluations.clear();
+    double stepSize = _stepSize;
+    for (int candidateId = 0; candidateId < _numberOfStepSizeCandidates; candidateId ++) {
+        ControlEvaluation evaluation;
+        for (int busId = 1; busId < numberOfBus; busId ++) {
+            BusController *bus = _buses[busId];
+            bus->attemptPowerOverHorizon(stepSize, enabledInControl);
+            for (int loadId = 0; loadId < bus->_loadArray.size(); loadId ++)
+                evaluation._objectiveValue += bus->_loadArray[loadId]->objectiveValueOverHorizon();
+            evaluation._expectedObjectiveValueChange += bus->expectedObjectiveValueChangeOverHorizon();
+        }
+        NetworkControl *replica = _stepSizeReplicas[candidateId];
+        replica->copyPowerFlowOverHorizon(*this);
+        replica->_muLower = _muLower;
+        replica->_muUpper = _muUpper;
+        _stepSizeCandidates.push_back(stepSize);
+        _stepSizeEvaluations.push_back(evaluation);
+        stepSize *= alpha;
     }
     
-    // run inner loop for each of the mu values
-    for (int i=0; i<muArray.size(); i++)
-    {
-        double mu = muArray[i];
-        // printf("mu = %13.12f:\n", mu);
-        _muLower = mu;
-        _muUpper = mu;
-        fastControlInnerLoop(alpha, beta, epsilon);
+    // power flows and voltage terms of the candidates in parallel
+    std::function<void(int, int)> evaluateCandidate = [this](int candidateId, int /*threadId*/) {
+        NetworkControl *replica = _stepSizeReplicas[candidateId];
+        for (int timeSlotId = 0; timeSlotId < _numberOfSlots; timeSlotId ++)
+            replica->solvePowerFlowAtTime(timeSlotId);
+        ControlEvaluation evaluation = replica->evaluateOverHorizon();
+        ControlEvaluation &result = _stepSizeEvaluations[candidateId];
+        result._voltageViolation = evaluation._voltageViolation;
+        result._objectiveValue += evaluation._objectiveValue;
+        result._updateSize = evaluation._updateSize;
+    };
+    if (_threadPool == NULL) {
+        for (int candidateId = 0; candidateId < _numberOfStepSizeCandidates; candidateId ++)
+            evaluateCandidate(candidateId, 0);
+    }
+    else {
+        _threadPool->parallelFor(0, _numberOfStepSizeCandidates, evaluateCandidate);
     }
+    _powerFlowEvaluations += _numberOfStepSizeCandidates * _numberOfSlots;
     
-    // compute power flow and return objective value
-    _muLower = 0;
-    _muUpper = 0;
-    // std::cout << "\tObjective value is " << objectiveValueAtTime(0) << std::endl;
-    return objectiveValueAtTime(0);
+    return attemptAndEvaluateOverHorizon(alpha, enabledInControl);
 }
 
-double NetworkControl::slowControlOuterLoop(std::vector<double> muArray, double alpha, double beta, double epsilon) {
-    double voltageLowerBound = _buses.back()->_voltageMin;
-    double voltageUpperBound = _buses.back()->_voltageMax;
+
+/******************************
+ spatial decomposition
+ ******************************/
+
+// split the network into areas of whole subtrees
+void NetworkControl::partitionNetwork() {
+    _areaBusIds.clear();
+    _areaRootIds.clear();
+    _coordinatorBusIds.clear();
+    _areaBoundaryPowers.clear();
+    int numberOfBus = int( _buses.size() );
+    if (_numberOfAreas == 0 || numberOfBus < 2)
+        return;
     
-    /******************************
-     get a feasible point
-     via substation adjustment
-     ******************************/
-    // get maximum and minimum voltages
-    for (;;) {
-        double voltageMin = _substationVoltage;
-        double voltageMax = _substationVoltage;
-        for (int busId = 0; busId < _buses.size(); busId ++) {
-            if (! _buses[busId]->_hasVoltageConstraint) continue;
-            BusController *bus = _buses[busId];
-            for (int timeSlotId = 0; timeSlotId < bus->_voltages.size(); timeSlotId ++) {
-                ColumnVector<complex_type> voltage = bus->_voltages[timeSlotId];
-                for (int phaseId = 0; phaseId < voltage.size(); phaseId ++) {
-                    double voltageMagnitude = std::sqrt(std::norm(voltage[phaseId]));
-                    if ( voltageMagnitude > voltageMax )
-                        voltageMax = voltageMagnitude;
-                    if ( voltageMagnitude < voltageMin )
-                        voltageMin = voltageMagnitude;
-                }
-            }
+    // subtree sizes and children, children come after parents in breadth first search order
+    const vector<int> &parentIds = _voltageSensitivity._parentIds;
+    vector<int> subtreeSizes(numberOfBus, 1);
+    vector<vector<int>> childIds(numberOfBus);
+    for (int busId = numberOfBus - 1; busId > 0; busId --) {
+        subtreeSizes[parentIds[busId]] += subtreeSizes[busId];
+        childIds[parentIds[busId]].push_back(busId);
+    }
+    
+    // split the largest subtree until every subtree is small
+    int targetSize = (numberOfBus - 1) / (2 * _numberOfAreas);
+    if (targetSize < 1)
+        targetSize = 1;
+    vector<int> rootIds(childIds[0]);
+    _coordinatorBusIds.push_back(0);
+    while ( sizeof("Split a subtree") ) {
+        int largestId = -1;
+        for (int rootId = 0; rootId < rootIds.size(); rootId ++) {
+            int busId = rootIds[rootId];
+            if (subtreeSizes[busId] > targetSize && ! childIds[busId].empty() &&
+                (largestId < 0 || subtreeSizes[busId] > subtreeSizes[rootIds[largestId]]))
+                largestId = rootId;
         }
-        
-        // adjust substation voltage if easy fix is available
-        // if voltages are within range, do nothing
-        if (voltageMin >= voltageLowerBound && voltageMax <= voltageUpperBound)
-            break;
-        
-        // if can be fixed by shifting substation voltage, then try it
-        double margin = (voltageUpperBound - voltageLowerBound) - (voltageMax - voltageMin);
-        if (margin > 0) {
-            _substationVoltage += voltageLowerBound - voltageMin;
-            if (margin > 0.01)
-                _substationVoltage += 0.005;
-            else
-                _substationVoltage += margin / 2.0;
-            initVoltageOverHorizon();
-            computePowerFlowOverHorizon();
-            BusController *substation = _buses[0];
-            substation->_oldAggregateLoads = substation->_aggregateLoads;
+        if (largestId < 0)
             break;
+        int busId = rootIds[largestId];
+        rootIds.erase(rootIds.begin() + largestId);
+        rootIds.insert(rootIds.end(), childIds[busId].begin(), childIds[busId].end());
+        _coordinatorBusIds.push_back(busId);
+    }
+    std::sort(_coordinatorBusIds.begin(), _coordinatorBusIds.end());
+    
+    // give the largest subtrees first to the area with the fewest buses
+    std::sort(rootIds.begin(), rootIds.end(), [&subtreeSizes](int busId1, int busId2) {
+        return subtreeSizes[busId1] > subtreeSizes[busId2];
+    });
+    int numberOfAreas = _numberOfAreas < rootIds.size() ? _numberOfAreas : int( rootIds.size() );
+    _areaRootIds.assign(numberOfAreas, vector<int>());
+    vector<int> areaSizes(numberOfAreas, 0);
+    vector<int> areaIds(numberOfBus, -1);
+    for (int rootId = 0; rootId < rootIds.size(); rootId ++) {
+        int areaId = int( std::min_element(areaSizes.begin(), areaSizes.end()) - areaSizes.begin() );
+        _areaRootIds[areaId].push_back(rootIds[rootId]);
+        areaSizes[areaId] += subtreeSizes[rootIds[rootId]];
+        areaIds[rootIds[rootId]] = areaId;
+    }
+    
+    // every other bus below a root is in the area of its parent
+    _areaBusIds.assign(numberOfAreas, vector<int>());
+    _areaBoundaryPowers.assign(numberOfAreas, vector<complex_type>());
+    for (int busId = 1; busId < numberOfBus; busId ++) {
+        if (areaIds[busId] < 0)
+            areaIds[busId] = areaIds[parentIds[busId]];
+        if (areaIds[busId] >= 0)
+            _areaBusIds[areaIds[busId]].push_back(busId);
+    }
+}
+
+// power flow inside an area
+void NetworkControl::computeAreaPowerFlowAtTime(int areaId, int timeSlotId) {
+    const vector<int> &busIds = _areaBusIds[areaId];
+    for (int busId = 0; busId < busIds.size(); busId ++) {
+        _buses[busIds[busId]]->computeAggregateLoadOnSelfAtTime(timeSlotId);
+    }
+    
+    // doing backward-forward sweep as in computePowerFlowAtTime
+    const int maxIteration = 15;
+    const double updateSizeThreshold = 1e-6;
+    int iteration = 0;
+    double updateSize = updateSizeThreshold + 1.0;
+    while (iteration < maxIteration && updateSize >= updateSizeThreshold) {
+        updateSize = 0.0;
+        for (int busId = int( busIds.size() - 1 ); busId >= 0; busId --) {
+            double updateSizeTmp = _buses[busIds[busId]]->computeCurrentOnFromLineAtTime(timeSlotId);
+            if (updateSizeTmp > updateSize)
+                updateSize = updateSizeTmp;
+        }
+        for (int busId = 0; busId < busIds.size(); busId ++) {
+            double updateSizeTmp = _buses[busIds[busId]]->computeVoltageOnSelfAtTime(timeSlotId);
+            if (updateSizeTmp > updateSize)
+                updateSize = updateSizeTmp;
+        }
+        iteration ++;
+    }
+}
+
+// gradient inside an area
+void NetworkControl::computeAreaGradientAtTime(int areaId, int timeSlotId, int threadId, const vector<complex_type> &boundaryPowerChange) {
+    const vector<int> &busIds = _areaBusIds[areaId];
+    
+    // gather price at every bus from the root phases
+    vector<vector<double>> &prices = _priceBuffers[threadId];
+    for (int busId = 0; busId < busIds.size(); busId ++) {
+        const vector<int> &phaseIndicesInRoot = _busPhaseIndicesInRoot[busIds[busId]];
+        vector<double> &price = prices[busIds[busId]];
+        for (int phaseId = 0; phaseId < phaseIndicesInRoot.size(); phaseId ++) {
+            price[phaseId] = _boundaryMarginalPrice[phaseIndicesInRoot[phaseId]];
         }
-        
-        // otherwise there is the danger of cannot find a feasible point
-        std::cout << "\tvoltageMin = " << voltageMin << std::endl;
-        std::cout << "\tvoltageMax = " << voltageMax << std::endl;
-        std::cout << "May fail to find a feasible point!" << std::endl;
-        break;
     }
     
+    // backward sweep to compute sumDown, forward sweep to compute sumUp and gradient
+    for (int busId = int( busIds.size() - 1 ); busId >= 0; busId --) {
+        _buses[busIds[busId]]->computeSumDownAtTime(_muLower, _muUpper, prices[busIds[busId]], timeSlotId);
+    }
+    for (int busId = 0; busId < busIds.size(); busId ++) {
+        _buses[busIds[busId]]->computeSumUpAtTime(timeSlotId);
+        _buses[busIds[busId]]->computeGradientAtTime(prices[busIds[busId]], timeSlotId);
+    }
     
-    /******************************
-     get a feasible point
-     via subsequent optimizations
-     ******************************/
-    for (int iteration = 0; ; iteration ++) {
-        double voltageMin = _substationVoltage;
-        double voltageMax = _substationVoltage;
-        bool voltageViolation = false;
+    // the penalty on boundary power, with losses inside the area neglected
+    if (_boundaryPenalty == 0.0)
+        return;
+    for (int busId = 0; busId < busIds.size(); busId ++) {
+        const vector<int> &phaseIndicesInRoot = _busPhaseIndicesInRoot[busIds[busId]];
+        ColumnVector<complex_type> &gradient = _buses[busIds[busId]]->_gradient[timeSlotId];
+        for (int phaseId = 0; phaseId < phaseIndicesInRoot.size(); phaseId ++)
+            gradient._data[phaseId] += _boundaryPenalty * boundaryPowerChange[phaseIndicesInRoot[phaseId]];
+    }
+}
+
+// objective of an area
+ControlEvaluation NetworkControl::evaluateAreaAtTime(int areaId, int timeSlotId, vector<complex_type> &boundaryPower) const {
+    ControlEvaluation evaluation;
+    boundaryPower.assign(_boundaryMarginalPrice.size(), complex_type(0.0, 0.0));
+    const vector<int> &busIds = _areaBusIds[areaId];
+    for (int busId = 0; busId < busIds.size(); busId ++) {
+        _buses[busIds[busId]]->evaluateAtTime(_muLower, _muUpper, timeSlotId, evaluation, NULL);
+        if (evaluation._voltageViolation)
+            return evaluation;
+    }
+    
+    // power drawn by the subtrees, priced by the gradient at their parents
+    const vector<int> &rootIds = _areaRootIds[areaId];
+    for (int rootId = 0; rootId < rootIds.size(); rootId ++) {
+        LineController *line = _buses[rootIds[rootId]]->_fromLine;
+        BusController *parent = line->_fromBus;
+        const ColumnVector<complex_type> &current = line->_currentArray[timeSlotId];
+        for (int phaseId = 0; phaseId < line->_phaseIndicesInFromBus.size(); phaseId ++) {
+            int parentPhaseId = line->_phaseIndicesInFromBus[phaseId];
+            complex_type power = parent->_voltages[timeSlotId]._data[parentPhaseId] * std::conj(current._data[phaseId]);
+            complex_type gradient = parent == _buses[0] ?
+                complex_type(_boundaryMarginalPrice[parentPhaseId], 0.0) :
+                parent->_gradient[timeSlotId]._data[parentPhaseId];
+            evaluation._objectiveValue += gradient.real() * power.real() + gradient.imag() * power.imag();
+            boundaryPower[_busPhaseIndicesInRoot[rootIds[rootId]][phaseId]] += power;
+        }
+    }
+    return evaluation;
+}
+
+// projected gradient over the loads of an area
+int NetworkControl::areaInnerLoop(int areaId, int timeSlotId, int threadId, int maxIteration, double alpha, double beta, double epsilon) {
+    const vector<int> &busIds = _areaBusIds[areaId];
+    int iteration = 1;
+    
+    // the area starts from a feasible point
+    vector<complex_type> &oldBoundaryPower = _areaBoundaryPowers[areaId];
+    vector<complex_type> startBoundaryPower, boundaryPower, boundaryPowerChange;
+    ControlEvaluation evaluation = evaluateAreaAtTime(areaId, timeSlotId, startBoundaryPower);
+    oldBoundaryPower = startBoundaryPower;
+    if ( evaluation._voltageViolation )
+        return iteration;
+    double oldObjectiveValue = evaluation._objectiveValue;
+    boundaryPowerChange.assign(startBoundaryPower.size(), complex_type(0.0, 0.0));
+    
+    while ( iteration <= maxIteration )
+    {
+        // compute gradient
+        computeAreaGradientAtTime(areaId, timeSlotId, threadId, boundaryPowerChange);
         
-        // compute current voltageMin, voltageMax, and voltageViolation
-        for (int busId = 0; busId < _buses.size(); busId ++) {
-            if (! _buses[busId]->_hasVoltageConstraint)
+        // intialize step size
+        double stepSize = 1.0;
+        
+        // line search
+        while ( sizeof("Determine a step size") )
+        {
+            // attempt a step size
+            for (int busId = 0; busId < busIds.size(); busId ++)
+                _buses[busIds[busId]]->attemptPowerAtTime(stepSize, timeSlotId, _enabledInFastControl);
+            computeAreaPowerFlowAtTime(areaId, timeSlotId);
+            
+            // if voltage violation happens, back off step size
+            evaluation = evaluateAreaAtTime(areaId, timeSlotId, boundaryPower);
+            if ( evaluation._voltageViolation ) {
+                stepSize *= alpha;
+                _lineSearchBacktracks ++;
                 continue;
-            BusController *bus = _buses[busId];
-            for (int timeSlotId = 0; timeSlotId < bus->_voltages.size(); timeSlotId ++) {
-                ColumnVector<complex_type> voltage = bus->_voltages[timeSlotId];
-                for (int phaseId = 0; phaseId < voltage.size(); phaseId ++) {
-                    double voltageMagnitude = std::sqrt(std::norm(voltage[phaseId]));
-                    if ( voltageMagnitude > voltageMax ) {
-                        voltageMax = voltageMagnitude;
-                        // std::cout << "\tbus " << bus->_bus->name();
-                        // std::cout << ", at time " << timeSlotId << ", phase " << bus->_bus->phase()[phaseId];
-                        // std::cout << ", voltage " << voltageMagnitude << '\n';
-                    }
-                    if ( voltageMagnitude < voltageMin ) {
-                        voltageMin = voltageMagnitude;
-                        // std::cout << "\tbus " << bus->_bus->name();
-                        // std::cout << ", at time " << timeSlotId << ", phase " << bus->_bus->phase()[phaseId];
-                        // std::cout << ", voltage " << voltageMagnitude << '\n';
-                    }
+            }
+            
+            // penalty on the change of power drawn by the area in this round
+            double newObjectiveValue = evaluation._objectiveValue;
+            for (int phaseId = 0; phaseId < boundaryPower.size(); phaseId ++)
+                newObjectiveValue += 0.5 * _boundaryPenalty * std::norm(boundaryPower[phaseId] - startBoundaryPower[phaseId]);
+            
+            // change of the power drawn by the area counts as a change at the substation
+            double boundaryUpdateSize = 0.0;
+            for (int phaseId = 0; phaseId < boundaryPower.size(); phaseId ++)
+                boundaryUpdateSize += std::norm(boundaryPower[phaseId] - oldBoundaryPower[phaseId]);
+            if (evaluation._updateSize < boundaryUpdateSize)
+                evaluation._updateSize = boundaryUpdateSize;
+            
+            // if update too small, prepare for return
+            if (evaluation._updateSize < epsilon) {
+                for (int busId = 0; busId < busIds.size(); busId ++) {
+                    if (newObjectiveValue < oldObjectiveValue)
+                        _buses[busIds[busId]]->updatePowerAtTime(timeSlotId, _enabledInFastControl);
+                    else
+                        _buses[busIds[busId]]->resetPowerAtTime(timeSlotId, _enabledInFastControl);
                 }
+                if (newObjectiveValue < oldObjectiveValue)
+                    oldBoundaryPower = boundaryPower;
+                else
+                    computeAreaPowerFlowAtTime(areaId, timeSlotId);
+                return iteration;
+            }
+            
+            // if value is big, back off step size
+            if (newObjectiveValue > oldObjectiveValue + beta * evaluation._expectedObjectiveValueChange) {
+                stepSize *= alpha;
+                _lineSearchBacktracks ++;
+            }
+            
+            // else update power
+            else {
+                for (int busId = 0; busId < busIds.size(); busId ++)
+                    _buses[busIds[busId]]->updatePowerAtTime(timeSlotId, _enabledInFastControl);
+                oldObjectiveValue = newObjectiveValue;
+                oldBoundaryPower = boundaryPower;
+                for (int phaseId = 0; phaseId < boundaryPower.size(); phaseId ++)
+                    boundaryPowerChange[phaseId] = boundaryPower[phaseId] - startBoundaryPower[phaseId];
+                iteration ++;
+                break;
             }
         }
-        if (voltageMin < voltageLowerBound)
-            voltageViolation = true;
-        if (voltageMax > voltageUpperBound)
-            voltageViolation = true;
-        
-        // escape if voltage is within range
-        if (!voltageViolation)  {
-            for (int busId = 0; busId < _buses.size(); busId ++) {
-                _buses[busId]->_voltageMin = voltageLowerBound;
-                _buses[busId]->_voltageMax = voltageUpperBound;
+    }
+    return iteration;
+}
+
+
+/******************************
+ solve the power flow problem
+ ******************************/
+
+// initialize algorithm variables for fast control
+void NetworkControl::fastControlInitialize() {
+    // read data from real network
+    // voltage
+    BusController *substation = _buses[0];
+    _substationVoltage = std::sqrt(std::norm(substation->_bus->voltage()[0]));
+    initVoltageAtTime(0);
+    
+    // loads
+    for (int busId = 1; busId < _buses.size(); busId ++) {
+        vector<LoadController *> loads = _buses[busId]->_loadArray;
+        for (int loadId = 0; loadId < loads.size(); loadId ++) {
+            loads[loadId]->_valueArray[0] = loads[loadId]->_load->value();
+            loads[loadId]->_oldValueArray[0] = loads[loadId]->_load->value();
+        }
+        _buses[busId]->computeAggregateLoadOnSelfAtTime(0);
+        _buses[busId]->_oldAggregateLoads[0] = _buses[busId]->_aggregateLoads[0];
+    }
+    
+    // initialize substation oldAggregateLoads
+    computePowerFlowAtTime(0);
+    substation->_oldAggregateLoads[0] = substation->_aggregateLoads[0];
+}
+
+// whether measured loads and voltages moved less than the triggers since the last solve
+bool NetworkControl::fastControlStateUnchanged() const {
+    if (_triggerLoadValues.empty() || _triggerVoltages.empty())
+        return false;
+    
+    // loads
+    int loadEntryId = 0;
+    for (int busId = 0; busId < _buses.size(); busId ++) {
+        const vector<LoadController *> &loads = _buses[busId]->_loadArray;
+        for (int loadId = 0; loadId < loads.size(); loadId ++, loadEntryId ++) {
+            if (loadEntryId >= _triggerLoadValues.size())
+                return false;
+            Load *load = loads[loadId]->_load;
+            bool enabled = _enabledInFastControl.find(load->type()) != _enabledInFastControl.end();
+            LoadValue value = load->value();
+            const LoadValue &oldValue = _triggerLoadValues[loadEntryId];
+            for (int phaseId = 0; phaseId < value._power.size(); phaseId ++) {
+                complex_type change = value._power._data[phaseId] - oldValue._power._data[phaseId];
+                double changeMagnitude = enabled ? std::abs(change.real()) : std::abs(change);
+                if (changeMagnitude >= _fastControlLoadTrigger)
+                    return false;
+                if (enabled)
+                    continue;
+                for (int otherPhaseId = 0; otherPhaseId < value._power.size(); otherPhaseId ++) {
+                    if (std::abs(value._admittance._data[phaseId][otherPhaseId] - oldValue._admittance._data[phaseId][otherPhaseId]) >= _fastControlLoadTrigger)
+                        return false;
+                }
             }
-            break;
         }
-        
-        if (iteration == 15) {
-            std::cout << "failed to find a feasible solution to start computation!" << std::endl;
-            return 0.0;
+    }
+    if (loadEntryId != _triggerLoadValues.size())
+        return false;
+    
+    // voltages
+    int voltageEntryId = 0;
+    for (int busId = 0; busId < _buses.size(); busId ++) {
+        ColumnVector<complex_type> voltage = _buses[busId]->_bus->voltage();
+        for (int phaseId = 0; phaseId < voltage.size(); phaseId ++, voltageEntryId ++) {
+            if (voltageEntryId >= _triggerVoltages.size())
+                return false;
+            double magnitude = std::sqrt(std::norm(voltage[phaseId]));
+            if (std::abs(magnitude - _triggerVoltages[voltageEntryId]) >= _fastControlVoltageTrigger)
+                return false;
         }
-        
-        // do optimization to drive voltage away from boundary
-        voltageMin -= 0.001;
-        if (voltageMin > voltageLowerBound)
-            voltageMin = voltageLowerBound;
-        voltageMax += 0.001;
-        if (voltageMax < voltageUpperBound)
-            voltageMax = voltageUpperBound;
-        std::cout << "\tvoltageMin = " << voltageMin << std::endl;
-        std::cout << "\tvoltageMax = " << voltageMax << std::endl;
-        for (int busId = 0; busId < _buses.size(); busId ++) {
-            _buses[busId]->_voltageMin = voltageMin;
-            _buses[busId]->_voltageMax = voltageMax;
+    }
+    return voltageEntryId == _triggerVoltages.size();
+}
+
+// keep measured loads of the solve in progress
+void NetworkControl::saveFastControlLoadValues() {
+    _triggerLoadValues.clear();
+    for (int busId = 0; busId < _buses.size(); busId ++) {
+        const vector<LoadController *> &loads = _buses[busId]->_loadArray;
+        for (int loadId = 0; loadId < loads.size(); loadId ++)
+            _triggerLoadValues.push_back(loads[loadId]->_load->value());
+    }
+}
+
+// keep set-points applied by the solve in progress, and the voltages computed under them,
+// so that the drift of measured voltages shows what the power flow model missed
+void NetworkControl::saveFastControlSetPoints() {
+    _triggerSetPoints.clear();
+    _triggerVoltages.clear();
+    for (int busId = 0; busId < _buses.size(); busId ++) {
+        const vector<LoadController *> &loads = _buses[busId]->_loadArray;
+        for (int loadId = 0; loadId < loads.size(); loadId ++)
+            _triggerSetPoints.push_back(loads[loadId]->_valueArray[0]);
+        const ColumnVector<complex_type> &voltage = _buses[busId]->_voltages[0];
+        for (int phaseId = 0; phaseId < voltage.size(); phaseId ++)
+            _triggerVoltages.push_back(std::sqrt(std::norm(voltage._data[phaseId])));
+    }
+}
+
+// refit the droop curves to the solve just finished
+void NetworkControl::fitVoltVarDroop() {
+    if (_voltVarDroop._devices.empty()) {
+        vector<PhotoVoltaicController *> devices;
+        if (_enabledInFastControl.find(PHOTOVOLTAIC) != _enabledInFastControl.end()) {
+            for (int busId = 0; busId < _buses.size(); busId ++) {
+                const vector<LoadController *> &loads = _buses[busId]->_loadArray;
+                for (int loadId = 0; loadId < loads.size(); loadId ++) {
+                    if (loads[loadId]->_load->type() == PHOTOVOLTAIC)
+                        devices.push_back( (PhotoVoltaicController *)loads[loadId] );
+                }
+            }
+        }
+        _voltVarDroop.initialize(devices);
+    }
+    _voltVarDroop.addSample();
+}
+
+// follow the droop curves
+void NetworkControl::fallBackToVoltVarDroop() {
+    if (_voltVarDroop.fitted()) {
+        _voltVarDroop.apply();
+        _voltVarFallbacks ++;
+        _telemetry._voltVarFallbacks = 1;
+    }
+}
+
+// put the last set-points of loads enabled in fast control back onto the network
+void NetworkControl::holdFastControlSetPoints() {
+    int loadEntryId = 0;
+    for (int busId = 0; busId < _buses.size(); busId ++) {
+        const vector<LoadController *> &loads = _buses[busId]->_loadArray;
+        for (int loadId = 0; loadId < loads.size(); loadId ++, loadEntryId ++) {
+            if (loadEntryId >= _triggerSetPoints.size())
+                return;
+            LoadController *load = loads[loadId];
+            if (_enabledInFastControl.find(load->_load->type()) == _enabledInFastControl.end())
+                continue;
+            load->_valueArray[0] = load->_load->value();
+            load->holdSetPointAtTime(_triggerSetPoints[loadEntryId], 0);
+            load->_load->setValue(load->_valueArray[0]);
+        }
+    }
+}
+
+void NetworkControl::slowControlInitialize(time_type time) {
+    // read data from real network
+    // voltage
+    BusController *substation = _buses[0];
+    _substationVoltage = std::sqrt(std::norm(substation->_bus->voltage()[0]));
+    initVoltageOverHorizon();
+    
+    // voltages of the last solution are a good start of the power flow
+    vector<int> sourceSlotIds;
+    _warmStarted = warmStartSlotIds(time, sourceSlotIds);
+    if (_warmStarted) {
+        for (int busId = 1; busId < _buses.size(); busId ++) {
+            for (int timeSlotId = 0; timeSlotId < _numberOfSlots; timeSlotId ++) {
+                if (sourceSlotIds[timeSlotId] >= 0)
+                    _buses[busId]->_voltages[timeSlotId] = _warmStartVoltages[busId][sourceSlotIds[timeSlotId]];
+            }
+        }
+    }
+    
+    // otherwise a solution at the same time of past days is a good start of the schedules
+    _cacheHit = false;
+    if (_useSolutionCache) {
+        solutionCacheKey(time, _cacheKey, _cacheFingerprint);
+        if (! _warmStarted) {
+            _cacheHit = warmStartFromSolutionCache(sourceSlotIds);
+            _warmStarted = _cacheHit;
+            _telemetry._cacheLookups = 1;
+            _telemetry._cacheHits = _cacheHit ? 1 : 0;
+        }
+    }
+    
+    // loads
+    for (int busId = 1; busId < _buses.size(); busId ++) {
+        BusController *bus = _buses[busId];
+        for (int loadId = 0; loadId < bus->_loadArray.size(); loadId ++) {
+            LoadController *load = bus->_loadArray[loadId];
+            if (load->_load->type() == ELECTRIC_VEHICLE) {
+                ElectricVehicleController *evController = (ElectricVehicleController *)load;
+                ElectricVehicle *ev = (ElectricVehicle *)(load->_load);
+                evController->_plugInTimeSlotId = slotIdAtTime(ev->_plugInTime - time);
+                evController->_deadlineTimeSlotId = slotIdAtTime(ev->_deadline - time);
+            }
+            if (_warmStarted)
+                load->warmStartOverHorizon(sourceSlotIds);
+            load->_oldValueArray = load->_valueArray;
+        }
+        _buses[busId]->computeAggregateLoadOnSelfOverHorizon();
+        _buses[busId]->_oldAggregateLoads = _buses[busId]->_aggregateLoads;
+    }
+    
+    // initialize substation oldAggregateLoads
+    computePowerFlowOverHorizon();
+    substation->_oldAggregateLoads = substation->_aggregateLoads;
+}
+
+// slots of the last solution that cover the start of every new slot
+bool NetworkControl::warmStartSlotIds(time_type time, vector<int> &sourceSlotIds) const {
+    if (! _warmStartSlowControl || _warmStartTime < 0.0 || time < _warmStartTime)
+        return false;
+    if (_warmStartVoltages.size() != _buses.size() || _warmStartVoltages[0].size() != _numberOfSlots)
+        return false;
+    
+    // the new horizon must start at a first-length step of the last one, and inside it
+    double steps = (time - _warmStartTime) / _slotLengthInMinutes;
+    int shift = int( steps + 0.5 );
+    if (std::abs(steps - shift) > 1e-6 || time - _warmStartTime >= slotStartInMinutes(_numberOfSlots))
+        return false;
+    
+    // on a uniform grid every slot is shifted by the same number of slots
+    sourceSlotIds.assign(_numberOfSlots, -1);
+    for (int timeSlotId = 0; timeSlotId < _numberOfSlots; timeSlotId ++) {
+        int sourceSlotId = slotIdAtTime(time - _warmStartTime + slotStartInMinutes(timeSlotId) + 1e-6);
+        if (sourceSlotId < _numberOfSlots)
+            sourceSlotIds[timeSlotId] = sourceSlotId;
+    }
+    return true;
+}
+
+// keep the solution for the next warm start
+void NetworkControl::saveWarmStart(time_type time) {
+    _warmStartTime = time;
+    _warmStartVoltages.resize(_buses.size());
+    for (int busId = 0; busId < _buses.size(); busId ++) {
+        BusController *bus = _buses[busId];
+        _warmStartVoltages[busId] = bus->_voltages;
+        for (int loadId = 0; loadId < bus->_loadArray.size(); loadId ++) {
+            bus->_loadArray[loadId]->saveWarmStartOverHorizon();
+        }
+    }
+}
+
+// keep slot 0 of the solution for fast control
+void NetworkControl::savePlanForFastControl(time_type time) {
+    // prices at the accepted point and the final mu, at which slot 0 is stationary
+    _muLower = _warmStartMu;
+    _muUpper = _warmStartMu;
+    computePowerFlowAtTime(0);
+    computeGradientAtTime(0);
+    _muLower = 0;
+    _muUpper = 0;
+    
+    _planStartTime = time;
+    _planEndTime = time + slotLengthInMinutes(0);
+    _planMu = _warmStartMu;
+    _plannedSetPoints.clear();
+    _plannedPrices.resize(_buses.size());
+    for (int busId = 0; busId < _buses.size(); busId ++) {
+        const vector<LoadController *> &loads = _buses[busId]->_loadArray;
+        for (int loadId = 0; loadId < loads.size(); loadId ++)
+            _plannedSetPoints.push_back(loads[loadId]->_valueArray[0]);
+        _plannedPrices[busId] = _buses[busId]->_gradient[0];
+    }
+    
+    // the plan replaces the set-points of the last fast control
+    _triggerLoadValues.clear();
+    _triggerSetPoints.clear();
+}
+
+// whether fast control at time is inside the first slot of the plan
+bool NetworkControl::planCoversTime(time_type time) const {
+    if (! _handOffSlowControlPlan || _planStartTime < 0.0 || _planMu <= 0.0)
+        return false;
+    if (time < _planStartTime || time >= _planEndTime)
+        return false;
+    int numberOfLoads = 0;
+    for (int busId = 0; busId < _buses.size(); busId ++)
+        numberOfLoads += _buses[busId]->_loadArray.size();
+    return numberOfLoads == _plannedSetPoints.size() && _buses.size() == _plannedPrices.size();
+}
+
+// start fast control from the plan
+void NetworkControl::startFastControlFromPlan() {
+    // set-points of the last fast control are newer than the plan
+    bool holdSetPoints = _triggerSetPoints.empty();
+    int loadEntryId = 0;
+    for (int busId = 0; busId < _buses.size(); busId ++) {
+        BusController *bus = _buses[busId];
+        for (int loadId = 0; loadId < bus->_loadArray.size(); loadId ++, loadEntryId ++) {
+            LoadController *load = bus->_loadArray[loadId];
+            if (_enabledInFastControl.find(load->_load->type()) == _enabledInFastControl.end())
+                continue;
+            if (holdSetPoints) {
+                load->holdSetPointAtTime(_plannedSetPoints[loadEntryId], 0);
+                load->_oldValueArray[0] = load->_valueArray[0];
+            }
+            
+            // the charging rate of slot 0 trades off against the rates of later slots,
+            // priced by the gradient of the plan
+            if (load->_load->type() == ELECTRIC_VEHICLE && _admmPenalty > 0.0) {
+                double plannedRate = _plannedSetPoints[loadEntryId]._power._data[0].real();
+                double plannedPrice = _plannedPrices[busId]._data[load->_phaseIndicesInLocationBus[0]].real();
+                ((ElectricVehicleController *)load)->startTerminalCostAtTime(_admmPenalty, plannedRate, plannedPrice, 0);
+            }
+        }
+    }
+    if (! holdSetPoints)
+        return;
+    
+    // power flow at the planned set-points
+    for (int busId = 1; busId < _buses.size(); busId ++) {
+        _buses[busId]->computeAggregateLoadOnSelfAtTime(0);
+        _buses[busId]->_oldAggregateLoads[0] = _buses[busId]->_aggregateLoads[0];
+    }
+    computePowerFlowAtTime(0);
+    _buses[0]->_oldAggregateLoads[0] = _buses[0]->_aggregateLoads[0];
+}
+
+// turn the cost of later slots off again
+void NetworkControl::finishFastControlFromPlan() {
+    for (int busId = 0; busId < _buses.size(); busId ++) {
+        const vector<LoadController *> &loads = _buses[busId]->_loadArray;
+        for (int loadId = 0; loadId < loads.size(); loadId ++) {
+            if (loads[loadId]->_load->type() == ELECTRIC_VEHICLE)
+                ((ElectricVehicleController *)loads[loadId])->stopConsensus();
+        }
+    }
+}
+
+// key and fingerprint of slow control at time
+void NetworkControl::solutionCacheKey(time_type time, string &key, vector<double> &fingerprint) const {
+    // EVs plugged in over the horizon, with the slots they charge in
+    vector<string> evs;
+    vector<double> slotLoads(_numberOfSlots, 0.0);
+    for (int busId = 0; busId < _buses.size(); busId ++) {
+        const vector<LoadController *> &loads = _buses[busId]->_loadArray;
+        for (int loadId = 0; loadId < loads.size(); loadId ++) {
+            if (loads[loadId]->_load->type() == ELECTRIC_VEHICLE) {
+                ElectricVehicle *ev = (ElectricVehicle *)(loads[loadId]->_load);
+                int deadlineTimeSlotId = slotIdAtTime(ev->_deadline - time);
+                if (deadlineTimeSlotId <= 0)
+                    continue;
+                std::ostringstream signature;
+                signature << ev->name() << ":" << slotIdAtTime(ev->_plugInTime - time) << ":" << deadlineTimeSlotId;
+                evs.push_back(signature.str());
+                continue;
+            }
+            for (int timeSlotId = 0; timeSlotId < _numberOfSlots; timeSlotId ++) {
+                const ColumnVector<complex_type> &power = loads[loadId]->_valueArray[timeSlotId]._power;
+                for (int phaseId = 0; phaseId < power.size(); phaseId ++)
+                    slotLoads[timeSlotId] += power._data[phaseId].real();
+            }
+        }
+    }
+    std::sort(evs.begin(), evs.end());
+    string fleetSignature;
+    for (int evId = 0; evId < evs.size(); evId ++)
+        fleetSignature += (evId == 0 ? "" : ",") + evs[evId];
+    key = SolutionCache::key(std::fmod(time, 24 * 60.0), fleetSignature);
+    
+    // predicted load profile, averaged over segments of equally many slots
+    int numberOfSegments = std::min(_fingerprintLength, _numberOfSlots);
+    fingerprint.assign(numberOfSegments, 0.0);
+    for (int segmentId = 0; segmentId < numberOfSegments; segmentId ++) {
+        int firstSlotId = segmentId * _numberOfSlots / numberOfSegments;
+        int lastSlotId = (segmentId + 1) * _numberOfSlots / numberOfSegments;
+        for (int timeSlotId = firstSlotId; timeSlotId < lastSlotId; timeSlotId ++)
+            fingerprint[segmentId] += slotLoads[timeSlotId] / (lastSlotId - firstSlotId);
+    }
+}
+
+// start from the nearest cached solution
+bool NetworkControl::warmStartFromSolutionCache(vector<int> &sourceSlotIds) {
+    const CachedSolution *solution = _solutionCache.nearest(_cacheKey, _cacheFingerprint);
+    if (solution == NULL)
+        return false;
+    
+    // loads missing from the solution keep the prediction
+    for (int busId = 0; busId < _buses.size(); busId ++) {
+        const vector<LoadController *> &loads = _buses[busId]->_loadArray;
+        for (int loadId = 0; loadId < loads.size(); loadId ++) {
+            LoadController *load = loads[loadId];
+            load->_warmStartValueArray.clear();
+            unordered_map<string, vector<complex_type>>::const_iterator it = solution->_powers.find(load->_load->name());
+            int numberOfPhases = int( load->_phaseIndicesInLocationBus.size() );
+            if (it == solution->_powers.end() || it->second.size() != _numberOfSlots * numberOfPhases)
+                continue;
+            load->_warmStartValueArray = load->_valueArray;
+            for (int timeSlotId = 0; timeSlotId < _numberOfSlots; timeSlotId ++) {
+                for (int phaseId = 0; phaseId < numberOfPhases; phaseId ++)
+                    load->_warmStartValueArray[timeSlotId]._power._data[phaseId] = it->second[timeSlotId * numberOfPhases + phaseId];
+            }
+        }
+    }
+    _warmStartMu = solution->_mu;
+    _cacheIterations = solution->_iterations;
+    sourceSlotIds.resize(_numberOfSlots);
+    for (int timeSlotId = 0; timeSlotId < _numberOfSlots; timeSlotId ++)
+        sourceSlotIds[timeSlotId] = timeSlotId;
+    return true;
+}
+
+// keep the schedules under the current key
+void NetworkControl::storeInSolutionCache(int iterations) {
+    CachedSolution solution;
+    solution._fingerprint = _cacheFingerprint;
+    solution._mu = _warmStartMu;
+    solution._iterations = iterations;
+    for (int busId = 0; busId < _buses.size(); busId ++) {
+        const vector<LoadController *> &loads = _buses[busId]->_loadArray;
+        for (int loadId = 0; loadId < loads.size(); loadId ++) {
+            LoadController *load = loads[loadId];
+            if (_enabledInSlowControl.find(load->_load->type()) == _enabledInSlowControl.end())
+                continue;
+            vector<complex_type> &powers = solution._powers[load->_load->name()];
+            for (int timeSlotId = 0; timeSlotId < _numberOfSlots; timeSlotId ++) {
+                const ColumnVector<complex_type> &power = load->_valueArray[timeSlotId]._power;
+                for (int phaseId = 0; phaseId < power.size(); phaseId ++)
+                    powers.push_back(power._data[phaseId]);
+            }
+        }
+    }
+    _solutionCache.store(_cacheKey, solution);
+}
+
+// find a feasible point in a few power flows
+bool NetworkControl::restoreFeasibility(int numberOfSlots, unordered_set<LoadType> &enabledInControl) {
+    if (restoreFeasibilityBySubstationVoltage(numberOfSlots))
+        return true;
+    return restoreFeasibilityByLoads(numberOfSlots, enabledInControl);
+}
+
+// range of shifts of all voltage magnitudes that puts them within bounds
+void NetworkControl::feasibleVoltageShiftRange(int numberOfSlots, double &low, double &high) const {
+    low = -1e100;
+    high = 1e100;
+    for (int busId = 0; busId < _buses.size(); busId ++) {
+        BusController *bus = _buses[busId];
+        if (! bus->_hasVoltageConstraint)
+            continue;
+        for (int timeSlotId = 0; timeSlotId < numberOfSlots; timeSlotId ++) {
+            for (int phaseId = 0; phaseId < bus->_voltages[timeSlotId].size(); phaseId ++) {
+                double voltageMagnitude = std::sqrt( std::norm( bus->_voltages[timeSlotId]._data[phaseId] ) );
+                low = std::max(low, bus->_voltageMin - voltageMagnitude);
+                high = std::min(high, bus->_voltageMax - voltageMagnitude);
+            }
+        }
+    }
+}
+
+// shift the substation voltage into the feasible shift range
+bool NetworkControl::restoreFeasibilityBySubstationVoltage(int numberOfSlots, int maxPowerFlows) {
+    BusController *substation = _buses[0];
+    for (int powerFlow = 0; ; powerFlow ++) {
+        double low, high;
+        feasibleVoltageShiftRange(numberOfSlots, low, high);
+        if (low < 0.0 && high > 0.0)
+            return true;
+        if (powerFlow == maxPowerFlows || (low > high && powerFlow > 0))
+            return false;
+        
+        // the smallest move into the range with some margin, or the center of the voltages if the range is empty
+        double shift = (low + high) / 2.0;
+        if (low <= high && low >= 0.0)
+            shift = low + std::min(0.005, (high - low) / 2.0);
+        else if (low <= high)
+            shift = high - std::min(0.005, (high - low) / 2.0);
+        _substationVoltage += shift;
+        if (numberOfSlots == 1) {
+            initVoltageAtTime(0);
+            computePowerFlowAtTime(0);
+        }
+        else {
+            initVoltageOverHorizon();
+            computePowerFlowOverHorizon();
+        }
+        for (int timeSlotId = 0; timeSlotId < numberOfSlots; timeSlotId ++)
+            substation->_oldAggregateLoads[timeSlotId] = substation->_aggregateLoads[timeSlotId];
+    }
+}
+
+// residuals of voltage magnitudes outside their tightened bounds
+// the substation is left out, as loads cannot move its voltage
+double NetworkControl::phaseOneResidualsAtTime(int timeSlotId, double margin) {
+    int numberOfPhases = _voltageSensitivity._numberOfPhasesAtRoot;
+    _phaseOneResiduals.assign(_buses.size() * numberOfPhases, 0.0);
+    double result = 0.0;
+    for (int busId = 1; busId < _buses.size(); busId ++) {
+        BusController *bus = _buses[busId];
+        if (! bus->_hasVoltageConstraint)
+            continue;
+        double tightening = std::min(margin, (bus->_voltageMax - bus->_voltageMin) / 4.0);
+        double lowerBound = bus->_voltageMin + tightening;
+        double upperBound = bus->_voltageMax - tightening;
+        const vector<int> &phaseIndicesInRoot = _busPhaseIndicesInRoot[busId];
+        for (int phaseId = 0; phaseId < phaseIndicesInRoot.size(); phaseId ++) {
+            double voltageMagnitude = std::sqrt( std::norm( bus->_voltages[timeSlotId]._data[phaseId] ) );
+            double residual = 0.0;
+            if (voltageMagnitude > upperBound)
+                residual = voltageMagnitude - upperBound;
+            else if (voltageMagnitude < lowerBound)
+                residual = voltageMagnitude - lowerBound;
+            _phaseOneResiduals[busId * numberOfPhases + phaseIndicesInRoot[phaseId]] = residual;
+            result += 0.5 * residual * residual;
+        }
+    }
+    return result;
+}
+
+// phase I on violating subtrees
+bool NetworkControl::restoreFeasibilityByLoads(int numberOfSlots, unordered_set<LoadType> &enabledInControl, int maxRounds) {
+    int numberOfBus = int( _buses.size() );
+    int numberOfPhases = _voltageSensitivity._numberOfPhasesAtRoot;
+    double margin = 0.001;
+    vector<bool> inSubtree(numberOfBus, false);
+    clearScaledGradient(enabledInControl);
+    for (int round = 0; ; round ++) {
+        bool voltageViolation = numberOfSlots == 1 ? voltageViolationAtTime(0) : voltageViolationOverHorizon();
+        if (! voltageViolation)
+            return true;
+        if (round == maxRounds)
+            return false;
+        _telemetry._feasibilityRounds ++;
+        
+        // gradient of the squared residuals, on the subtree of the deepest common ancestor of violating buses
+        double residual = 0.0;
+        for (int timeSlotId = 0; timeSlotId < numberOfSlots; timeSlotId ++) {
+            residual += phaseOneResidualsAtTime(timeSlotId, margin);
+            int ancestorId = -1;
+            for (int entryId = 0; entryId < _phaseOneResiduals.size(); entryId ++) {
+                if (_phaseOneResiduals[entryId] == 0.0)
+                    continue;
+                int busId = entryId / numberOfPhases;
+                ancestorId = ancestorId < 0 ? busId : _voltageSensitivity.commonAncestor(ancestorId, busId);
+            }
+            _voltageSensitivity.injectionPrices(_phaseOneResiduals, _phaseOnePrices);
+            inSubtree[0] = ancestorId == 0;
+            for (int busId = 1; busId < numberOfBus; busId ++) {
+                BusController *bus = _buses[busId];
+                inSubtree[busId] = busId == ancestorId || inSubtree[_voltageSensitivity._parentIds[busId]];
+                const vector<int> &phaseIndicesInRoot = _busPhaseIndicesInRoot[busId];
+                for (int phaseId = 0; phaseId < phaseIndicesInRoot.size(); phaseId ++) {
+                    bus->_gradient[timeSlotId]._data[phaseId] = inSubtree[busId] ?
+                        - _phaseOnePrices[busId * numberOfPhases + phaseIndicesInRoot[phaseId]] : complex_type(0.0, 0.0);
+                }
+            }
+        }
+        
+        // Gauss-Newton step size along the move of the loads at unit step size, in the linearized voltages
+        _stepSize = 1.0;
+        for (int busId = 1; busId < numberOfBus; busId ++) {
+            if (numberOfSlots == 1)
+                _buses[busId]->attemptPowerAtTime(_stepSize, 0, enabledInControl);
+            else
+                _buses[busId]->attemptPowerOverHorizon(_stepSize, enabledInControl);
+        }
+        double slope = 0.0;
+        double curvature = 0.0;
+        for (int timeSlotId = 0; timeSlotId < numberOfSlots; timeSlotId ++) {
+            phaseOneResidualsAtTime(timeSlotId, margin);
+            predictVoltageChangesAtTime(timeSlotId);
+            for (int entryId = 0; entryId < _phaseOneResiduals.size(); entryId ++) {
+                if (_phaseOneResiduals[entryId] == 0.0)
+                    continue;
+                slope += _phaseOneResiduals[entryId] * _predictedVoltageChanges[entryId];
+                curvature += _predictedVoltageChanges[entryId] * _predictedVoltageChanges[entryId];
+            }
+        }
+        if (slope >= 0.0 || curvature <= 0.0)
+            return false;
+        _stepSize = - slope / curvature;
+        
+        // check with power flows
+        bool improved = false;
+        for (int halving = 0; halving < 8 && ! improved; halving ++) {
+            double newResidual = 0.0;
+            if (numberOfSlots == 1) {
+                attemptPowerAtTime(0, enabledInControl);
+                newResidual = phaseOneResidualsAtTime(0, margin);
+            }
+            else {
+                attemptPowerOverHorizon(enabledInControl);
+                for (int timeSlotId = 0; timeSlotId < numberOfSlots; timeSlotId ++)
+                    newResidual += phaseOneResidualsAtTime(timeSlotId, margin);
+            }
+            improved = newResidual < residual;
+            if (! improved)
+                _stepSize *= 0.5;
+        }
+        if (! improved) {
+            if (numberOfSlots == 1)
+                resetPowerAtTime(0, enabledInControl);
+            else
+                resetPowerOverHorizon(enabledInControl);
+            return false;
+        }
+        if (numberOfSlots == 1)
+            updatePowerAtTime(0, enabledInControl);
+        else
+            updatePowerOverHorizon(enabledInControl);
+    }
+}
+
+// number of voltage bounds in a time slot
+// at the minimizer of the barrier problem, every bound contributes mu to the duality gap
+int NetworkControl::numberOfVoltageBoundsAtTime() const {
+    int result = 0;
+    for (int busId = 0; busId < _buses.size(); busId ++) {
+        if (_buses[busId]->_hasVoltageConstraint)
+            result += 2 * int( _buses[busId]->_bus->phase().size() );
+    }
+    return result;
+}
+
+// duality gap of the barrier problem at the current point
+// with the multipliers mu / slack, the gradient of the barrier problem is the gradient of the Lagrangian
+double NetworkControl::measuredDualityGapAtTime(int timeSlotId, unordered_set<LoadType> &enabledInControl) {
+    double result = 0.5 * (_muLower + _muUpper) * numberOfVoltageBoundsAtTime();
+    
+    // decrease predicted by a unit projected gradient step, loads only read the gradient at their own bus
+    computeGradientAtTime(timeSlotId);
+    clearScaledGradient(enabledInControl);
+    double expectedChange = 0.0;
+    for (int busId = 1; busId < _buses.size(); busId ++) {
+        _buses[busId]->attemptPowerAtTime(1.0, timeSlotId, enabledInControl);
+        expectedChange += _buses[busId]->expectedObjectiveValueChangeAtTime(timeSlotId);
+        _buses[busId]->resetPowerAtTime(timeSlotId, enabledInControl);
+    }
+    if (expectedChange < 0.0)
+        result -= expectedChange;
+    return result;
+}
+
+double NetworkControl::measuredDualityGapOverHorizon(unordered_set<LoadType> &enabledInControl) {
+    double result = 0.5 * (_muLower + _muUpper) * numberOfVoltageBoundsAtTime();
+    computeGradientOverHorizon();
+    clearScaledGradient(enabledInControl);
+    double expectedChange = 0.0;
+    for (int busId = 1; busId < _buses.size(); busId ++) {
+        _buses[busId]->attemptPowerOverHorizon(1.0, enabledInControl);
+        expectedChange += _buses[busId]->expectedObjectiveValueChangeOverHorizon();
+        _buses[busId]->resetPowerOverHorizon(enabledInControl);
+    }
+    if (expectedChange < 0.0)
+        result -= expectedChange / _numberOfSlots;
+    return result;
+}
+
+// mu of the next outer iteration in adaptive continuation
+// a point far from the minimizer at mu measures a larger gap, and mu goes down less
+double NetworkControl::nextBarrierParameter(double mu, double measuredGap, double finalMu) const {
+    double centeredMu = std::max(measuredGap / std::max(numberOfVoltageBoundsAtTime(), 1), mu);
+    double nextMu = std::min(_muReductionFactor * centeredMu, std::pow(centeredMu, _muReductionExponent));
+    nextMu = std::min(nextMu, std::sqrt(_muReductionFactor) * mu);
+    return std::max(nextMu, finalMu);
+}
+
+// threshold of power consumption update in the inner loop at mu
+double NetworkControl::barrierInnerLoopThreshold(double mu, double finalMu, double epsilon) const {
+    if (mu <= finalMu)
+        return epsilon;
+    return epsilon * std::pow(mu / finalMu, 0.25);
+}
+
+// outer loop of the solver
+// in each iteration of the outer loop, use a different log-barrier function
+// return the computed objective value
+// muArray is an array of the mu values to be used in the inner loop, alpha is the backoff parameter, beta is the linearization quantification parameter, and epsilon is the threshold of power consumptions update
+double NetworkControl::fastControlOuterLoop(std::vector<double> muArray, double alpha, double beta, double epsilon) {
+    std::chrono::steady_clock::time_point phaseStartTime = std::chrono::steady_clock::now();
+    
+    /******************************
+     get a feasible point
+     via substation voltage and phase I on violating subtrees
+     ******************************/
+    bool feasible = restoreFeasibility(1, _enabledInFastControl);
+    
+    
+    /******************************
+     get a feasible point
+     via optimizations, if the above fails
+     ******************************/
+    double voltageLowerBound = _buses.back()->_voltageMin;
+    double voltageUpperBound = _buses.back()->_voltageMax;
+    for (int iteration = 0; ! feasible; iteration ++) {
+        double voltageMin = _substationVoltage;
+        double voltageMax = _substationVoltage;
+        bool voltageViolation = false;
+        
+        // compute current voltageMin, voltageMax, and voltageViolation
+        // violations of the original range are kept in _voltageViolations
+        _voltageViolations.clear();
+        for (int busId = 0; busId < _buses.size(); busId ++) {
+            if (! _buses[busId]->_hasVoltageConstraint)
+                continue;
+            BusController *bus = _buses[busId];
+            ColumnVector<complex_type> voltage = bus->_voltages[0];
+            for (int phaseId = 0; phaseId < voltage.size(); phaseId ++) {
+                double voltageMagnitude = std::sqrt(std::norm(voltage[phaseId]));
+                if ( voltageMagnitude > voltageMax )
+                    voltageMax = voltageMagnitude;
+                if ( voltageMagnitude < voltageMin )
+                    voltageMin = voltageMagnitude;
+                if ( voltageMagnitude < voltageLowerBound || voltageMagnitude > voltageUpperBound )
+                    _voltageViolations.record(bus, phaseId, 0, voltageMagnitude, voltageLowerBound, voltageUpperBound);
+            }
+        }
+        if (voltageMin < voltageLowerBound)
+            voltageViolation = true;
+        if (voltageMax > voltageUpperBound)
+            voltageViolation = true;
+        
+        // escape if voltage is within range
+        if (!voltageViolation)  {
+            for (int busId = 0; busId < _buses.size(); busId ++) {
+                _buses[busId]->_voltageMin = voltageLowerBound;
+                _buses[busId]->_voltageMax = voltageUpperBound;
+            }
+            break;
+        }
+        
+        if (iteration == 15) {
+            std::cout << "failed to find a feasible solution to start computation!" << std::endl;
+            _telemetry._feasibilitySeconds = SolverTelemetry::secondsSince(phaseStartTime);
+            return 0.0;
+        }
+        
+        // out of time, keep the least violating point so far
+        if (fastControlDeadlinePassed()) {
+            for (int busId = 0; busId < _buses.size(); busId ++) {
+                _buses[busId]->_voltageMin = voltageLowerBound;
+                _buses[busId]->_voltageMax = voltageUpperBound;
+            }
+            _telemetry._feasibilitySeconds = SolverTelemetry::secondsSince(phaseStartTime);
+            return 0.0;
+        }
+        
+        // do optimization to drive voltage away from boundary
+        voltageMin -= 0.001;
+        if (voltageMin > voltageLowerBound)
+            voltageMin = voltageLowerBound;
+        voltageMax += 0.001;
+        if (voltageMax < voltageUpperBound)
+            voltageMax = voltageUpperBound;
+        if (_voltageViolations._sink != NULL) {
+            *_voltageViolations._sink << "\tvoltageMin = " << voltageMin << '\n';
+            *_voltageViolations._sink << "\tvoltageMax = " << voltageMax << '\n';
+        }
+        for (int busId = 0; busId < _buses.size(); busId ++) {
+            _buses[busId]->_voltageMin = voltageMin;
+            _buses[busId]->_voltageMax = voltageMax;
+        }
+        
+        double mu = 1.0;
+        _muLower = mu;
+        _muUpper = mu;
+        _telemetry._feasibilityRounds ++;
+        _telemetry._feasibilityIterations += fastControlInnerLoop(alpha, beta, epsilon);
+    }
+    _telemetry._feasibilitySeconds = SolverTelemetry::secondsSince(phaseStartTime);
+    phaseStartTime = std::chrono::steady_clock::now();
+    
+    // set muArray to default value if empty
+    // adaptive continuation appends every next mu once the inner loop at the last one is done
+    bool adaptive = _targetGap > 0.0 && muArray.size() == 0;
+    const int maxFinalRepeats = 3;      // inner loops at finalMu after the first, each with a ten times smaller threshold
+    double finalMu = 0.0;
+    if (adaptive) {
+        int numBus = (int) _buses.size();
+        // complementarity at finalMu is half of the target, the rest is left to the stationarity of the inner loop
+        finalMu = 0.5 * _targetGap / std::max(numberOfVoltageBoundsAtTime(), 1);
+        muArray.push_back(std::max(_handedOff ? _planMu : 1.00/numBus, finalMu));
+    }
+    if (muArray.size() == 0 && _handedOff) {
+        muArray.push_back(_planMu);
+    }
+    if (muArray.size() == 0) {
+        int numBus = (int) _buses.size();
+        muArray.push_back(1.00/numBus);
+        muArray.push_back(0.10/numBus);
+        muArray.push_back(0.01/numBus);
+        muArray.push_back(0.001/numBus);
+    }
+    
+    // run inner loop for each of the mu values
+    // every accepted point is feasible, so the schedule can stop at the deadline
+    int finalRepeats = 0;
+    double lastGap = 0.0;
+    for (int i=0; i<muArray.size() && ! fastControlDeadlinePassed(); i++)
+    {
+        double mu = muArray[i];
+        // printf("mu = %13.12f:\n", mu);
+        _muLower = mu;
+        _muUpper = mu;
+        _telemetry._outerIterations ++;
+        _telemetry._muValues.push_back(mu);
+        double threshold = adaptive ? barrierInnerLoopThreshold(mu, finalMu, epsilon) * std::pow(0.1, finalRepeats) : epsilon;
+        _telemetry._innerIterationsPerMu.push_back(fastControlInnerLoop(alpha, beta, threshold));
+        
+        // the measured gap decides the next mu, and whether to go on
+        if (adaptive) {
+            double gap = measuredDualityGapAtTime(0, _enabledInFastControl);
+            _telemetry._dualityGaps.push_back(gap);
+            if (gap > _targetGap && mu > finalMu)
+                muArray.push_back(nextBarrierParameter(mu, gap, finalMu));
+            else if (gap > _targetGap && finalRepeats < maxFinalRepeats && (lastGap == 0.0 || gap < 0.5 * lastGap)) {
+                finalRepeats ++;
+                muArray.push_back(finalMu);
+            }
+            lastGap = gap;
+        }
+    }
+    _telemetry._optimizationSeconds = SolverTelemetry::secondsSince(phaseStartTime);
+    
+    // compute power flow and return objective value
+    _muLower = 0;
+    _muUpper = 0;
+    // std::cout << "\tObjective value is " << objectiveValueAtTime(0) << std::endl;
+    return objectiveValueAtTime(0);
+}
+
+double NetworkControl::slowControlOuterLoop(std::vector<double> muArray, double alpha, double beta, double epsilon) {
+    _slowControlIterations = 0;
+    std::chrono::steady_clock::time_point phaseStartTime = std::chrono::steady_clock::now();
+    double voltageLowerBound = _buses.back()->_voltageMin;
+    double voltageUpperBound = _buses.back()->_voltageMax;
+    
+    // a feasible warm start needs no search
+    bool feasible = _warmStarted && ! voltageViolationOverHorizon();
+    
+    /******************************
+     get a feasible point
+     via substation voltage and phase I on violating subtrees
+     ******************************/
+    if (! feasible)
+        feasible = restoreFeasibility(_numberOfSlots, _enabledInSlowControl);
+    
+    
+    /******************************
+     get a feasible point
+     via subsequent optimizations, if the above fails
+     ******************************/
+    for (int iteration = 0; ! feasible; iteration ++) {
+        double voltageMin = _substationVoltage;
+        double voltageMax = _substationVoltage;
+        bool voltageViolation = false;
+        
+        // compute current voltageMin, voltageMax, and voltageViolation
+        // violations of the original range are kept in _voltageViolations
+        _voltageViolations.clear();
+        for (int busId = 0; busId < _buses.size(); busId ++) {
+            if (! _buses[busId]->_hasVoltageConstraint)
+                continue;
+            BusController *bus = _buses[busId];
+            for (int timeSlotId = 0; timeSlotId < bus->_voltages.size(); timeSlotId ++) {
+                ColumnVector<complex_type> voltage = bus->_voltages[timeSlotId];
+                for (int phaseId = 0; phaseId < voltage.size(); phaseId ++) {
+                    double voltageMagnitude = std::sqrt(std::norm(voltage[phaseId]));
+                    if ( voltageMagnitude > voltageMax )
+                        voltageMax = voltageMagnitude;
+                    if ( voltageMagnitude < voltageMin )
+                        voltageMin = voltageMagnitude;
+                    if ( voltageMagnitude < voltageLowerBound || voltageMagnitude > voltageUpperBound )
+                        _voltageViolations.record(bus, phaseId, timeSlotId, voltageMagnitude, voltageLowerBound, voltageUpperBound);
+                }
+            }
+        }
+        if (voltageMin < voltageLowerBound)
+            voltageViolation = true;
+        if (voltageMax > voltageUpperBound)
+            voltageViolation = true;
+        
+        // escape if voltage is within range
+        if (!voltageViolation)  {
+            for (int busId = 0; busId < _buses.size(); busId ++) {
+                _buses[busId]->_voltageMin = voltageLowerBound;
+                _buses[busId]->_voltageMax = voltageUpperBound;
+            }
+            break;
+        }
+        
+        if (iteration == 15) {
+            std::cout << "failed to find a feasible solution to start computation!" << std::endl;
+            _telemetry._feasibilitySeconds = SolverTelemetry::secondsSince(phaseStartTime);
+            return 0.0;
+        }
+        
+        // do optimization to drive voltage away from boundary
+        voltageMin -= 0.001;
+        if (voltageMin > voltageLowerBound)
+            voltageMin = voltageLowerBound;
+        voltageMax += 0.001;
+        if (voltageMax < voltageUpperBound)
+            voltageMax = voltageUpperBound;
+        if (_voltageViolations._sink != NULL) {
+            *_voltageViolations._sink << "\tvoltageMin = " << voltageMin << '\n';
+            *_voltageViolations._sink << "\tvoltageMax = " << voltageMax << '\n';
+        }
+        for (int busId = 0; busId < _buses.size(); busId ++) {
+            _buses[busId]->_voltageMin = voltageMin;
+            _buses[busId]->_voltageMax = voltageMax;
+        }
+        
+        double mu = 1.0;
+        _muLower = mu;
+        _muUpper = mu;
+        int iterations = slowControlInnerLoop(alpha, beta, epsilon);
+        _slowControlIterations += iterations;
+        _telemetry._feasibilityRounds ++;
+        _telemetry._feasibilityIterations += iterations;
+    }
+    _telemetry._feasibilitySeconds = SolverTelemetry::secondsSince(phaseStartTime);
+    phaseStartTime = std::chrono::steady_clock::now();
+    
+    /******************************
+     start gradient decent from a feasible solution
+     ******************************/
+    // adaptive continuation appends every next mu once the inner loop at the last one is done
+    bool adaptive = _targetGap > 0.0 && muArray.size() == 0;
+    const int maxFinalRepeats = 3;      // inner loops at finalMu after the first, each with a ten times smaller threshold
+    double finalMu = 0.0;
+    if (adaptive) {
+        int numBus = (int) _buses.size();
+        // complementarity at finalMu is half of the target, the rest is left to the stationarity of the inner loop
+        finalMu = 0.5 * _targetGap / std::max(numberOfVoltageBoundsAtTime(), 1);
+        muArray.push_back(std::max(_warmStarted ? _warmStartMu : 1.00/numBus, finalMu));
+    }
+    if (muArray.size() == 0 && _warmStarted) {
+        muArray.push_back(_warmStartMu);
+    }
+    if (muArray.size() == 0) {
+        int numBus = (int) _buses.size();
+        muArray.push_back(1.00/numBus);
+        muArray.push_back(0.10/numBus);
+        muArray.push_back(0.01/numBus);
+        muArray.push_back(0.001/numBus);
+        if (_slowControlMethod == QUASI_NEWTON)
+            muArray.push_back(0.0001/numBus);
+    }
+    
+    // run inner loop for each of the mu values
+    int finalRepeats = 0;
+    double lastGap = 0.0;
+    for (int i=0; i<muArray.size(); i++)
+    {
+        double mu = muArray[i];
+        // printf("\tmu = %13.12f:\n", mu);
+        _muLower = mu;
+        _muUpper = mu;
+        double threshold = adaptive ? barrierInnerLoopThreshold(mu, finalMu, epsilon) * std::pow(0.1, finalRepeats) : epsilon;
+        int iterations = slowControlInnerLoop(alpha, beta, threshold);
+        _slowControlIterations += iterations;
+        _telemetry._outerIterations ++;
+        _telemetry._muValues.push_back(mu);
+        _telemetry._innerIterationsPerMu.push_back(iterations);
+        
+        // the measured gap decides the next mu, and whether to go on
+        if (adaptive) {
+            double gap = measuredDualityGapOverHorizon(_enabledInSlowControl);
+            _telemetry._dualityGaps.push_back(gap);
+            if (gap > _targetGap && mu > finalMu)
+                muArray.push_back(nextBarrierParameter(mu, gap, finalMu));
+            else if (gap > _targetGap && finalRepeats < maxFinalRepeats && (lastGap == 0.0 || gap < 0.5 * lastGap)) {
+                finalRepeats ++;
+                muArray.push_back(finalMu);
+            }
+            lastGap = gap;
+        }
+    }
+    _telemetry._optimizationSeconds = SolverTelemetry::secondsSince(phaseStartTime);
+    _warmStartMu = muArray.back();
+    
+    // compute power flow and return objective value
+    _muLower = 0;
+    _muUpper = 0;
+    // std::cout << "\tObjective value is " << objectiveValueAtTime(0) << std::endl;
+    return objectiveValueAtTime(0);
+}
+
+// inner loop of the solver
+// in each iteration of the inner loop, do gradient decent to solve the OPF problem with a fixed log barrier function
+// return the number of iterations used
+// muLow is the mu value used in log(v-vMin), muUpp is the mu value used in log(vMax-v), alpha is the backoff parameter, beta is the linearization quantification parameter, and epsilon is the threshold of power consumptions update
+int NetworkControl::fastControlInnerLoop(double alpha, double beta, double epsilon) {
+    if (_fastControlMethod == INTERIOR_POINT)
+        return fastControlInteriorPointInnerLoop(alpha, beta, epsilon);
+    if ( ! _areaBusIds.empty() )
+        return fastControlDistributedInnerLoop(alpha, beta, epsilon);
+    
+    // update till improvements get too small
+    int iteration = 1;
+    
+    // compute objective value
+    // later iterations take it from the accepted step
+    ControlEvaluation evaluation = evaluateAtTime(0);
+    if ( evaluation._voltageViolation ) {
+        std::cout << "Network::inner_loop---Must start with a feasible point!" << std::endl;
+        return 1;
+    }
+    _oldObjectiveValue = evaluation._objectiveValue;
+    
+    while ( sizeof("Take a step") )
+    {
+        // printf("    Iteration %3d, ", iteration++);
+        // printf("value_old = %+-7.6f, ", _oldObjectiveValue);
+        
+        // compute gradient
+        computeGradientAtTime(0);
+        
+        // intialize step size
+        _stepSize = 1.0;
+        if (_predictStepSize)
+            predictStepSizeAtTime(0, alpha, _enabledInFastControl);
+        
+        // line search
+        while ( sizeof("Determine a step size") )
+        {
+            // out of time, return to the last accepted point
+            if (fastControlDeadlinePassed()) {
+                resetPowerAtTime(0, _enabledInFastControl);
+                computePowerFlowAtTime(0);
+                return iteration;
+            }
+            
+            // attempt a step size
+            attemptPowerAtTime(0, _enabledInFastControl);
+            
+            // if voltage violation happens, back off step size
+            evaluation = evaluateAtTime(0);
+            if ( evaluation._voltageViolation ) {
+                _stepSize *= alpha;
+                _lineSearchBacktracks ++;
+                // std::cout << "voltage violation back off step size to " << _stepSize << std::endl;
+                continue;
+            }
+            double newObjectiveValue = evaluation._objectiveValue;
+            
+            // if update too small, prepare for return
+            if (evaluation._updateSize < epsilon)// ||
+                // fabs(newObjectiveValue - _oldObjectiveValue) / fabs(_oldObjectiveValue) < 1e-7)
+            {
+                if (newObjectiveValue < _oldObjectiveValue)
+                    updatePowerAtTime(0, _enabledInFastControl);
+                else
+                    resetPowerAtTime(0, _enabledInFastControl);
+                
+                // printf("stepSize = %5.4f, value = %+-7.6f\n", _stepSize, (newObjectiveValue < _oldObjectiveValue ? newObjectiveValue : _oldObjectiveValue));
+                return iteration;
+            }
+            
+            // if value is big, back off step size
+            if (newObjectiveValue > _oldObjectiveValue + beta * evaluation._expectedObjectiveValueChange) {
+                _stepSize *= alpha;
+                _lineSearchBacktracks ++;
+                // std::cout << "not progressing back off step size to " << _stepSize << std::endl;
+            }
+            
+            // else update power
+            else
+            {
+                updatePowerAtTime(0, _enabledInFastControl);
+                _oldObjectiveValue = newObjectiveValue;
+                iteration ++;
+                // printf("stepSize = %5.4f, value = %+-7.6f\n", _stepSize, newObjectiveValue);
+                break;
+            }
+            
+        }
+    }
+}
+
+int NetworkControl::fastControlInteriorPointInnerLoop(double alpha, double beta, double epsilon) {
+    const double minimumRegularization = 1e-4;
+    const double maximumRegularization = 1e4;
+    
+    // update till improvements get too small
+    int iteration = 1;
+    double regularization = 1.0;
+    
+    // compute objective value
+    // later iterations take it from the accepted step
+    ControlEvaluation evaluation = evaluateAtTime(0);
+    if ( evaluation._voltageViolation ) {
+        std::cout << "Network::inner_loop---Must start with a feasible point!" << std::endl;
+        return 1;
+    }
+    _oldObjectiveValue = evaluation._objectiveValue;
+    
+    while ( sizeof("Take a step") )
+    {
+        // compute gradient and Newton step, moving along the gradient if the Newton system is singular
+        computeGradientAtTime(0);
+        if ( ! computeNewtonStepAtTime(0, regularization, _enabledInFastControl) )
+            clearScaledGradient(_enabledInFastControl);
+        
+        // intialize step size
+        _stepSize = 1.0;
+        
+        // line search
+        while ( sizeof("Determine a step size") )
+        {
+            // out of time, return to the last accepted point
+            if (fastControlDeadlinePassed()) {
+                resetPowerAtTime(0, _enabledInFastControl);
+                computePowerFlowAtTime(0);
+                clearScaledGradient(_enabledInFastControl);
+                return iteration;
+            }
+            
+            // attempt a step size
+            attemptPowerAtTime(0, _enabledInFastControl);
+            
+            // if voltage violation happens, back off step size
+            evaluation = evaluateAtTime(0);
+            if ( evaluation._voltageViolation ) {
+                _stepSize *= alpha;
+                _lineSearchBacktracks ++;
+                continue;
+            }
+            double newObjectiveValue = evaluation._objectiveValue;
+            
+            // if update too small, prepare for return
+            if (evaluation._updateSize < epsilon) {
+                if (newObjectiveValue < _oldObjectiveValue)
+                    updatePowerAtTime(0, _enabledInFastControl);
+                else
+                    resetPowerAtTime(0, _enabledInFastControl);
+                clearScaledGradient(_enabledInFastControl);
+                return iteration;
+            }
+            
+            // if value is big, back off step size
+            if (newObjectiveValue > _oldObjectiveValue + beta * evaluation._expectedObjectiveValueChange) {
+                _stepSize *= alpha;
+                _lineSearchBacktracks ++;
+            }
+            
+            // else update power, and trust the quadratic model more if the full step was taken
+            else {
+                updatePowerAtTime(0, _enabledInFastControl);
+                _oldObjectiveValue = newObjectiveValue;
+                iteration ++;
+                if (_stepSize == 1.0)
+                    regularization = std::max(regularization / 4.0, minimumRegularization);
+                else
+                    regularization = std::min(regularization * 4.0, maximumRegularization);
+                break;
+            }
+        }
+    }
+}
+
+// the Newton system of the barrier problem, in root phases
+// voltages enter through the Gauss-Newton curvature of the barrier in |V|, and the substation through its quadratic cost
+bool NetworkControl::computeNewtonStepAtTime(int timeSlotId, double regularization, unordered_set<LoadType> &enabledInControl) {
+    int numberOfPhasesAtRoot = _kktSolver._numberOfPhasesAtRoot;
+    int numberOfFlows = _kktSolver.numberOfFlowComponents();
+    _kktSolver.reset();
+    for (int phaseId = 0; phaseId < numberOfPhasesAtRoot; phaseId ++)
+        _kktSolver._rootCurvatures[phaseId] = 2 * _quadCoef;
+    
+    // curvatures of the barrier at every bus, and compliances of the free load components
+    for (int busId = 1; busId < _buses.size(); busId ++) {
+        BusController *bus = _buses[busId];
+        const vector<int> &phaseIndicesInRoot = _busPhaseIndicesInRoot[busId];
+        if (bus->_hasVoltageConstraint) {
+            double voltageMinSquare = bus->_voltageMin * bus->_voltageMin;
+            double voltageMaxSquare = bus->_voltageMax * bus->_voltageMax;
+            for (int phaseId = 0; phaseId < phaseIndicesInRoot.size(); phaseId ++) {
+                double voltageSquare = std::norm( bus->_voltages[timeSlotId]._data[phaseId] );
+                double lowerSlack = voltageSquare - voltageMinSquare;
+                double upperSlack = voltageMaxSquare - voltageSquare;
+                double curvature = _muLower / (lowerSlack * lowerSlack) + _muUpper / (upperSlack * upperSlack);
+                _kktSolver._voltageCurvatures[busId * numberOfPhasesAtRoot + phaseIndicesInRoot[phaseId]] = 4 * voltageSquare * curvature;
+            }
+        }
+        for (int loadId = 0; loadId < bus->_loadArray.size(); loadId ++) {
+            LoadController *load = bus->_loadArray[loadId];
+            if (enabledInControl.find(load->_load->type()) == enabledInControl.end())
+                continue;
+            ColumnVector<complex_type> freeDirections(int( load->_phaseIndicesInLocationBus.size() ));
+            for (int phaseId = 0; phaseId < freeDirections.size(); phaseId ++)
+                freeDirections._data[phaseId] = complex_type(1.0, 1.0);
+            load->projectOntoFreeDirectionsAtTime(timeSlotId, freeDirections);
+            for (int phaseId = 0; phaseId < freeDirections.size(); phaseId ++) {
+                int phaseIdInBus = load->_phaseIndicesInLocationBus[phaseId];
+                int flowId = busId * numberOfFlows + phaseIndicesInRoot[phaseIdInBus];
+                complex_type gradient = bus->_gradient[timeSlotId]._data[phaseIdInBus];
+                if (freeDirections._data[phaseId].real() != 0.0) {
+                    _kktSolver._loadCompliances[flowId] += 1.0 / regularization;
+                    _kktSolver._loadGradients[flowId] += gradient.real() / regularization;
+                }
+                if (freeDirections._data[phaseId].imag() != 0.0) {
+                    _kktSolver._loadCompliances[flowId + numberOfPhasesAtRoot] += 1.0 / regularization;
+                    _kktSolver._loadGradients[flowId + numberOfPhasesAtRoot] += gradient.imag() / regularization;
+                }
+            }
+        }
+    }
+    if ( ! _kktSolver.solve() )
+        return false;
+    if (_checkNewtonSteps) {
+        double error = _kktSolver.denseSolveError();
+        if (error < 0.0 || error > 1e-8)
+            std::cout << "Newton step differs from the dense solve by " << error << " at time slot " << timeSlotId << std::endl;
+    }
+    
+    // every free component steps by -(gradient + flow price) / regularization
+    for (int busId = 1; busId < _buses.size(); busId ++) {
+        BusController *bus = _buses[busId];
+        const vector<int> &phaseIndicesInRoot = _busPhaseIndicesInRoot[busId];
+        for (int loadId = 0; loadId < bus->_loadArray.size(); loadId ++) {
+            LoadController *load = bus->_loadArray[loadId];
+            if (enabledInControl.find(load->_load->type()) == enabledInControl.end())
+                continue;
+            int numberOfPhases = int( load->_phaseIndicesInLocationBus.size() );
+            ColumnVector<complex_type> freeDirections(numberOfPhases);
+            for (int phaseId = 0; phaseId < numberOfPhases; phaseId ++)
+                freeDirections._data[phaseId] = complex_type(1.0, 1.0);
+            load->projectOntoFreeDirectionsAtTime(timeSlotId, freeDirections);
+            if (load->_scaledGradient.size() != load->_valueArray.size())
+                load->_scaledGradient.assign(load->_valueArray.size(), ColumnVector<complex_type>(numberOfPhases));
+            for (int phaseId = 0; phaseId < numberOfPhases; phaseId ++) {
+                int phaseIdInBus = load->_phaseIndicesInLocationBus[phaseId];
+                int flowId = busId * numberOfFlows + phaseIndicesInRoot[phaseIdInBus];
+                complex_type gradient = bus->_gradient[timeSlotId]._data[phaseIdInBus];
+                double realPart = freeDirections._data[phaseId].real() == 0.0 ? 0.0 : (gradient.real() + _kktSolver._flowPrices[flowId]) / regularization;
+                double imagPart = freeDirections._data[phaseId].imag() == 0.0 ? 0.0 : (gradient.imag() + _kktSolver._flowPrices[flowId + numberOfPhasesAtRoot]) / regularization;
+                load->_scaledGradient[timeSlotId]._data[phaseId] = complex_type(realPart, imagPart);
+            }
+        }
+    }
+    return true;
+}
+
+// loads move along the gradient again
+void NetworkControl::clearScaledGradient(unordered_set<LoadType> &enabledInControl) {
+    for (int busId = 1; busId < _buses.size(); busId ++) {
+        BusController *bus = _buses[busId];
+        for (int loadId = 0; loadId < bus->_loadArray.size(); loadId ++) {
+            LoadController *load = bus->_loadArray[loadId];
+            if (enabledInControl.find(load->_load->type()) != enabledInControl.end())
+                load->_scaledGradient.clear();
+        }
+    }
+}
+
+int NetworkControl::slowControlInnerLoop(double alpha, double beta, double epsilon) {
+    if (_slowControlMethod == ACCELERATED_PROJECTED_GRADIENT)
+        return slowControlAcceleratedInnerLoop(alpha, beta, epsilon);
+    if (_slowControlMethod == BARZILAI_BORWEIN)
+        return slowControlBarzilaiBorweinInnerLoop(alpha, beta, epsilon);
+    if (_slowControlMethod == ADMM_TEMPORAL_DECOMPOSITION)
+        return slowControlAdmmInnerLoop(alpha, beta, epsilon);
+    if (_slowControlMethod == QUASI_NEWTON)
+        return slowControlQuasiNewtonInnerLoop(alpha, beta, epsilon);
+    return slowControlProjectedGradientInnerLoop(alpha, beta, epsilon);
+}
+
+int NetworkControl::slowControlProjectedGradientInnerLoop(double alpha, double beta, double epsilon) {
+    // update till improvements get too small
+    int iteration = 1;
+    
+    // compute objective value
+    // later iterations take it from the accepted step
+    ControlEvaluation evaluation = evaluateOverHorizon();
+    if ( evaluation._voltageViolation ) {
+        std::cout << "Network::inner_loop---Must start with a feasible point!" << std::endl;
+        return 1;
+    }
+    _oldObjectiveValue = evaluation._objectiveValue;
+    
+    while ( sizeof("Take a step") )
+    {
+        // printf("\t\tIteration %3d, ", iteration++);
+        // printf("value_old = %+-7.6f, ", _oldObjectiveValue);
+        
+        // compute gradient
+        computeGradientOverHorizon();
+        _stepSizeCandidates.clear();
+        // printViolatedVoltages(std::cout);
+        
+        // intialize step size
+        _stepSize = 1.0;
+        if (_predictStepSize)
+            predictStepSizeOverHorizon(alpha, _enabledInSlowControl);
+        
+        // line search
+        while ( sizeof("Determine a step size") )
+        {
+            // attempt a step size
+            // if voltage violation happens, back off step size
+            evaluation = attemptAndEvaluateOverHorizon(alpha, _enabledInSlowControl);
+            if ( evaluation._voltageViolation ) {
+                _stepSize *= alpha;
+                _lineSearchBacktracks ++;
+                // std::cout << "voltage violation back off step size to " << _stepSize << '\t';
+                continue;
+            }
+            double newObjectiveValue = evaluation._objectiveValue;
+            
+            // if update too small, prepare for return
+            if (evaluation._updateSize < epsilon)// ||
+                //fabs(newObjectiveValue - _oldObjectiveValue) / fabs(_oldObjectiveValue) < 1e-7)
+            {
+                if (newObjectiveValue < _oldObjectiveValue)
+                    updatePowerOverHorizon(_enabledInSlowControl);
+                else
+                    resetPowerOverHorizon(_enabledInSlowControl);
+                
+                // printf("stepSize = %5.4f, value = %+-7.6f\n", _stepSize, (newObjectiveValue < _oldObjectiveValue ? newObjectiveValue : _oldObjectiveValue));
+                return iteration;
+            }
+            
+            // if value is big, back off step size
+            if (newObjectiveValue > _oldObjectiveValue + beta * evaluation._expectedObjectiveValueChange) {
+                _stepSize *= alpha;
+                _lineSearchBacktracks ++;
+                // std::cout << "not progressing back off step size to " << _stepSize << '\t';
+            }
+            
+            // else update power
+            else {
+                updatePowerOverHorizon(_enabledInSlowControl);
+                _oldObjectiveValue = newObjectiveValue;
+                iteration ++;
+                // printf("stepSize = %5.4f, value = %+-7.6f\n", _stepSize, newObjectiveValue);
+                break;
+            }
+            
+        }
+    }
+}
+
+int NetworkControl::slowControlAcceleratedInnerLoop(double alpha, double beta, double epsilon) {
+    // update till improvements get too small
+    int iteration = 1;
+    double momentumWeight = 1.0;
+    
+    // compute objective value at the accepted point
+    ControlEvaluation evaluation = evaluateOverHorizon();
+    if ( evaluation._voltageViolation ) {
+        std::cout << "Network::inner_loop---Must start with a feasible point!" << std::endl;
+        return 1;
+    }
+    double acceptedObjectiveValue = evaluation._objectiveValue;
+    
+    while ( sizeof("Take a step") )
+    {
+        // extrapolate along the last step
+        double nextMomentumWeight = (1.0 + std::sqrt(1.0 + 4.0 * momentumWeight * momentumWeight)) / 2.0;
+        double momentum = (momentumWeight - 1.0) / nextMomentumWeight;
+        extrapolatePowerOverHorizon(momentum, _enabledInSlowControl);
+        _oldObjectiveValue = acceptedObjectiveValue;
+        if (momentum > 0.0) {
+            evaluation = evaluateOverHorizon();
+            
+            // restart if the extrapolated point violates voltages
+            if ( evaluation._voltageViolation ) {
+                rollBackPowerOverHorizon(_enabledInSlowControl);
+                momentumWeight = 1.0;
+                continue;
+            }
+            _oldObjectiveValue = evaluation._objectiveValue;
+        }
+        
+        // compute gradient at the extrapolated point
+        computeGradientOverHorizon();
+        
+        // intialize step size
+        _stepSize = 1.0;
+        
+        // line search from the extrapolated point
+        while ( sizeof("Determine a step size") )
+        {
+            // attempt a step size
+            attemptPowerOverHorizon(_enabledInSlowControl);
+            
+            // if voltage violation happens, back off step size
+            evaluation = evaluateOverHorizon();
+            if ( evaluation._voltageViolation ) {
+                _stepSize *= alpha;
+                _lineSearchBacktracks ++;
+                continue;
+            }
+            
+            // stop if update is too small, or value is small enough
+            if (evaluation._updateSize < epsilon ||
+                evaluation._objectiveValue <= _oldObjectiveValue + beta * evaluation._expectedObjectiveValueChange)
+                break;
+            
+            // else back off step size
+            _stepSize *= alpha;
+            _lineSearchBacktracks ++;
         }
+        double newObjectiveValue = evaluation._objectiveValue;
         
-        double mu = 1.0;
-        _muLower = mu;
-        _muUpper = mu;
-        slowControlInnerLoop(alpha, beta, epsilon);
-    }
-    
-    
-    /******************************
-     start gradient decent from a feasible solution
-     ******************************/
-    if (muArray.size() == 0) {
-        int numBus = (int) _buses.size();
-        muArray.push_back(1.00/numBus);
-        muArray.push_back(0.10/numBus);
-        muArray.push_back(0.01/numBus);
-        muArray.push_back(0.001/numBus);
-    }
-    
-    // run inner loop for each of the mu values
-    for (int i=0; i<muArray.size(); i++)
-    {
-        double mu = muArray[i];
-        // printf("\tmu = %13.12f:\n", mu);
-        _muLower = mu;
-        _muUpper = mu;
-        slowControlInnerLoop(alpha, beta, epsilon);
+        // keep the new point if it improves on the accepted one, otherwise restart from the accepted one
+        bool improved = newObjectiveValue < acceptedObjectiveValue;
+        if (improved) {
+            updatePowerOverHorizon(_enabledInSlowControl);
+            acceptedObjectiveValue = newObjectiveValue;
+            momentumWeight = nextMomentumWeight;
+            iteration ++;
+        }
+        else {
+            rollBackPowerOverHorizon(_enabledInSlowControl);
+            momentumWeight = 1.0;
+        }
+        
+        // a small or useless step from the accepted point means convergence,
+        // while a small step after extrapolation only restarts
+        if (momentum == 0.0 &&
+            (evaluation._updateSize < epsilon || !improved)) {
+            _oldObjectiveValue = acceptedObjectiveValue;
+            return iteration;
+        }
+        if (evaluation._updateSize < epsilon)
+            momentumWeight = 1.0;
     }
-    
-    // compute power flow and return objective value
-    _muLower = 0;
-    _muUpper = 0;
-    // std::cout << "\tObjective value is " << objectiveValueAtTime(0) << std::endl;
-    return objectiveValueAtTime(0);
 }
 
-// inner loop of the solver
-// in each iteration of the inner loop, do gradient decent to solve the OPF problem with a fixed log barrier function
-// return the number of iterations used
-// muLow is the mu value used in log(v-vMin), muUpp is the mu value used in log(vMax-v), alpha is the backoff parameter, beta is the linearization quantification parameter, and epsilon is the threshold of power consumptions update
-int NetworkControl::fastControlInnerLoop(double alpha, double beta, double epsilon) {
+int NetworkControl::slowControlBarzilaiBorweinInnerLoop(double alpha, double beta, double epsilon) {
+    const int numberOfReferenceValues = 10;     // recent objective values a step is compared with
+    const double minStepSize = 1e-4;            // bounds on the Barzilai-Borwein step size
+    const double maxStepSize = 1e4;
+    
     // update till improvements get too small
     int iteration = 1;
+    
+    // compute objective value
+    // later iterations take it from the accepted step
+    ControlEvaluation evaluation = evaluateOverHorizon();
+    if ( evaluation._voltageViolation ) {
+        std::cout << "Network::inner_loop---Must start with a feasible point!" << std::endl;
+        return 1;
+    }
+    _oldObjectiveValue = evaluation._objectiveValue;
+    deque<double> referenceValues(1, _oldObjectiveValue);
+    
     while ( sizeof("Take a step") )
     {
-        // printf("    Iteration %3d, ", iteration++);
+        // compute gradient, keeping the previous one
+        for (int busId = 0; busId < _buses.size(); busId ++)
+            _buses[busId]->_oldGradient.swap(_buses[busId]->_gradient);
+        computeGradientOverHorizon();
         
-        // compute objective value
-        if ( voltageViolationAtTime(0) == true ) {
-            std::cout << "Network::inner_loop---Must start with a feasible point!" << std::endl;
-            return 1;
+        // intialize step size from the last step and gradient change
+        _stepSize = 1.0;
+        if (iteration > 1) {
+            double stepSquare = 0.0;
+            double stepDotGradientChange = 0.0;
+            for (int busId = 1; busId < _buses.size(); busId ++)
+                _buses[busId]->addStepProductsOverHorizon(stepSquare, stepDotGradientChange, _enabledInSlowControl);
+            if (stepDotGradientChange > 0.0) {
+                _stepSize = stepSquare / stepDotGradientChange;
+                if (_stepSize < minStepSize)
+                    _stepSize = minStepSize;
+                if (_stepSize > maxStepSize)
+                    _stepSize = maxStepSize;
+            }
         }
-        _oldObjectiveValue = objectiveValueAtTime(0);
-        // printf("value_old = %+-7.6f, ", _oldObjectiveValue);
         
-        // compute gradient
-        computeGradientAtTime(0);
+        // remember the current point for the next step size
+        extrapolatePowerOverHorizon(0.0, _enabledInSlowControl);
         
-        // intialize step size
-        _stepSize = 1.0;
+        // the largest recent objective value
+        double referenceValue = referenceValues[0];
+        for (int valueId = 1; valueId < referenceValues.size(); valueId ++) {
+            if (referenceValues[valueId] > referenceValue)
+                referenceValue = referenceValues[valueId];
+        }
         
         // line search
         while ( sizeof("Determine a step size") )
         {
             // attempt a step size
-            attemptPowerAtTime(0, _enabledInFastControl);
+            attemptPowerOverHorizon(_enabledInSlowControl);
             
             // if voltage violation happens, back off step size
-            if ( voltageViolationAtTime(0) == true ) {
+            evaluation = evaluateOverHorizon();
+            if ( evaluation._voltageViolation ) {
                 _stepSize *= alpha;
-                // std::cout << "voltage violation back off step size to " << _stepSize << std::endl;
+                _lineSearchBacktracks ++;
                 continue;
             }
-            double newObjectiveValue = objectiveValueAtTime(0);
+            double newObjectiveValue = evaluation._objectiveValue;
             
             // if update too small, prepare for return
-            if (updateSizeAtTime(0) < epsilon)// ||
-                // fabs(newObjectiveValue - _oldObjectiveValue) / fabs(_oldObjectiveValue) < 1e-7)
-            {
+            if (evaluation._updateSize < epsilon) {
                 if (newObjectiveValue < _oldObjectiveValue)
-                    updatePowerAtTime(0, _enabledInFastControl);
+                    updatePowerOverHorizon(_enabledInSlowControl);
                 else
-                    resetPowerAtTime(0, _enabledInFastControl);
-                
-                // printf("stepSize = %5.4f, value = %+-7.6f\n", _stepSize, (newObjectiveValue < _oldObjectiveValue ? newObjectiveValue : _oldObjectiveValue));
+                    resetPowerOverHorizon(_enabledInSlowControl);
                 return iteration;
             }
             
-            // if value is big, back off step size
-            if (newObjectiveValue > _oldObjectiveValue + beta * expectedObjectiveValueChangeAtTime(0)) {
+            // if value is big compared with recent values, back off step size
+            if (newObjectiveValue > referenceValue + beta * evaluation._expectedObjectiveValueChange) {
                 _stepSize *= alpha;
-                // std::cout << "not progressing back off step size to " << _stepSize << std::endl;
+                _lineSearchBacktracks ++;
             }
             
             // else update power
-            else
-            {
-                updatePowerAtTime(0, _enabledInFastControl);
-                // printf("stepSize = %5.4f, value = %+-7.6f\n", _stepSize, newObjectiveValue);
+            else {
+                updatePowerOverHorizon(_enabledInSlowControl);
+                _oldObjectiveValue = newObjectiveValue;
+                referenceValues.push_back(newObjectiveValue);
+                if (referenceValues.size() > numberOfReferenceValues)
+                    referenceValues.pop_front();
+                iteration ++;
                 break;
             }
-            
         }
     }
 }
 
-int NetworkControl::slowControlInnerLoop(double alpha, double beta, double epsilon) {
+// inner product of vectors, taking real and imaginary parts as separate components
+static double innerProduct(const vector<complex_type> &vector1, const vector<complex_type> &vector2) {
+    double result = 0.0;
+    for (int entryId = 0; entryId < vector1.size(); entryId ++) {
+        result += vector1[entryId].real() * vector2[entryId].real() + vector1[entryId].imag() * vector2[entryId].imag();
+    }
+    return result;
+}
+
+// add factor times vector2 to vector1
+static void addScaled(vector<complex_type> &vector1, double factor, const vector<complex_type> &vector2) {
+    for (int entryId = 0; entryId < vector1.size(); entryId ++) {
+        vector1[entryId] += factor * vector2[entryId];
+    }
+}
+
+int NetworkControl::slowControlQuasiNewtonInnerLoop(double alpha, double beta, double epsilon) {
+    const int memory = 8;                       // pairs of steps and gradient changes kept
+    const double minimumScaledStepSize = 0.1;   // smallest step size tried along the scaled gradient
+    
     // update till improvements get too small
     int iteration = 1;
+    
+    // compute objective value
+    // later iterations take it from the accepted step
+    ControlEvaluation evaluation = evaluateOverHorizon();
+    if ( evaluation._voltageViolation ) {
+        std::cout << "Network::inner_loop---Must start with a feasible point!" << std::endl;
+        return 1;
+    }
+    _oldObjectiveValue = evaluation._objectiveValue;
+    
+    deque<vector<complex_type>> steps;
+    deque<vector<complex_type>> gradientChanges;
+    vector<complex_type> values, gradient, lastValues, lastGradient;
+    vector<vector<complex_type>> freeSteps(memory), freeGradientChanges(memory);
+    vector<double> curvatures(memory), coefficients(memory);
+    int gradientIterationsLeft = 0;             // gradient steps to take before the scaled gradient is tried again
+    int gradientIterationsAfterFailure = 1;     // doubled every time the scaled gradient fails
     while ( sizeof("Take a step") )
     {
-        // printf("\t\tIteration %3d, ", iteration++);
+        // compute gradient
+        computeGradientOverHorizon();
+        _stepSizeCandidates.clear();
+        gatherQuasiNewtonVariablesOverHorizon(values, gradient);
         
-        // compute objective value
-        if ( voltageViolationOverHorizon() == true ) {
-            std::cout << "Network::inner_loop---Must start with a feasible point!" << std::endl;
-            return 1;
+        // keep the last step and gradient change
+        if (iteration > 1) {
+            steps.push_back(values);
+            gradientChanges.push_back(gradient);
+            addScaled(steps.back(), -1.0, lastValues);
+            addScaled(gradientChanges.back(), -1.0, lastGradient);
+            if (steps.size() > memory) {
+                steps.pop_front();
+                gradientChanges.pop_front();
+            }
         }
-        _oldObjectiveValue = objectiveValueOverHorizon();
-        // printf("value_old = %+-7.6f, ", _oldObjectiveValue);
+        lastValues = values;
+        lastGradient = gradient;
         
-        // compute gradient
-        computeGradientOverHorizon();
-        // printViolatedVoltages(std::cout);
+        // two-loop recursion in the directions loads are free to move along, skipping pairs without positive curvature
+        vector<complex_type> direction = gradient;
+        projectOntoFreeDirectionsOverHorizon(direction);
+        double gradientLength = sqrt( innerProduct(direction, direction) );
+        double scaling = 0.0;
+        for (int pairId = int( steps.size() - 1 ); pairId >= 0; pairId --) {
+            freeSteps[pairId] = steps[pairId];
+            freeGradientChanges[pairId] = gradientChanges[pairId];
+            projectOntoFreeDirectionsOverHorizon(freeSteps[pairId]);
+            projectOntoFreeDirectionsOverHorizon(freeGradientChanges[pairId]);
+            curvatures[pairId] = innerProduct(freeSteps[pairId], freeGradientChanges[pairId]);
+            if (curvatures[pairId] <= 0.0)
+                continue;
+            coefficients[pairId] = innerProduct(freeSteps[pairId], direction) / curvatures[pairId];
+            addScaled(direction, - coefficients[pairId], freeGradientChanges[pairId]);
+            if (scaling == 0.0)
+                scaling = curvatures[pairId] / innerProduct(freeGradientChanges[pairId], freeGradientChanges[pairId]);
+        }
+        if (scaling == 0.0)
+            scaling = 1.0;
+        for (int entryId = 0; entryId < direction.size(); entryId ++)
+            direction[entryId] *= scaling;
+        for (int pairId = 0; pairId < steps.size(); pairId ++) {
+            if (curvatures[pairId] <= 0.0)
+                continue;
+            double coefficient = innerProduct(freeGradientChanges[pairId], direction) / curvatures[pairId];
+            addScaled(direction, coefficients[pairId] - coefficient, freeSteps[pairId]);
+        }
+        
+        // fall back to the gradient if there is no history, after recent failures, or if the scaled gradient is not a descent direction
+        // the first step is no longer than the gradient step, which rarely leaves the voltage limits
+        bool alongGradient = steps.empty() || gradientIterationsLeft > 0 || innerProduct(direction, gradient) <= 0.0;
+        if ( alongGradient ) {
+            if (gradientIterationsLeft > 0)
+                gradientIterationsLeft --;
+            scatterScaledGradientOverHorizon(vector<complex_type>());
+        }
+        else {
+            double directionLength = sqrt( innerProduct(direction, direction) );
+            if (directionLength > gradientLength) {
+                for (int entryId = 0; entryId < direction.size(); entryId ++)
+                    direction[entryId] *= gradientLength / directionLength;
+            }
+            scatterScaledGradientOverHorizon(direction);
+        }
         
         // intialize step size
         _stepSize = 1.0;
@@ -1127,43 +3459,389 @@ int NetworkControl::slowControlInnerLoop(double alpha, double beta, double epsil
         // line search
         while ( sizeof("Determine a step size") )
         {
-            // attempt a step size
-            attemptPowerOverHorizon(_enabledInSlowControl);
+            // the scaled gradient gets a few back offs, then the gradient takes over for a while
+            if (! alongGradient && _stepSize < minimumScaledStepSize) {
+                gradientIterationsLeft = gradientIterationsAfterFailure;
+                gradientIterationsAfterFailure *= 2;
+                scatterScaledGradientOverHorizon(vector<complex_type>());
+                _stepSizeCandidates.clear();
+                alongGradient = true;
+                _stepSize = 1.0;
+            }
             
+            // attempt a step size
             // if voltage violation happens, back off step size
-            if ( voltageViolationOverHorizon() == true ) {
+            evaluation = attemptAndEvaluateOverHorizon(alpha, _enabledInSlowControl);
+            if ( evaluation._voltageViolation ) {
                 _stepSize *= alpha;
-                // std::cout << "voltage violation back off step size to " << _stepSize << '\t';
+                _lineSearchBacktracks ++;
+                continue;
+            }
+            double newObjectiveValue = evaluation._objectiveValue;
+            
+            // a projected step along the scaled gradient may not descend, then go to the gradient
+            if (! alongGradient && evaluation._expectedObjectiveValueChange >= 0.0) {
+                _stepSize = 0.0;
                 continue;
             }
-            double newObjectiveValue = objectiveValueOverHorizon();
             
             // if update too small, prepare for return
-            if (updateSizeOverHorizon() < epsilon)// ||
-                //fabs(newObjectiveValue - _oldObjectiveValue) / fabs(_oldObjectiveValue) < 1e-7)
-            {
+            if (evaluation._updateSize < epsilon) {
                 if (newObjectiveValue < _oldObjectiveValue)
                     updatePowerOverHorizon(_enabledInSlowControl);
                 else
                     resetPowerOverHorizon(_enabledInSlowControl);
-                
-                // printf("stepSize = %5.4f, value = %+-7.6f\n", _stepSize, (newObjectiveValue < _oldObjectiveValue ? newObjectiveValue : _oldObjectiveValue));
+                scatterScaledGradientOverHorizon(vector<complex_type>());
                 return iteration;
             }
             
             // if value is big, back off step size
-            if (newObjectiveValue > _oldObjectiveValue + beta * expectedObjectiveValueChangeOverHorizon()) {
+            if (newObjectiveValue > _oldObjectiveValue + beta * evaluation._expectedObjectiveValueChange) {
                 _stepSize *= alpha;
-                // std::cout << "not progressing back off step size to " << _stepSize << '\t';
+                _lineSearchBacktracks ++;
             }
             
             // else update power
             else {
                 updatePowerOverHorizon(_enabledInSlowControl);
-                // printf("stepSize = %5.4f, value = %+-7.6f\n", _stepSize, newObjectiveValue);
+                if (! alongGradient)
+                    gradientIterationsAfterFailure = 1;
+                _oldObjectiveValue = newObjectiveValue;
+                iteration ++;
+                break;
+            }
+        }
+    }
+}
+
+// variables of the quasi-Newton solver
+void NetworkControl::gatherQuasiNewtonVariablesOverHorizon(vector<complex_type> &values, vector<complex_type> &gradient) const {
+    values.clear();
+    gradient.clear();
+    for (int busId = 1; busId < _buses.size(); busId ++) {
+        BusController *bus = _buses[busId];
+        for (int loadId = 0; loadId < bus->_loadArray.size(); loadId ++) {
+            LoadController *load = bus->_loadArray[loadId];
+            if (_enabledInSlowControl.find(load->_load->type()) == _enabledInSlowControl.end())
+                continue;
+            for (int timeSlotId = 0; timeSlotId < _numberOfSlots; timeSlotId ++) {
+                for (int phaseId = 0; phaseId < load->_phaseIndicesInLocationBus.size(); phaseId ++) {
+                    values.push_back(load->_valueArray[timeSlotId]._power._data[phaseId]);
+                    gradient.push_back(bus->_gradient[timeSlotId]._data[load->_phaseIndicesInLocationBus[phaseId]]);
+                }
+            }
+        }
+    }
+}
+
+// let the loads project their part of the direction
+void NetworkControl::projectOntoFreeDirectionsOverHorizon(vector<complex_type> &direction) const {
+    int entryId = 0;
+    vector<ColumnVector<complex_type>> loadDirection;
+    for (int busId = 1; busId < _buses.size(); busId ++) {
+        BusController *bus = _buses[busId];
+        for (int loadId = 0; loadId < bus->_loadArray.size(); loadId ++) {
+            LoadController *load = bus->_loadArray[loadId];
+            if (_enabledInSlowControl.find(load->_load->type()) == _enabledInSlowControl.end())
+                continue;
+            int numberOfPhases = int( load->_phaseIndicesInLocationBus.size() );
+            loadDirection.assign(_numberOfSlots, ColumnVector<complex_type>(numberOfPhases));
+            for (int timeSlotId = 0; timeSlotId < _numberOfSlots; timeSlotId ++) {
+                for (int phaseId = 0; phaseId < numberOfPhases; phaseId ++)
+                    loadDirection[timeSlotId]._data[phaseId] = direction[entryId + timeSlotId * numberOfPhases + phaseId];
+            }
+            load->projectOntoFreeDirectionsOverHorizon(loadDirection);
+            for (int timeSlotId = 0; timeSlotId < _numberOfSlots; timeSlotId ++) {
+                for (int phaseId = 0; phaseId < numberOfPhases; phaseId ++)
+                    direction[entryId ++] = loadDirection[timeSlotId]._data[phaseId];
+            }
+        }
+    }
+}
+
+// hand the scaled gradient to the loads
+void NetworkControl::scatterScaledGradientOverHorizon(const vector<complex_type> &scaledGradient) {
+    int entryId = 0;
+    for (int busId = 1; busId < _buses.size(); busId ++) {
+        BusController *bus = _buses[busId];
+        for (int loadId = 0; loadId < bus->_loadArray.size(); loadId ++) {
+            LoadController *load = bus->_loadArray[loadId];
+            if (_enabledInSlowControl.find(load->_load->type()) == _enabledInSlowControl.end())
+                continue;
+            if (scaledGradient.empty()) {
+                load->_scaledGradient.clear();
+                continue;
+            }
+            int numberOfPhases = int( load->_phaseIndicesInLocationBus.size() );
+            load->_scaledGradient.assign(_numberOfSlots, ColumnVector<complex_type>(numberOfPhases));
+            for (int timeSlotId = 0; timeSlotId < _numberOfSlots; timeSlotId ++) {
+                for (int phaseId = 0; phaseId < numberOfPhases; phaseId ++)
+                    load->_scaledGradient[timeSlotId]._data[phaseId] = scaledGradient[entryId ++];
+            }
+        }
+    }
+}
+
+int NetworkControl::slowControlAdmmInnerLoop(double alpha, double beta, double epsilon) {
+    ControlEvaluation evaluation = evaluateOverHorizon();
+    if ( evaluation._voltageViolation ) {
+        std::cout << "Network::inner_loop---Must start with a feasible point!" << std::endl;
+        return 1;
+    }
+    
+    // electric vehicles couple the slots
+    computeGradientOverHorizon();
+    vector<ElectricVehicleController *> evs;
+    if (_enabledInSlowControl.find(ELECTRIC_VEHICLE) != _enabledInSlowControl.end()) {
+        for (int busId = 1; busId < _buses.size(); busId ++) {
+            BusController *bus = _buses[busId];
+            for (int loadId = 0; loadId < bus->_loadArray.size(); loadId ++) {
+                if (bus->_loadArray[loadId]->_load->type() == ELECTRIC_VEHICLE) {
+                    evs.push_back( (ElectricVehicleController *)bus->_loadArray[loadId] );
+                    evs.back()->startConsensus(_admmPenalty);
+                }
+            }
+        }
+    }
+    
+    // keep the starting point in case the consensus violates voltages
+    extrapolatePowerOverHorizon(0.0, _enabledInSlowControl);
+    
+    int iteration = 0;
+    while (iteration < _admmMaxIterations) {
+        iteration ++;
+        
+        // slot problems in parallel
+        if (_threadPool == NULL) {
+            for (int timeSlotId = 0; timeSlotId < _numberOfSlots; timeSlotId ++)
+                slowControlSlotInnerLoop(timeSlotId, 0, alpha, beta, epsilon);
+        }
+        else {
+            _threadPool->parallelFor(0, _numberOfSlots, [this, alpha, beta, epsilon](int timeSlotId, int threadId) {
+                slowControlSlotInnerLoop(timeSlotId, threadId, alpha, beta, epsilon);
+            });
+        }
+        
+        // consensus and dual updates
+        double primalResidualSquare = 0.0;
+        double dualResidualSquare = 0.0;
+        for (int evId = 0; evId < evs.size(); evId ++)
+            evs[evId]->updateConsensus(primalResidualSquare, dualResidualSquare);
+        if (primalResidualSquare < _admmTolerance * _admmTolerance &&
+            dualResidualSquare < _admmTolerance * _admmTolerance)
+            break;
+    }
+    
+    // take the consensus rates, which meet the energy requests
+    for (int evId = 0; evId < evs.size(); evId ++)
+        evs[evId]->finishConsensus();
+    computePowerFlowOverHorizon();
+    if ( voltageViolationOverHorizon() ) {
+        rollBackPowerOverHorizon(_enabledInSlowControl);
+        return iteration + slowControlProjectedGradientInnerLoop(alpha, beta, epsilon);
+    }
+    updatePowerOverHorizon(_enabledInSlowControl);
+    return iteration;
+}
+
+int NetworkControl::slowControlSlotInnerLoop(int timeSlotId, int threadId, double alpha, double beta, double epsilon) {
+    // update till improvements get too small
+    int iteration = 1;
+    
+    // the slot starts from a feasible point
+    ControlEvaluation evaluation = evaluateAtTime(timeSlotId, NULL);
+    if ( evaluation._voltageViolation )
+        return iteration;
+    double oldObjectiveValue = evaluation._objectiveValue;
+    
+    while ( sizeof("Take a step") )
+    {
+        // compute gradient
+        computeGradientAtTime(timeSlotId, threadId);
+        
+        // intialize step size
+        double stepSize = 1.0;
+        
+        // line search
+        while ( sizeof("Determine a step size") )
+        {
+            // attempt a step size
+            for (int busId = 1; busId < _buses.size(); busId ++)
+                _buses[busId]->attemptPowerAtTime(stepSize, timeSlotId, _enabledInSlowControl);
+            computePowerFlowAtTime(timeSlotId);
+            
+            // if voltage violation happens, back off step size
+            evaluation = evaluateAtTime(timeSlotId, NULL);
+            if ( evaluation._voltageViolation ) {
+                stepSize *= alpha;
+                _lineSearchBacktracks ++;
+                continue;
+            }
+            double newObjectiveValue = evaluation._objectiveValue;
+            
+            // if update too small, prepare for return
+            if (evaluation._updateSize < epsilon) {
+                if (newObjectiveValue < oldObjectiveValue)
+                    updatePowerAtTime(timeSlotId, _enabledInSlowControl);
+                else
+                    resetPowerAtTime(timeSlotId, _enabledInSlowControl);
+                return iteration;
+            }
+            
+            // if value is big, back off step size
+            if (newObjectiveValue > oldObjectiveValue + beta * evaluation._expectedObjectiveValueChange) {
+                stepSize *= alpha;
+                _lineSearchBacktracks ++;
+            }
+            
+            // else update power
+            else {
+                updatePowerAtTime(timeSlotId, _enabledInSlowControl);
+                oldObjectiveValue = newObjectiveValue;
+                iteration ++;
                 break;
             }
+        }
+    }
+}
+
+int NetworkControl::fastControlDistributedInnerLoop(double alpha, double beta, double epsilon) {
+    const double penaltyGrowth = 4.0;       // the penalty on boundary power grows by this after a rejected move, and shrinks by twice this after a kept one
+    
+    // update till improvements get too small
+    int iteration = 1;
+    
+    // compute objective value
+    ControlEvaluation evaluation = evaluateAtTime(0);
+    if ( evaluation._voltageViolation ) {
+        std::cout << "Network::inner_loop---Must start with a feasible point!" << std::endl;
+        return 1;
+    }
+    _oldObjectiveValue = evaluation._objectiveValue;
+    
+    // areas start without a penalty, the first penalty makes the substation cost as curved as all areas reacting to it
+    int numberOfBus = int( _buses.size() );
+    int numberOfAreas = int( _areaBusIds.size() );
+    double basePenalty = 2 * _quadCoef * slotWeight(0) * numberOfAreas;
+    _boundaryPenalty = 0.0;
+    
+    // the coordinator only steps if it has loads to control
+    bool coordinatorControls = false;
+    for (int busId = 1; busId < _coordinatorBusIds.size(); busId ++) {
+        const vector<LoadController *> &loads = _buses[_coordinatorBusIds[busId]]->_loadArray;
+        for (int loadId = 0; loadId < loads.size(); loadId ++) {
+            if (_enabledInFastControl.find(loads[loadId]->_load->type()) != _enabledInFastControl.end())
+                coordinatorControls = true;
+        }
+    }
+    vector<ColumnVector<complex_type>> acceptedAggregateLoads(numberOfBus);
+    vector<complex_type> boundaryPower;
+    while ( sizeof("Take a round") )
+    {
+        // network gradient gives the prices at the boundaries
+        computeGradientAtTime(0);
+        _boundaryMarginalPrice = _marginalPriceBuffers[0];
+        
+        // remember the current point
+        acceptedAggregateLoads[0] = _buses[0]->_aggregateLoads[0]._power;
+        for (int busId = 1; busId < numberOfBus; busId ++) {
+            _buses[busId]->extrapolatePowerAtTime(0.0, 0, _enabledInFastControl);
+            acceptedAggregateLoads[busId] = _buses[busId]->_aggregateLoads[0]._power;
+        }
+        
+        // areas move in parallel with their boundary fixed
+        if (_threadPool == NULL) {
+            for (int areaId = 0; areaId < numberOfAreas; areaId ++)
+                areaInnerLoop(areaId, 0, 0, _areaIterationsPerRound, alpha, beta, epsilon);
+        }
+        else {
+            _threadPool->parallelFor(0, numberOfAreas, [this, alpha, beta, epsilon](int areaId, int threadId) {
+                areaInnerLoop(areaId, 0, threadId, _areaIterationsPerRound, alpha, beta, epsilon);
+            });
+        }
+        computePowerFlowAtTime(0);
+        double updateSize = 0.0;
+        for (int busId = 0; busId < numberOfBus; busId ++) {
+            double busUpdateSize = norm(_buses[busId]->_aggregateLoads[0]._power - acceptedAggregateLoads[busId]);
+            if (busUpdateSize > updateSize)
+                updateSize = busUpdateSize;
+        }
+        
+        // keep the combined move if the objective decreases and loosen the penalty,
+        // or return to the current point and tighten it
+        evaluation = evaluateAtTime(0);
+        _boundaryMismatch = 0.0;
+        if ( ! evaluation._voltageViolation && evaluation._objectiveValue < _oldObjectiveValue ) {
+            updatePowerAtTime(0, _enabledInFastControl);
+            _oldObjectiveValue = evaluation._objectiveValue;
+            _boundaryPenalty /= 2 * penaltyGrowth;
+            iteration ++;
             
+            // gap between the power areas planned to draw and the power flow of the whole network
+            for (int areaId = 0; areaId < numberOfAreas; areaId ++) {
+                evaluateAreaAtTime(areaId, 0, boundaryPower);
+                double mismatch = 0.0;
+                for (int phaseId = 0; phaseId < boundaryPower.size(); phaseId ++)
+                    mismatch += std::norm(boundaryPower[phaseId] - _areaBoundaryPowers[areaId][phaseId]);
+                if (mismatch > _boundaryMismatch)
+                    _boundaryMismatch = mismatch;
+            }
+        }
+        else {
+            for (int busId = 1; busId < numberOfBus; busId ++)
+                _buses[busId]->interpolatePowerAtTime(0.0, 0, _enabledInFastControl);
+            updatePowerAtTime(0, _enabledInFastControl);
+            computePowerFlowAtTime(0);
+            _buses[0]->_oldAggregateLoads[0] = _buses[0]->_aggregateLoads[0];
+            _boundaryPenalty = _boundaryPenalty > 0.0 ? _boundaryPenalty * penaltyGrowth : basePenalty;
+        }
+        
+        // coordinator does a line search on its own loads
+        double coordinatorUpdateSize = 0.0;
+        if (coordinatorControls) {
+            computeGradientAtTime(0);
+            _stepSize = 1.0;
+            while ( sizeof("Determine a step size") )
+            {
+                for (int busId = 1; busId < _coordinatorBusIds.size(); busId ++)
+                    _buses[_coordinatorBusIds[busId]]->attemptPowerAtTime(_stepSize, 0, _enabledInFastControl);
+                computePowerFlowAtTime(0);
+                evaluation = evaluateAtTime(0);
+                if ( evaluation._voltageViolation ) {
+                    _stepSize *= alpha;
+                    _lineSearchBacktracks ++;
+                    continue;
+                }
+                
+                // nothing to do without a descent direction
+                if (evaluation._expectedObjectiveValueChange >= 0.0) {
+                    resetPowerAtTime(0, _enabledInFastControl);
+                    break;
+                }
+                coordinatorUpdateSize = evaluation._updateSize;
+                if (evaluation._updateSize < epsilon) {
+                    if (evaluation._objectiveValue < _oldObjectiveValue) {
+                        updatePowerAtTime(0, _enabledInFastControl);
+                        _oldObjectiveValue = evaluation._objectiveValue;
+                    }
+                    else
+                        resetPowerAtTime(0, _enabledInFastControl);
+                    break;
+                }
+                if (evaluation._objectiveValue > _oldObjectiveValue + beta * evaluation._expectedObjectiveValueChange) {
+                    _stepSize *= alpha;
+                    _lineSearchBacktracks ++;
+                }
+                else {
+                    updatePowerAtTime(0, _enabledInFastControl);
+                    _oldObjectiveValue = evaluation._objectiveValue;
+                    break;
+                }
+            }
         }
+        
+        // a rejected move of the areas is retried with a larger penalty, which shrinks it
+        if (updateSize < epsilon && coordinatorUpdateSize < epsilon && _boundaryMismatch < epsilon)
+            return iteration;
     }
 }
@@ -26,6 +26,14 @@
 #include "LineController.h"
 #include "LoadController.h"
 #include "LoadPredictor.h"
+#include "ThreadPool.h"
+#include "VoltageViolationCollector.h"
+#include "VoltageSensitivity.h"
+#include "TreeKktSolver.h"
+#include "SolverTelemetry.h"
+#include "SolutionCache.h"
+#include "VoltVarDroop.h"
+#include "ChargingRateProjection.h"
 
 class NetworkControl {
 public:
@@ -43,19 +51,153 @@ public:
     unordered_set<LoadType> _enabledInFastControl;
     unordered_set<LoadType> _enabledInSlowControl;
     int _numberOfSlots;                             // number of slots in slow control
-    time_type _slotLengthInMinutes;                 // length of each time slot
+    time_type _slotLengthInMinutes;                 // length of the first time slot
+    vector<time_type> _slotLengthsInMinutes;        // length of every time slot, empty if all are _slotLengthInMinutes
     double _quadCoef;                               // quadratic coefficient in objective function
     double _linCoef;                                // linear coefficient in objective function
+    InnerLoopMethod _slowControlMethod;             // method used in the inner loop of slow control
+    InnerLoopMethod _fastControlMethod;             // method used in the inner loop of fast control
     
     
     /******************************
      algorithm variables
      ******************************/
     vector<vector<int>> _busPhaseIndicesInRoot;     // position of bus indices at the root node
+    VoltageSensitivity _voltageSensitivity;         // linearized voltage sensitivities to injections
+    TreeKktSolver _kktSolver;                       // Newton system of the barrier problem, used by INTERIOR_POINT
+    bool _checkNewtonSteps;                         // compare every Newton step of _kktSolver with a dense solve
+    ChargingRateProjection _chargingRateProjection; // EV schedules stepped and projected in one pass over the fleet
+    unordered_set<LoadType> _enabledBesideFleet;    // loads enabled in control other than EV, attempted bus by bus
     double _muLower, _muUpper;                      // in log barrier function
     double _stepSize;
     double _oldObjectiveValue;
+    int _slowControlIterations;                     // inner loop iterations in the last slow control
+    std::atomic<int> _powerFlowEvaluations;         // power flows solved in the last control, one per time slot
+    std::atomic<int> _lineSearchBacktracks;         // step sizes backed off in the last control
     double _substationVoltage;
+    bool _fuseGradientWithPowerFlow;                // accumulate sumDown in the power flow backward sweep
+    double _fastControlDeadlineInSeconds;           // wall clock budget of fast control, none if not positive
+    std::chrono::steady_clock::time_point _fastControlStartTime;
+    bool _fastControlDeadlineHit;                   // whether the last fast control was stopped by the deadline
+    bool _voltVarFallback;                          // PV follow droop curves fitted to past solutions when the deadline is hit
+    VoltVarDroop _voltVarDroop;                     // droop curves of PV enabled in fast control
+    int _voltVarFallbacks;                          // fast controls that fell back to the droop curves
+    
+    
+    /******************************
+     barrier continuation
+     ******************************/
+    double _targetGap;                              // measured duality gap per time slot that adaptive continuation stops at, fixed muArray if not positive
+    double _muReductionFactor;                      // mu goes down by at least this factor per outer iteration
+    double _muReductionExponent;                    // and superlinearly, as mu to this power, once that is smaller
+    
+    
+    /******************************
+     receding horizon warm start
+     ******************************/
+    bool _warmStartSlowControl;                     // start slow control from the last solution shifted in time
+    time_type _warmStartTime;                       // start time of the last solution, negative if none
+    double _warmStartMu;                            // final mu of the last solution
+    vector<vector<ColumnVector<complex_type>>> _warmStartVoltages;  // voltages of the last solution, per bus and slot
+    bool _warmStarted;                              // whether the current slow control is warm started
+    
+    
+    /******************************
+     slow to fast control handoff
+     ******************************/
+    bool _handOffSlowControlPlan;                   // start fast control from the slot 0 plan of slow control
+    time_type _planStartTime;                       // start time of the plan, negative if none
+    time_type _planEndTime;                         // end of its first slot, after which fast control starts from scratch
+    double _planMu;                                 // final mu of the plan
+    vector<LoadValue> _plannedSetPoints;            // load values of the plan in slot 0, by bus then load
+    vector<ColumnVector<complex_type>> _plannedPrices;  // gradient of the plan in slot 0 at every bus, barrier terms included
+    bool _handedOff;                                // whether the current fast control starts from the plan
+    
+    
+    /******************************
+     solution cache of past days
+     ******************************/
+    bool _useSolutionCache;                         // start slow control from the nearest solution at the same time of past days
+    SolutionCache _solutionCache;                   // solutions by time of day and EVs plugged in
+    int _fingerprintLength;                         // segments of the horizon the predicted load profile is averaged over
+    string _cacheKey;                               // key of the current slow control
+    vector<double> _cacheFingerprint;               // fingerprint of the current slow control
+    bool _cacheHit;                                 // whether the current slow control starts from a cached solution
+    int _cacheIterations;                           // inner loop iterations of the solve the cached solution descends from
+    
+    
+    /******************************
+     temporal decomposition
+     ******************************/
+    double _admmPenalty;                            // penalty on the distance of EV rates to consensus rates
+    int _admmMaxIterations;                         // ADMM iterations per barrier value
+    double _admmTolerance;                          // ADMM stops once primal and dual residuals are below
+    
+    
+    /******************************
+     spatial decomposition
+     ******************************/
+    int _numberOfAreas;                             // areas fast control is decomposed into, 0 to solve centrally
+    int _areaIterationsPerRound;                    // local steps of every area between two exchanges of prices
+    vector<vector<int>> _areaBusIds;                // buses of every area, in breadth first search order
+    vector<vector<int>> _areaRootIds;               // roots of the whole subtrees that make up every area
+    vector<int> _coordinatorBusIds;                 // buses upstream of all areas, including the substation
+    vector<double> _boundaryMarginalPrice;          // marginal price at the root while areas are solved
+    double _boundaryPenalty;                        // penalty on the change of power drawn by an area in a round
+    vector<vector<complex_type>> _areaBoundaryPowers; // power every area planned to draw in the last round, per root phase
+    double _boundaryMismatch;                       // largest squared gap between planned and actual power drawn by an area
+    
+    
+    /******************************
+     speculative line search
+     ******************************/
+    int _numberOfStepSizeCandidates;                // step sizes tried at once in the line search of slow control
+    vector<NetworkControl *> _stepSizeReplicas;     // copies of buses and lines that candidate step sizes are evaluated on
+    vector<double> _stepSizeCandidates;             // step sizes of the last batch, empty after a new gradient
+    vector<ControlEvaluation> _stepSizeEvaluations; // evaluations of the step sizes of the last batch
+    
+    
+    /******************************
+     sensitivity predicted step size
+     ******************************/
+    bool _predictStepSize;                          // back off the first step size of a line search by linearized voltages
+    vector<complex_type> _predictedInjections;      // change of injections of a tentative step, per bus and root phase
+    vector<double> _predictedVoltageChanges;        // linearized change of voltage magnitudes it leads to
+    
+    
+    /******************************
+     feasibility restoration
+     ******************************/
+    vector<double> _phaseOneResiduals;              // voltage magnitudes outside their tightened bounds, per bus and root phase
+    vector<complex_type> _phaseOnePrices;           // prices of injections for the squared residuals
+    
+    
+    /******************************
+     parallel computation
+     ******************************/
+    int _numberOfThreads;                           // threads used over the horizon
+    ThreadPool *_threadPool;                        // runs time slots in parallel
+    vector<vector<double>> _marginalPriceBuffers;   // marginal price at the root, one per thread
+    vector<vector<vector<double>>> _priceBuffers;   // price at every bus, one set per thread
+    
+    
+    /******************************
+     event triggered fast control
+     ******************************/
+    double _fastControlLoadTrigger;                 // load change that triggers a solve, every tick solves if not positive
+    double _fastControlVoltageTrigger;              // voltage magnitude change that triggers a solve
+    vector<LoadValue> _triggerLoadValues;           // measured load values at the last solve, by bus then load
+    vector<LoadValue> _triggerSetPoints;            // load values applied by the last solve, by bus then load
+    vector<double> _triggerVoltages;                // voltage magnitudes under the last set-points, by bus then phase
+    bool _fastControlSkipped;                       // whether the last fast control kept the previous set-points
+    int _skippedFastControls;                       // fast controls skipped since the trigger was set
+    
+    
+    /******************************
+     diagnostics
+     ******************************/
+    VoltageViolationCollector _voltageViolations;   // violations found by the latest check, printed only if a sink is set
+    SolverTelemetry _telemetry;                     // work done by the last fast or slow control
     
     
 public:
@@ -95,9 +237,66 @@ public:
     // set numberOfSlots
     void setNumberOfSlots(int numberOfSlots);
     
+    // set numberOfSlots and the length of every slot, where later slots may be longer
+    void setSlotLengths(const vector<time_type> &slotLengthsInMinutes);
+    
     // set substation voltage
     void setSubstationVoltage(const double &substationVoltage);
     
+    // set number of threads used over the horizon
+    void setNumberOfThreads(int numberOfThreads);
+    
+    // set whether the gradient reuses the power flow backward sweep
+    void setFuseGradientWithPowerFlow(bool fuseGradientWithPowerFlow);
+    
+    // set method used in the inner loop of slow control
+    void setSlowControlMethod(InnerLoopMethod method);
+    
+    // set method used in the inner loop of fast control, PROJECTED_GRADIENT or INTERIOR_POINT
+    void setFastControlMethod(InnerLoopMethod method);
+    
+    // set whether every Newton step of INTERIOR_POINT is checked against a dense solve of the same KKT system,
+    // and mismatches printed, which costs time cubic in the number of buses and is meant for small networks
+    void setCheckNewtonSteps(bool checkNewtonSteps);
+    
+    // set number of areas fast control is decomposed into, 0 to solve centrally
+    // more local steps per round need fewer rounds, but the stale boundary prices may stop the rounds early
+    void setNumberOfAreas(int numberOfAreas, int areaIterationsPerRound = 1);
+    
+    // set number of step sizes tried at once in the line search of slow control, 1 to try one at a time
+    void setNumberOfStepSizeCandidates(int numberOfCandidates);
+    
+    // set whether projected gradient line searches start from the step size predicted by linearized voltages
+    void setPredictStepSize(bool predictStepSize);
+    
+    // set parameters of ADMM_TEMPORAL_DECOMPOSITION
+    void setAdmmParameters(double penalty, int maxIterations, double tolerance);
+    
+    // set adaptive barrier continuation, not positive targetGap for the fixed muArray
+    // mu follows the duality gap measured after every inner loop, down to half of targetGap over the number of voltage bounds per time slot,
+    // and continuation stops once the measured gap per slot meets targetGap
+    void setBarrierContinuation(double targetGap, double reductionFactor = 0.1, double reductionExponent = 1.5);
+    
+    // set whether slow control starts from the last solution shifted in time
+    void setWarmStartSlowControl(bool warmStartSlowControl);
+    
+    // set whether fast control inside the first slot of the last slow control starts from its plan
+    void setHandOffSlowControlPlan(bool handOffSlowControlPlan);
+    
+    // set whether slow control starts from the nearest solution at the same time of past days,
+    // if it cannot start from the last solution shifted in time, and the file the solutions persist in, none if empty
+    void setSolutionCache(bool useSolutionCache, const string &fileName = "");
+    
+    // set wall clock budget of fast control, not positive for none
+    void setFastControlDeadlineInSeconds(double deadlineInSeconds);
+    
+    // set whether PV follow Volt/VAR droop curves fitted to past solutions when fast control hits the deadline
+    void setVoltVarFallback(bool voltVarFallback);
+    
+    // set the changes of load values and voltage magnitudes since the last solve that trigger fast control,
+    // not positive loadChange to solve on every tick
+    void setFastControlTrigger(double loadChange, double voltageChange);
+    
     // initialize networkControl according to networkModel
     void initialize(const NetworkModel &model);
     
@@ -119,7 +318,15 @@ public:
      ******************************/
     
     // do fast control
-    void fastControl();
+    // if the deadline passes, the last accepted point is applied and _fastControlDeadlineHit is set,
+    // or with the Volt/VAR fallback set, PV follow their droop curves, which every fast control that finishes
+    // and every slow control refits
+    // with a trigger set, the solve starts from the last set-points, and is skipped if the state barely changed
+    // with the handoff set, the solve starts from the plan of slow control while time is inside its first slot
+    void fastControl(time_type time);
+    
+    // check whether the fast control deadline has passed, and record it in _fastControlDeadlineHit
+    bool fastControlDeadlinePassed();
     
     // do slow control
     void slowControl(time_type time);
@@ -128,6 +335,22 @@ public:
     void applyControl();
     
     
+    /******************************
+     time slots
+     ******************************/
+    
+    // length of a slot, and its start after the start of the horizon
+    time_type slotLengthInMinutes(int timeSlotId) const;
+    time_type slotStartInMinutes(int timeSlotId) const;
+    
+    // slot that covers offsetInMinutes after the start of the horizon, 0 before it
+    // past the horizon, slots go on at the length of the last slot
+    int slotIdAtTime(time_type offsetInMinutes) const;
+    
+    // weight of the cost of a slot, which is its length relative to the first slot
+    double slotWeight(int timeSlotId) const;
+    
+    
     /******************************
      power flow computation
      ******************************/
@@ -144,13 +367,23 @@ public:
     void computePowerFlowOverHorizon(const int &maxIteration = 15,
                                      const double &updateSizeThreshold = 1e-6);
     
+    // backward-forward sweep with the aggregate loads as they are, not counted in _powerFlowEvaluations
+    void solvePowerFlowAtTime(int timeSlotId,
+                              const int &maxIteration = 15,
+                              const double &updateSizeThreshold = 1e-6);
+    
     
     /******************************
      gradient estimation
      ******************************/
     
+    // allocate per-thread price buffers
+    // must be called after the network or the number of threads changes
+    void initGradientBuffers();
+    
     // compute gradients
-    void computeGradientAtTime(int timeSlotId);
+    // threadId selects the price buffers, so concurrent calls must use different threadIds
+    void computeGradientAtTime(int timeSlotId, int threadId = 0);
     void computeGradientOverHorizon();
     
     
@@ -159,6 +392,7 @@ public:
      ******************************/
     
     // compute tentative power consumptions
+    // over the horizon, EV enabled in control are attempted in one pass of _chargingRateProjection
     void attemptPowerAtTime(const int &timeSlotId, unordered_set<LoadType> &enabledInControl);
     void attemptPowerOverHorizon(unordered_set<LoadType> &enabledInControl);
     
@@ -170,9 +404,21 @@ public:
     void resetPowerAtTime(const int &timeSlotId, unordered_set<LoadType> &enabledInControl);
     void resetPowerOverHorizon(unordered_set<LoadType> &enabledInControl);
     
+    // extrapolate power consumption by momentum from the last accepted iterate, see LoadController
+    // power flow is not recomputed if momentum is 0
+    void extrapolatePowerOverHorizon(const double &momentum, unordered_set<LoadType> &enabledInControl);
+    
+    // set power consumption to the last accepted iterate
+    void rollBackPowerOverHorizon(unordered_set<LoadType> &enabledInControl);
+    
     // check if there is voltage vilation
-    bool voltageViolationAtTime(const int &timeSlotId) const;
-    bool voltageViolationOverHorizon() const;
+    // the first violation found is kept in _voltageViolations
+    bool voltageViolationAtTime(const int &timeSlotId);
+    bool voltageViolationOverHorizon();
+    
+    // keep every voltage violation in _voltageViolations, and return the number of violations
+    int collectVoltageViolationsAtTime(const int &timeSlotId);
+    int collectVoltageViolationsOverHorizon();
     
     // compute objective value
     double objectiveValueAtTime(const int &timeSlotId) const;
@@ -186,19 +432,188 @@ public:
     double expectedObjectiveValueChangeAtTime(const int &timeSlotId) const;
     double expectedObjectiveValueChangeOverHorizon() const;
     
+    // compute all of the above in a single pass over the buses
+    // objective value is not computed once a voltage violation is found, which is kept in _voltageViolations
+    ControlEvaluation evaluateAtTime(const int &timeSlotId);
+    ControlEvaluation evaluateOverHorizon();
+    
+    // same as above, with the violation kept in collector if not NULL
+    // different time slots can be evaluated concurrently
+    ControlEvaluation evaluateAtTime(const int &timeSlotId, VoltageViolationCollector *collector) const;
+    
+    
+    /******************************
+     sensitivity predicted step size
+     ******************************/
+    
+    // set _predictedVoltageChanges to the linearized change of voltage magnitudes at timeSlotId
+    // from the last accepted loads to the attempted ones
+    void predictVoltageChangesAtTime(int timeSlotId);
+    
+    // largest fraction of the tentative step at timeSlotId that keeps the voltages predicted by _voltageSensitivity in range
+    // loads must be attempted, and voltages must be those of the last accepted point
+    double predictedStepFractionAtTime(int timeSlotId);
+    
+    // back off _stepSize by powers of alpha until the predicted fraction is 1, without computing power flow
+    // loads are left attempted at _stepSize, which the exact power flow of the line search then verifies
+    void predictStepSizeAtTime(const int &timeSlotId, double alpha, unordered_set<LoadType> &enabledInControl);
+    void predictStepSizeOverHorizon(double alpha, unordered_set<LoadType> &enabledInControl);
+    
+    
+    /******************************
+     speculative line search
+     ******************************/
+    
+    // make this a copy of the buses and lines of control without loads,
+    // so that a tentative point of control can be evaluated on it
+    void initializeReplica(const NetworkControl &control);
+    
+    // copy voltage bounds, aggregate loads, voltages, currents and sumDown parts over the horizon from control,
+    // which must be this replica or the network it is a replica of
+    void copyPowerFlowOverHorizon(const NetworkControl &control);
+    
+    // attempt _stepSize over the horizon and evaluate it, as attemptPowerOverHorizon followed by evaluateOverHorizon
+    // if _numberOfStepSizeCandidates > 1, _stepSize and the next step sizes backed off by alpha are evaluated concurrently on replicas,
+    // and later calls for those step sizes reuse the evaluations until _stepSizeCandidates is cleared
+    ControlEvaluation attemptAndEvaluateOverHorizon(double alpha, unordered_set<LoadType> &enabledInControl);
+    
+    
+    /******************************
+     spatial decomposition
+     ******************************/
+    
+    // split the network into _numberOfAreas areas of whole subtrees with similar numbers of buses
+    // subtrees are split at their roots until they are small, and split roots go to the coordinator
+    void partitionNetwork();
+    
+    // power flow inside an area, with voltages upstream of it fixed
+    void computeAreaPowerFlowAtTime(int areaId, int timeSlotId);
+    
+    // gradient inside an area, with _boundaryMarginalPrice and sumUp upstream of it fixed,
+    // plus the gradient of the penalty on boundaryPowerChange, the change of power drawn by the area in this round
+    void computeAreaGradientAtTime(int areaId, int timeSlotId, int threadId, const vector<complex_type> &boundaryPowerChange);
+    
+    // objective of an area: load and barrier terms inside it,
+    // plus the power drawn by its subtrees priced by the gradient at their parents
+    // boundaryPower is set to the power drawn by the subtrees in every root phase
+    ControlEvaluation evaluateAreaAtTime(int areaId, int timeSlotId, vector<complex_type> &boundaryPower) const;
+    
+    // projected gradient over the loads of an area, as in fast control, at most maxIteration steps
+    // the change of power drawn by the area is penalized by _boundaryPenalty, and the power it ends at is kept in _areaBoundaryPowers
+    // different areas can run concurrently with different threadIds
+    int areaInnerLoop(int areaId, int timeSlotId, int threadId, int maxIteration, double alpha, double beta, double epsilon);
+    
     
     /******************************
      solve the power flow problem
      ******************************/
     
     // initialize algorithm variables for fast/slow control
+    // if warm start is enabled and the last solution overlaps the new horizon,
+    // slow control starts from the last voltages and schedules instead of the prediction
     void fastControlInitialize();
     void slowControlInitialize(time_type time);
     
+    // slots of the last solution that cover the start of every slot of slow control at time, -1 past its horizon
+    // return false if the last solution cannot be used
+    bool warmStartSlotIds(time_type time, vector<int> &sourceSlotIds) const;
+    
+    // keep the solution of slow control at time for the next warm start
+    void saveWarmStart(time_type time);
+    
+    // keep set-points, prices and the final mu of slot 0 of slow control at time for fast control,
+    // and drop the set-points of the last fast control, which the plan replaces
+    void savePlanForFastControl(time_type time);
+    
+    // whether fast control at time is inside the first slot of the plan, and the network is the one planned for
+    bool planCoversTime(time_type time) const;
+    
+    // hold planned set-points of loads enabled in fast control, unless fast control has set-points of its own since,
+    // and model the cost of later slots for EVs by a quadratic around the plan, at which slot 0 is stationary
+    void startFastControlFromPlan();
+    
+    // turn the cost of later slots off again
+    void finishFastControlFromPlan();
+    
+    // key of slow control at time from the time of day and the EVs plugged in over the horizon,
+    // and fingerprint from the predicted real power of all other loads, averaged over _fingerprintLength segments
+    void solutionCacheKey(time_type time, string &key, vector<double> &fingerprint) const;
+    
+    // set _warmStartValueArray of loads, _warmStartMu and _cacheIterations from the nearest cached solution,
+    // and sourceSlotIds to match, return false if there is none
+    bool warmStartFromSolutionCache(vector<int> &sourceSlotIds);
+    
+    // keep the schedules of loads enabled in slow control under the current key,
+    // with the inner loop iterations of the solve without a cached start they descend from
+    void storeInSolutionCache(int iterations);
+    
+    // find a feasible point for the first numberOfSlots slots in a few power flows,
+    // by restoreFeasibilityBySubstationVoltage and then restoreFeasibilityByLoads
+    // return true if voltages are within bounds, otherwise the outer loops fall back to widening the bounds
+    bool restoreFeasibility(int numberOfSlots, unordered_set<LoadType> &enabledInControl);
+    
+    // range of shifts of all voltage magnitudes in the first numberOfSlots slots that puts them within bounds,
+    // with low > high if voltages spread wider than the bounds
+    void feasibleVoltageShiftRange(int numberOfSlots, double &low, double &high) const;
+    
+    // shift the substation voltage into the feasible shift range, as every voltage moves with the substation in the tree model,
+    // halving the shift while a power flow finds it overshoots, with at most maxPowerFlows power flows
+    // if no shift is feasible, voltages are centered in their bounds
+    bool restoreFeasibilityBySubstationVoltage(int numberOfSlots, int maxPowerFlows = 4);
+    
+    // residuals of voltage magnitudes at timeSlotId outside their bounds tightened by margin into _phaseOneResiduals,
+    // positive above the upper bound, and return half the sum of their squares
+    double phaseOneResidualsAtTime(int timeSlotId, double margin);
+    
+    // phase I on the subtree of the deepest common ancestor of the violating buses of every slot:
+    // loads enabled in control there take Gauss-Newton steps on the squared residuals predicted by _voltageSensitivity,
+    // each checked by a power flow and halved until the residuals go down, for at most maxRounds steps
+    bool restoreFeasibilityByLoads(int numberOfSlots, unordered_set<LoadType> &enabledInControl, int maxRounds = 8);
+    
+    // whether measured loads and voltages moved less than the triggers since the last solve
+    // uncontrolled loads are compared in full, loads enabled in fast control only in real power
+    bool fastControlStateUnchanged() const;
+    
+    // keep measured loads of the solve in progress, or its set-points and the voltages they lead to
+    void saveFastControlLoadValues();
+    void saveFastControlSetPoints();
+    
+    // put the last set-points of loads enabled in fast control back onto the network
+    void holdFastControlSetPoints();
+    
+    // refit the droop curves of PV enabled in fast control to slot 0 of the fast or slow control just finished
+    void fitVoltVarDroop();
+    
+    // set the reactive power of PV enabled in fast control by the droop curves fitted so far, if any
+    void fallBackToVoltVarDroop();
+    
+    // number of voltage bounds, two per constrained bus phase, in a time slot
+    int numberOfVoltageBoundsAtTime() const;
+    
+    // duality gap per time slot at the current point, with mu / slack as the multipliers of the voltage bounds:
+    // their complementarity, mu per bound, plus the decrease a unit projected gradient step predicts, zero only at the minimizer
+    // the gradient is computed anew, power consumptions and the power flow are left as they are
+    double measuredDualityGapAtTime(int timeSlotId, unordered_set<LoadType> &enabledInControl);
+    double measuredDualityGapOverHorizon(unordered_set<LoadType> &enabledInControl);
+    
+    // mu after an inner loop at mu in adaptive continuation, from the duality gap measured after it:
+    // the gap over the number of bounds is the mu of a minimizer with that gap, and is cut by the smaller of the two reductions,
+    // but mu goes down by at least the square root of _muReductionFactor, and not below finalMu
+    double nextBarrierParameter(double mu, double measuredGap, double finalMu) const;
+    
+    // threshold of power consumption update in the inner loop at mu, epsilon scaled by the fourth root of mu / finalMu,
+    // since the next mu moves the solution anyway
+    double barrierInnerLoopThreshold(double mu, double finalMu, double epsilon) const;
+    
     // outer loop of the solver
     // in each iteration of the outer loop, use a different log-barrier function
     // return the computed objective value
     // muArray is an array of the mu values to be used in the inner loop, alpha is the backoff parameter, beta is the linearization quantification parameter, and epsilon is the threshold of power consumptions update
+    // a warm started slow control skips the search for a feasible point if the start is feasible, and by default only uses the last final mu
+    // QUASI_NEWTON by default goes on to 0.0001 / number of buses
+    // if _targetGap is positive and muArray is empty, mu starts at 1 / number of buses, or the last final mu of a warm start,
+    // and goes down by nextBarrierParameter until the measured duality gap meets _targetGap,
+    // at finalMu the inner loop is repeated with a ten times smaller threshold while the gap at least halves, at most 3 times
     double fastControlOuterLoop(std::vector<double> muArray = std::vector<double>(), double alpha = 0.5, double beta = 0.5, double epsilon = 1e-4);
     double slowControlOuterLoop(std::vector<double> muArray = std::vector<double>(), double alpha = 0.5, double beta = 0.5, double epsilon = 1e-4);
     
@@ -206,8 +621,68 @@ public:
     // in each iteration of the inner loop, do gradient decent to solve the OPF problem with a fixed log barrier function
     // return the number of iterations used
     // muLow is the mu value used in log(v-vMin), muUpp is the mu value used in log(vMax-v), alpha is the backoff parameter, beta is the linearization quantification parameter, and epsilon is the threshold of power consumptions update
+    // fast control and slow control run the inner loops selected by _fastControlMethod and _slowControlMethod
     int fastControlInnerLoop(double alpha, double beta, double epsilon);
     int slowControlInnerLoop(double alpha, double beta, double epsilon);
+    
+    // distributed inner loop of fast control, used if _numberOfAreas > 0
+    // in every round, areas take local steps in parallel at the prices of the network gradient,
+    // the combined move is kept if the objective decreases, and the penalty on boundary power shrinks, otherwise it grows,
+    // then the coordinator does a line search on its own loads
+    // stops once moves and the gap between planned and actual boundary power are below epsilon
+    int fastControlDistributedInnerLoop(double alpha, double beta, double epsilon);
+    
+    // inner loop of fast control with Newton steps on the barrier problem, used if _fastControlMethod is INTERIOR_POINT
+    // the Newton system of the linearized branch flow model is solved by _kktSolver in time linear in the number of buses,
+    // regularized by a multiple of the identity that shrinks after full steps and grows after back offs
+    int fastControlInteriorPointInnerLoop(double alpha, double beta, double epsilon);
+    
+    // set _scaledGradient of loads enabled in control at timeSlotId to the Newton step of _kktSolver, negated,
+    // where regularization is the curvature added to every load component
+    // return false, leaving _scaledGradient untouched, if the Newton system is singular
+    bool computeNewtonStepAtTime(int timeSlotId, double regularization, unordered_set<LoadType> &enabledInControl);
+    
+    // clear _scaledGradient of loads enabled in control, so that they move along the gradient again
+    void clearScaledGradient(unordered_set<LoadType> &enabledInControl);
+    
+    // inner loop of slow control with projected gradient steps, used if _slowControlMethod is PROJECTED_GRADIENT
+    int slowControlProjectedGradientInnerLoop(double alpha, double beta, double epsilon);
+    
+    // accelerated inner loop of slow control, used if _slowControlMethod is ACCELERATED_PROJECTED_GRADIENT
+    // each step is a projected gradient step from a point extrapolated along the last step (FISTA),
+    // and the momentum is restarted whenever the objective value goes up or the extrapolated point violates voltages
+    int slowControlAcceleratedInnerLoop(double alpha, double beta, double epsilon);
+    
+    // inner loop of slow control with Barzilai-Borwein step sizes, used if _slowControlMethod is BARZILAI_BORWEIN
+    // the line search starts from the step size of the last step and gradient change,
+    // and accepts a step by comparing with the largest of the recent objective values (Grippo et al.)
+    int slowControlBarzilaiBorweinInnerLoop(double alpha, double beta, double epsilon);
+    
+    // inner loop of slow control by ADMM over time slots, used if _slowControlMethod is ADMM_TEMPORAL_DECOMPOSITION
+    // slots are only coupled by EV energy requests, so every slot is solved on its own in parallel,
+    // with EV rates pulled towards consensus rates that meet the energy requests
+    // the consensus is applied at the end, and the projected gradient loop takes over if it violates voltages
+    // return the number of ADMM iterations used
+    int slowControlAdmmInnerLoop(double alpha, double beta, double epsilon);
+    
+    // inner loop of slow control with limited memory quasi-Newton steps, used if _slowControlMethod is QUASI_NEWTON
+    // the gradient is scaled by the inverse Hessian estimated from recent steps and gradient changes (L-BFGS),
+    // restricted to the directions loads are free to move along, and loads project the step onto their feasible sets
+    int slowControlQuasiNewtonInnerLoop(double alpha, double beta, double epsilon);
+    
+    // power consumption and gradient of loads enabled in slow control over the horizon,
+    // load by load, slot by slot and phase by phase
+    void gatherQuasiNewtonVariablesOverHorizon(vector<complex_type> &values, vector<complex_type> &gradient) const;
+    
+    // project a direction, in the order of gatherQuasiNewtonVariablesOverHorizon, onto the directions loads are free to move along
+    void projectOntoFreeDirectionsOverHorizon(vector<complex_type> &direction) const;
+    
+    // set _scaledGradient of loads enabled in slow control, in the order of gatherQuasiNewtonVariablesOverHorizon, empty to clear
+    void scatterScaledGradientOverHorizon(const vector<complex_type> &scaledGradient);
+    
+    // projected gradient over a single slot with its own step size, as in fast control
+    // different time slots can run concurrently with different threadIds
+    int slowControlSlotInnerLoop(int timeSlotId, int threadId, double alpha, double beta, double epsilon);
 };
 
 #endif /* defined(__OptimalPowerFlowVisualization__NetworkControl__) */
@@ -62,16 +62,11 @@ ostream &operator<<(ostream &cout, const PhotoVoltaicController *controller) {
 void PhotoVoltaicController::attemptPowerAtTime(const double &stepSize, const int &timeSlotId) {
     int numberOfPhases = int( _phaseIndicesInLocationBus.size() );
     
-    // get gradient
-    ColumnVector<complex_type> gradient( numberOfPhases );
-    gradient.reset();
-    gradient.addFromIndices(_locationBus->_gradient[timeSlotId], _phaseIndicesInLocationBus);
-    
     // do movement and projection
     for (int phaseId = 0; phaseId < numberOfPhases; phaseId ++) {
         // movement
         double reactivePower = _oldValueArray[timeSlotId]._power[phaseId].imag();
-        reactivePower -= stepSize * gradient[phaseId].imag();
+        reactivePower -= stepSize * searchGradientAtTime(timeSlotId, phaseId).imag();
         
         // projection
         double realPower = _oldValueArray[timeSlotId]._power[phaseId].real();
@@ -90,3 +85,43 @@ void PhotoVoltaicController::attemptPowerOverHorizon(const double &stepSize) {
         attemptPowerAtTime(stepSize, timeSlotId);
     }
 }
+
+// only reactive power moves, within the capacity left by the real power
+void PhotoVoltaicController::projectOntoFreeDirectionsAtTime(const int &timeSlotId, ColumnVector<complex_type> &direction) const {
+    for (int phaseId = 0; phaseId < _phaseIndicesInLocationBus.size(); phaseId ++) {
+        double gradient = _locationBus->_gradient[timeSlotId]._data[_phaseIndicesInLocationBus[phaseId]].imag();
+        double reactivePower = _oldValueArray[timeSlotId]._power._data[phaseId].imag();
+        double realPower = _oldValueArray[timeSlotId]._power._data[phaseId].real();
+        double maxReactivePowerMagnitude = sqrt( _nameplate * _nameplate - realPower * realPower );
+        bool fixed = (reactivePower >= maxReactivePowerMagnitude && gradient < 0.0) ||
+                     (reactivePower <= -maxReactivePowerMagnitude && gradient > 0.0);
+        direction._data[phaseId] = complex_type(0.0, fixed ? 0.0 : direction._data[phaseId].imag());
+    }
+}
+
+// take reactive power from the kept solution
+void PhotoVoltaicController::warmStartOverHorizon(const vector<int> &sourceSlotIds) {
+    if (_warmStartValueArray.size() != _valueArray.size())
+        return;
+    for (int timeSlotId = 0; timeSlotId < _valueArray.size(); timeSlotId ++) {
+        if (sourceSlotIds[timeSlotId] >= 0)
+            holdSetPointAtTime(_warmStartValueArray[sourceSlotIds[timeSlotId]], timeSlotId);
+    }
+}
+
+// take reactive power from the set-point, within the capacity left by the real power
+void PhotoVoltaicController::holdSetPointAtTime(const LoadValue &setPoint, const int &timeSlotId) {
+    for (int phaseId = 0; phaseId < _phaseIndicesInLocationBus.size(); phaseId ++) {
+        double reactivePower = setPoint._power._data[phaseId].imag();
+        
+        // projection
+        double realPower = _valueArray[timeSlotId]._power[phaseId].real();
+        double maxReactivePowerMagnitude = sqrt( _nameplate * _nameplate - realPower * realPower );
+        if (reactivePower > maxReactivePowerMagnitude)
+            reactivePower = maxReactivePowerMagnitude;
+        else if (reactivePower < -maxReactivePowerMagnitude)
+            reactivePower = -maxReactivePowerMagnitude;
+        
+        _valueArray[timeSlotId]._power[phaseId].imag(reactivePower);
+    }
+}
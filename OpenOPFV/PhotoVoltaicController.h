@@ -61,6 +61,15 @@ public:
     // compute tentative power consumption, _oldValueArray[timeSlotId] unchanged
     virtual void attemptPowerAtTime(const double &stepSize, const int &timeSlotId);
     virtual void attemptPowerOverHorizon(const double &stepSize);
+    
+    // only reactive power moves, and not beyond the capacity left by the real power
+    virtual void projectOntoFreeDirectionsAtTime(const int &timeSlotId, ColumnVector<complex_type> &direction) const;
+    
+    // take reactive power from the kept solution, within the capacity left by the predicted real power
+    virtual void warmStartOverHorizon(const vector<int> &sourceSlotIds);
+    
+    // take reactive power from the set-point, within the capacity left by the measured real power
+    virtual void holdSetPointAtTime(const LoadValue &setPoint, const int &timeSlotId);
 };
 
 #endif /* defined(__OptimalPowerFlowVisualization__PhotoVoltaicController__) */
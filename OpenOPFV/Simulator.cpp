@@ -17,6 +17,7 @@
  *
  ***********************************************************************/
 
+#include <algorithm>
 #include "Simulator.h"
 
 /******************************
@@ -24,7 +25,10 @@
  ******************************/
 
 // default constructor
-Simulator::Simulator() : _currentTimeInMinutes(-1.0) {
+Simulator::Simulator() :
+_currentTimeInMinutes(-1.0),
+_fineWindowInHours(0.0),
+_coarseningFactor(1) {
 }
 
 // copy constructor
@@ -35,6 +39,8 @@ _loadPredictor(simulator._loadPredictor),
 _networkModel(simulator._networkModel),
 _networkControl(simulator._networkControl),
 _eventQueue(simulator._eventQueue),
+_fastControlTelemetry(simulator._fastControlTelemetry),
+_slowControlTelemetry(simulator._slowControlTelemetry),
 
 _inputFolderName(simulator._inputFolderName),
 _nextLoadFileName(simulator._nextLoadFileName),
@@ -55,6 +61,8 @@ _enableCapacitorFastControl(simulator._enableCapacitorFastControl),
 _enableSlowControl(simulator._enableSlowControl),
 _slowControlPeriodInMinutes(simulator._slowControlPeriodInMinutes),
 _predictionWindowInHours(simulator._predictionWindowInHours),
+_fineWindowInHours(simulator._fineWindowInHours),
+_coarseningFactor(simulator._coarseningFactor),
 _enablePhotoVoltaicSlowControl(simulator._enablePhotoVoltaicSlowControl),
 _enableElectricVehicleSlowControl(simulator._enableElectricVehicleSlowControl),
 _enablePoolPumpSlowControl(simulator._enablePoolPumpSlowControl),
@@ -71,6 +79,8 @@ void Simulator::clear() {
     _networkModel.clear();
     _networkControl.clear();
     _eventQueue.clear();
+    _fastControlTelemetry.clear();
+    _slowControlTelemetry.clear();
     _currentTimeInMinutes = 0.0;
 }
 
@@ -87,6 +97,8 @@ void Simulator::operator=(const Simulator &simulator) {
     _networkModel = simulator._networkModel;
     _networkControl = simulator._networkControl;
     _eventQueue = simulator._eventQueue;
+    _fastControlTelemetry = simulator._fastControlTelemetry;
+    _slowControlTelemetry = simulator._slowControlTelemetry;
     
     _inputFolderName = simulator._inputFolderName;
     _nextLoadFileName = simulator._nextLoadFileName;
@@ -107,6 +119,8 @@ void Simulator::operator=(const Simulator &simulator) {
     _enableSlowControl = simulator._enableSlowControl;
     _slowControlPeriodInMinutes = simulator._slowControlPeriodInMinutes;
     _predictionWindowInHours = simulator._predictionWindowInHours;
+    _fineWindowInHours = simulator._fineWindowInHours;
+    _coarseningFactor = simulator._coarseningFactor;
     _enablePhotoVoltaicSlowControl = simulator._enablePhotoVoltaicSlowControl;
     _enableElectricVehicleSlowControl = simulator._enableElectricVehicleSlowControl;
     _enablePoolPumpSlowControl = simulator._enablePoolPumpSlowControl;
@@ -122,6 +136,13 @@ ostream &operator<<(ostream &cout, Simulator *simulator) {
     return cout;
 }
 
+void Simulator::printTelemetry(ostream &cout) {
+    cout << "fast control:" << std::endl;
+    cout << _fastControlTelemetry;
+    cout << "slow control:" << std::endl;
+    cout << _slowControlTelemetry;
+}
+
 void Simulator::printSubstationPowerInjectionOverHorizon(ostream &cout) {
     BusController *busController = _networkControl._buses[0];
     for (int phaseId = 0; phaseId < busController->_bus->phase().size(); phaseId ++) {
@@ -162,6 +183,14 @@ EventQueue *Simulator::eventQueue() {
     return &_eventQueue;
 }
 
+const SolverTelemetry &Simulator::fastControlTelemetry() const {
+    return _fastControlTelemetry;
+}
+
+const SolverTelemetry &Simulator::slowControlTelemetry() const {
+    return _slowControlTelemetry;
+}
+
 string Simulator::inputFolderName() const {
     return _inputFolderName;
 }
@@ -226,6 +255,14 @@ time_type Simulator::predictionWindowInHours() const {
     return _predictionWindowInHours;
 }
 
+time_type Simulator::fineWindowInHours() const {
+    return _fineWindowInHours;
+}
+
+int Simulator::coarseningFactor() const {
+    return _coarseningFactor;
+}
+
 bool Simulator::enablePhotoVoltaicSlowControl() const {
     return _enablePhotoVoltaicSlowControl;
 }
@@ -318,6 +355,14 @@ void Simulator::setPredictionWindowInHours(const time_type &predictionWindowInHo
     _predictionWindowInHours = predictionWindowInHours;
 }
 
+void Simulator::setFineWindowInHours(const time_type &fineWindowInHours) {
+    _fineWindowInHours = fineWindowInHours;
+}
+
+void Simulator::setCoarseningFactor(const int &coarseningFactor) {
+    _coarseningFactor = coarseningFactor;
+}
+
 void Simulator::setEnablePhotoVoltaicSlowConotrol(const bool &enablePhotoVoltaicSlowControl) {
     _enablePhotoVoltaicSlowControl = enablePhotoVoltaicSlowControl;
 }
@@ -561,9 +606,8 @@ void Simulator::setNextLoadFile() {
 void Simulator::initNetworkControl() {
     // init _numberOfSlots, which is necessary in constructing the buses and lines
     if (_enableSlowControl) {
-        int numberOfSlotsInSlowControl = int(_predictionWindowInHours * 60 / _slowControlPeriodInMinutes);
-        _networkControl.setNumberOfSlots(numberOfSlotsInSlowControl);
         _networkControl._slotLengthInMinutes = _slowControlPeriodInMinutes;
+        _networkControl.setSlotLengths(slowControlSlotLengthsInMinutes());
     }
     else
         _networkControl.setNumberOfSlots(1);
@@ -598,6 +642,22 @@ void Simulator::initNetworkControl() {
     _networkControl.initialize(_networkModel);
 }
 
+// lengths of slow control slots
+// a window that is not a multiple of the coarse slots ends with a shorter slot
+vector<time_type> Simulator::slowControlSlotLengthsInMinutes() const {
+    int numberOfSlotsInSlowControl = int(_predictionWindowInHours * 60 / _slowControlPeriodInMinutes);
+    int numberOfFineSlots = numberOfSlotsInSlowControl;
+    if (_coarseningFactor > 1 && _fineWindowInHours > 0.0)
+        numberOfFineSlots = std::min(int(_fineWindowInHours * 60 / _slowControlPeriodInMinutes), numberOfSlotsInSlowControl);
+    
+    vector<time_type> result(numberOfFineSlots, _slowControlPeriodInMinutes);
+    for (int periodId = numberOfFineSlots; periodId < numberOfSlotsInSlowControl; periodId += _coarseningFactor) {
+        int numberOfPeriods = std::min(_coarseningFactor, numberOfSlotsInSlowControl - periodId);
+        result.push_back(numberOfPeriods * _slowControlPeriodInMinutes);
+    }
+    return result;
+}
+
 // load predicator
 void Simulator::initLoadPredicator() {
     // to be written
@@ -669,7 +729,8 @@ EventReturnType Simulator::executeEvent() {
     
     // handle fast control
     if (action == FAST_CONTROL) {
-        _networkControl.fastControl();
+        _networkControl.fastControl(time);
+        _fastControlTelemetry.accumulate(_networkControl._telemetry);
         _networkModel.computePowerFlowWithGridLabD();
         event._time += fastControlPeriodInSeconds() / 60;
         _eventQueue.push(event);
@@ -678,8 +739,13 @@ EventReturnType Simulator::executeEvent() {
     
     // handle slow control
     else if (action == SLOW_CONTROL) {
+        std::chrono::steady_clock::time_point predictionStartTime = std::chrono::steady_clock::now();
         _loadPredictor.makePrediction(&_networkControl, &_futureData, time, _slowControlPeriodInMinutes);
+        double predictionSeconds = SolverTelemetry::secondsSince(predictionStartTime);
         _networkControl.slowControl(time);
+        SolverTelemetry telemetry = _networkControl._telemetry;
+        telemetry._initializeSeconds += predictionSeconds;
+        _slowControlTelemetry.accumulate(telemetry);
         _networkModel.computePowerFlowWithGridLabD();
         // printSubstationPowerInjectionOverHorizon(std::cout);
         event._time += slowControlPeriodInMinutes();
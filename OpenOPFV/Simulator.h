@@ -40,6 +40,8 @@ private:
     NetworkModel _networkModel;             // real-time real data stays here, real power flow run here
     NetworkControl _networkControl;         // control data stays here, control algorithm run here
     EventQueue _eventQueue;                 // event queue that maintains data flow
+    SolverTelemetry _fastControlTelemetry;  // work done by fast controls so far
+    SolverTelemetry _slowControlTelemetry;  // work done by slow controls so far, including load prediction
     
     
     /******************************
@@ -69,6 +71,8 @@ private:
     bool _enableSlowControl;                    // set to true if want to do slow time scale control
     time_type _slowControlPeriodInMinutes;      // the period of slow control, in minutes
     time_type _predictionWindowInHours;         // the length of prediction window, in hours
+    time_type _fineWindowInHours;               // the near-term part of prediction window solved every slow control period
+    int _coarseningFactor;                      // slots past the fine window are this many slow control periods long
     bool _enablePhotoVoltaicSlowControl;        // set to true if control photovoltaic inverters in slow control
     bool _enableElectricVehicleSlowControl;     // set to true if control electric vehicles in slow control
     bool _enablePoolPumpSlowControl;            // set to true if control pool pumps in slow control
@@ -101,6 +105,7 @@ public:
     // print
     friend ostream &operator<<(ostream &cout, const Simulator &simulator);
     void printSubstationPowerInjectionOverHorizon(ostream &cout);
+    void printTelemetry(ostream &cout);
     
     
     /******************************
@@ -114,6 +119,8 @@ public:
     NetworkModel *networkModel();
     NetworkControl *networkControl();
     EventQueue *eventQueue();
+    const SolverTelemetry &fastControlTelemetry() const;
+    const SolverTelemetry &slowControlTelemetry() const;
     
     string inputFolderName() const;
     string nextLoadFileName() const;
@@ -134,6 +141,8 @@ public:
     bool enableSlowControl() const;
     time_type slowControlPeriodInMinutes() const;
     time_type predictionWindowInHours() const;
+    time_type fineWindowInHours() const;
+    int coarseningFactor() const;
     bool enablePhotoVoltaicSlowControl() const;
     bool enableElectricVehicleSlowControl() const;
     bool enablePoolPumpSlowControl() const;
@@ -164,6 +173,8 @@ public:
     void setEnableSlowControl(const bool &enableSlowControl);
     void setSlowControlPeriodInMinutes(const time_type &slowControlPeriodInMinutes);
     void setPredictionWindowInHours(const time_type &predictionWindowInHours);
+    void setFineWindowInHours(const time_type &fineWindowInHours);
+    void setCoarseningFactor(const int &coarseningFactor);
     void setEnablePhotoVoltaicSlowConotrol(const bool &enablePhotoVoltaicSlowControl);
     void setEnableElectricVehicleSlowControl(const bool &enableElectricVehicleSlowControl);
     void setEnablePoolPumpSlowControl(const bool &enablePoolPumpSlowControl);
@@ -197,6 +208,9 @@ public:
     // network controller: initialize controller
     void initNetworkControl();
     
+    // lengths of slow control slots, every slow control period over the fine window, and coarser after
+    vector<time_type> slowControlSlotLengthsInMinutes() const;
+    
     // load predicator
     void initLoadPredicator();
     
@@ -0,0 +1,198 @@
+/***********************************************************************
+ * Copyright (c) 2014 Energy Adaptive Networks Corp. All rights reserved.
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License v2 or Energy Adaptive Networks
+ * Commercial License, which accompanies this distribution.
+ * Any use, reproduction or distribution of the program constitutes the
+ * recipient’s acceptance of this agreement.
+ * http://www.eclipse.org/legal/epl-v20.html
+ *
+ * Contributors:
+ *    Energy Adaptive Networks Corp. - dev API
+ *    Lingwen Gan - initial flow implementation
+ *    Peter Enescu - initial implementation, test, docs
+ *
+ * Project OpenOPFV - Optimal Power Flow Visualizer – 7/20/2019
+ * Module SolutionCache.cpp
+ *
+ ***********************************************************************/
+
+#include <algorithm>
+#include <cmath>
+#include <limits>
+#include <sstream>
+#include "SolutionCache.h"
+
+/******************************
+ basic functions
+ ******************************/
+
+// default constructor
+SolutionCache::SolutionCache() {
+    _tolerance = 0.1;
+    _maxSolutionsPerKey = 4;
+}
+
+// forget all solutions
+void SolutionCache::clear() {
+    _solutions.clear();
+}
+
+// read the solutions kept in fileName
+void SolutionCache::open(const string &fileName) {
+    _fileName = fileName;
+    _solutions.clear();
+    if (_fileName.empty())
+        return;
+    
+    std::ifstream inFile(_fileName);
+    string key;
+    CachedSolution solution;
+    while (inFile.is_open() && read(inFile, key, solution))
+        insert(key, solution);
+    inFile.close();
+    
+    // rewrite the file with the solutions kept
+    ofstream outFile(_fileName);
+    if (! outFile.is_open()) {
+        std::cout << "Cannot write solution cache " << _fileName << std::endl;
+        return;
+    }
+    for (unordered_map<string, vector<CachedSolution>>::const_iterator it = _solutions.begin(); it != _solutions.end(); it ++) {
+        for (int solutionId = 0; solutionId < it->second.size(); solutionId ++)
+            write(outFile, it->first, it->second[solutionId]);
+    }
+}
+
+
+/******************************
+ lookup and store
+ ******************************/
+
+// key of solutions
+string SolutionCache::key(time_type timeOfDayInMinutes, const string &fleetSignature) {
+    std::ostringstream result;
+    result << int( std::floor(timeOfDayInMinutes + 0.5) ) << "|" << fleetSignature;
+    return result.str();
+}
+
+// solution with the nearest fingerprint
+const CachedSolution *SolutionCache::nearest(const string &key, const vector<double> &fingerprint) const {
+    unordered_map<string, vector<CachedSolution>>::const_iterator it = _solutions.find(key);
+    if (it == _solutions.end())
+        return NULL;
+    const CachedSolution *result = NULL;
+    double minDistance = _tolerance;
+    for (int solutionId = 0; solutionId < it->second.size(); solutionId ++) {
+        double distance = relativeDistance(fingerprint, it->second[solutionId]._fingerprint);
+        if (distance <= minDistance) {
+            minDistance = distance;
+            result = &it->second[solutionId];
+        }
+    }
+    return result;
+}
+
+// keep solution under key, and append it to the file
+void SolutionCache::store(const string &key, const CachedSolution &solution) {
+    insert(key, solution);
+    if (_fileName.empty())
+        return;
+    ofstream file(_fileName, std::ofstream::app);
+    if (! file.is_open()) {
+        std::cout << "Cannot write solution cache " << _fileName << std::endl;
+        return;
+    }
+    write(file, key, solution);
+}
+
+// relative distance of two fingerprints
+double SolutionCache::relativeDistance(const vector<double> &fingerprint1, const vector<double> &fingerprint2) {
+    if (fingerprint1.size() != fingerprint2.size())
+        return std::numeric_limits<double>::infinity();
+    double distanceSquare = 0.0;
+    double normSquare = 0.0;
+    for (int i = 0; i < fingerprint1.size(); i ++) {
+        distanceSquare += (fingerprint1[i] - fingerprint2[i]) * (fingerprint1[i] - fingerprint2[i]);
+        normSquare += fingerprint2[i] * fingerprint2[i];
+    }
+    return std::sqrt(distanceSquare / std::max(normSquare, 1e-12));
+}
+
+// keep solution under key
+void SolutionCache::insert(const string &key, const CachedSolution &solution) {
+    vector<CachedSolution> &solutions = _solutions[key];
+    
+    // replace the nearest solution within tolerance, the newer one is closer to the days to come
+    int nearestId = -1;
+    double minDistance = _tolerance;
+    for (int solutionId = 0; solutionId < solutions.size(); solutionId ++) {
+        double distance = relativeDistance(solution._fingerprint, solutions[solutionId]._fingerprint);
+        if (distance <= minDistance) {
+            minDistance = distance;
+            nearestId = solutionId;
+        }
+    }
+    if (nearestId >= 0)
+        solutions.erase(solutions.begin() + nearestId);
+    else if (solutions.size() >= _maxSolutionsPerKey)
+        solutions.erase(solutions.begin());
+    solutions.push_back(solution);
+}
+
+// write a solution
+// <solution> key mu iterations fingerprintLength fingerprint... numberOfLoads, then per load: name numberOfValues real imag ...
+void SolutionCache::write(ostream &file, const string &key, const CachedSolution &solution) {
+    file.precision(17);
+    file << "<solution> " << key << " " << solution._mu << " " << solution._iterations << " " << solution._fingerprint.size();
+    for (int i = 0; i < solution._fingerprint.size(); i ++)
+        file << " " << solution._fingerprint[i];
+    file << " " << solution._powers.size() << '\n';
+    for (unordered_map<string, vector<complex_type>>::const_iterator it = solution._powers.begin(); it != solution._powers.end(); it ++) {
+        file << it->first << " " << it->second.size();
+        for (int i = 0; i < it->second.size(); i ++)
+            file << " " << it->second[i].real() << " " << it->second[i].imag();
+        file << '\n';
+    }
+    file << "</solution>" << '\n';
+}
+
+// read a solution
+bool SolutionCache::read(std::istream &file, string &key, CachedSolution &solution) {
+    string tag;
+    if (! (file >> tag) || tag.compare("<solution>") != 0)
+        return false;
+    
+    int fingerprintLength = 0;
+    int numberOfLoads = 0;
+    file >> key >> solution._mu >> solution._iterations >> fingerprintLength;
+    if (! file || fingerprintLength < 0)
+        return false;
+    solution._fingerprint.assign(fingerprintLength, 0.0);
+    for (int i = 0; i < fingerprintLength; i ++)
+        file >> solution._fingerprint[i];
+    file >> numberOfLoads;
+    
+    solution._powers.clear();
+    for (int loadId = 0; file && loadId < numberOfLoads; loadId ++) {
+        string name;
+        int numberOfValues = 0;
+        file >> name >> numberOfValues;
+        if (! file || numberOfValues < 0)
+            return false;
+        vector<complex_type> &powers = solution._powers[name];
+        powers.assign(numberOfValues, complex_type(0.0, 0.0));
+        for (int i = 0; i < numberOfValues; i ++) {
+            double real = 0.0, imag = 0.0;
+            file >> real >> imag;
+            powers[i] = complex_type(real, imag);
+        }
+    }
+    
+    // a record cut short by an interrupted run ends the file
+    if (! (file >> tag) || tag.compare("</solution>") != 0) {
+        std::cout << "Solution cache ends with an incomplete record" << std::endl;
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,88 @@
+/***********************************************************************
+ * Copyright (c) 2014 Energy Adaptive Networks Corp. All rights reserved.
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License v2 or Energy Adaptive Networks
+ * Commercial License, which accompanies this distribution.
+ * Any use, reproduction or distribution of the program constitutes the
+ * recipient’s acceptance of this agreement.
+ * http://www.eclipse.org/legal/epl-v20.html
+ *
+ * Contributors:
+ *    Energy Adaptive Networks Corp. - dev API
+ *    Lingwen Gan - initial flow implementation
+ *    Peter Enescu - initial implementation, test, docs
+ *
+ * Project OpenOPFV - Optimal Power Flow Visualizer – 7/20/2019
+ * Module SolutionCache.h
+ *
+ ***********************************************************************/
+
+#ifndef __OptimalPowerFlowVisualization__SolutionCache__
+#define __OptimalPowerFlowVisualization__SolutionCache__
+
+#include "BasicDataType.h"
+
+// a slow control solution kept for later days
+struct CachedSolution {
+    vector<double> _fingerprint;                            // coarse load profile the solution was computed for
+    double _mu;                                             // final mu of the solution
+    int _iterations;                                        // inner loop iterations of the solve without a cached start it descends from
+    unordered_map<string, vector<complex_type>> _powers;    // power of every controllable load by name, slot then phase
+};
+
+// slow control solutions by time of day and set of EVs, persisted to a file between runs
+// solutions under the same key are told apart by their fingerprints, and a lookup returns the nearest one
+class SolutionCache {
+public:
+    /******************************
+     cache description
+     ******************************/
+    string _fileName;                                       // file the solutions are appended to, none if empty
+    double _tolerance;                                      // largest relative distance of fingerprints of a hit
+    int _maxSolutionsPerKey;                                // the oldest solution of a key is dropped beyond this
+    unordered_map<string, vector<CachedSolution>> _solutions;   // solutions by key, oldest first
+    
+    
+public:
+    /******************************
+     basic functions
+     ******************************/
+    
+    // default constructor
+    SolutionCache();
+    
+    // forget all solutions, the file is kept
+    void clear();
+    
+    // read the solutions kept in fileName, and append new ones to it
+    // the file is rewritten without the solutions that were replaced or dropped since
+    void open(const string &fileName);
+    
+    
+    /******************************
+     lookup and store
+     ******************************/
+    
+    // key of solutions at timeOfDayInMinutes with the EVs described by fleetSignature, which has no white space
+    static string key(time_type timeOfDayInMinutes, const string &fleetSignature);
+    
+    // solution under key with the nearest fingerprint, NULL if none is within _tolerance
+    const CachedSolution *nearest(const string &key, const vector<double> &fingerprint) const;
+    
+    // keep solution under key, in place of the nearest one within _tolerance if any, and append it to the file
+    void store(const string &key, const CachedSolution &solution);
+    
+    
+private:
+    // distance of two fingerprints relative to the size of the second, infinite if their lengths differ
+    static double relativeDistance(const vector<double> &fingerprint1, const vector<double> &fingerprint2);
+    
+    // keep solution under key without writing the file
+    void insert(const string &key, const CachedSolution &solution);
+    
+    // write a solution and its key, or read one, which returns false at the end of the file or on a malformed record
+    static void write(ostream &file, const string &key, const CachedSolution &solution);
+    static bool read(std::istream &file, string &key, CachedSolution &solution);
+};
+
+#endif /* defined(__OptimalPowerFlowVisualization__SolutionCache__) */
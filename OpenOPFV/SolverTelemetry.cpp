@@ -0,0 +1,140 @@
+/***********************************************************************
+ * Copyright (c) 2014 Energy Adaptive Networks Corp. All rights reserved.
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License v2 or Energy Adaptive Networks
+ * Commercial License, which accompanies this distribution.
+ * Any use, reproduction or distribution of the program constitutes the
+ * recipient’s acceptance of this agreement.
+ * http://www.eclipse.org/legal/epl-v20.html
+ *
+ * Contributors:
+ *    Energy Adaptive Networks Corp. - dev API
+ *    Lingwen Gan - initial flow implementation
+ *    Peter Enescu - initial implementation, test, docs
+ *
+ * Project OpenOPFV - Optimal Power Flow Visualizer – 7/20/2019
+ * Module SolverTelemetry.cpp
+ *
+ ***********************************************************************/
+
+#include <algorithm>
+#include "SolverTelemetry.h"
+
+/******************************
+ basic functions
+ ******************************/
+
+// default constructor
+SolverTelemetry::SolverTelemetry() {
+    clear();
+}
+
+// forget everything recorded
+void SolverTelemetry::clear() {
+    _numberOfSolves = 0;
+    _outerIterations = 0;
+    _muValues.clear();
+    _dualityGaps.clear();
+    _innerIterationsPerMu.clear();
+    _feasibilityRounds = 0;
+    _feasibilityIterations = 0;
+    _lineSearchBacktracks = 0;
+    _powerFlowEvaluations = 0;
+    _voltVarFallbacks = 0;
+    _cacheLookups = 0;
+    _cacheHits = 0;
+    _cacheIterationsSaved = 0;
+    _initializeSeconds = 0.0;
+    _feasibilitySeconds = 0.0;
+    _optimizationSeconds = 0.0;
+    _finalizeSeconds = 0.0;
+    _maxTotalSeconds = 0.0;
+}
+
+// print
+ostream &operator<<(ostream &cout, const SolverTelemetry &telemetry) {
+    cout << "solves = " << telemetry._numberOfSolves << std::endl;
+    cout << "outer iterations = " << telemetry._outerIterations << std::endl;
+    cout << "inner iterations per mu =";
+    for (int i = 0; i < telemetry._innerIterationsPerMu.size(); i ++)
+        cout << " " << telemetry._innerIterationsPerMu[i];
+    cout << std::endl;
+    if (! telemetry._dualityGaps.empty()) {
+        cout << "mu, duality gap of the last solve =";
+        for (int i = 0; i < telemetry._dualityGaps.size(); i ++)
+            cout << " " << telemetry._muValues[i] << ", " << telemetry._dualityGaps[i] << ";";
+        cout << std::endl;
+    }
+    cout << "feasibility rounds = " << telemetry._feasibilityRounds
+         << ", iterations = " << telemetry._feasibilityIterations << std::endl;
+    cout << "line search backtracks = " << telemetry._lineSearchBacktracks << std::endl;
+    cout << "power flow evaluations = " << telemetry._powerFlowEvaluations << std::endl;
+    if (telemetry._voltVarFallbacks > 0)
+        cout << "Volt/VAR fallbacks = " << telemetry._voltVarFallbacks << std::endl;
+    if (telemetry._cacheLookups > 0) {
+        cout << "solution cache lookups = " << telemetry._cacheLookups
+             << ", hits = " << telemetry._cacheHits
+             << ", hit rate = " << double(telemetry._cacheHits) / telemetry._cacheLookups
+             << ", inner iterations saved = " << telemetry._cacheIterationsSaved << std::endl;
+    }
+    cout << "seconds: initialize = " << telemetry._initializeSeconds
+         << ", feasibility = " << telemetry._feasibilitySeconds
+         << ", optimization = " << telemetry._optimizationSeconds
+         << ", finalize = " << telemetry._finalizeSeconds
+         << ", total = " << telemetry.totalSeconds()
+         << ", max = " << telemetry._maxTotalSeconds << std::endl;
+    if (telemetry._numberOfSolves > 1)
+        cout << "seconds per solve = " << telemetry.totalSeconds() / telemetry._numberOfSolves << std::endl;
+    return cout;
+}
+
+
+/******************************
+ record and query
+ ******************************/
+
+// add the record of a solve or of other solves
+void SolverTelemetry::accumulate(const SolverTelemetry &telemetry) {
+    _numberOfSolves += telemetry._numberOfSolves;
+    _outerIterations += telemetry._outerIterations;
+    if (! telemetry._muValues.empty())
+        _muValues = telemetry._muValues;
+    if (! telemetry._dualityGaps.empty())
+        _dualityGaps = telemetry._dualityGaps;
+    if (_innerIterationsPerMu.size() < telemetry._innerIterationsPerMu.size())
+        _innerIterationsPerMu.resize(telemetry._innerIterationsPerMu.size(), 0);
+    for (int i = 0; i < telemetry._innerIterationsPerMu.size(); i ++)
+        _innerIterationsPerMu[i] += telemetry._innerIterationsPerMu[i];
+    _feasibilityRounds += telemetry._feasibilityRounds;
+    _feasibilityIterations += telemetry._feasibilityIterations;
+    _lineSearchBacktracks += telemetry._lineSearchBacktracks;
+    _powerFlowEvaluations += telemetry._powerFlowEvaluations;
+    _voltVarFallbacks += telemetry._voltVarFallbacks;
+    _cacheLookups += telemetry._cacheLookups;
+    _cacheHits += telemetry._cacheHits;
+    _cacheIterationsSaved += telemetry._cacheIterationsSaved;
+    _initializeSeconds += telemetry._initializeSeconds;
+    _feasibilitySeconds += telemetry._feasibilitySeconds;
+    _optimizationSeconds += telemetry._optimizationSeconds;
+    _finalizeSeconds += telemetry._finalizeSeconds;
+    _maxTotalSeconds = std::max(_maxTotalSeconds, std::max(telemetry._maxTotalSeconds, telemetry.totalSeconds()));
+}
+
+// inner loop iterations over all barrier values
+int SolverTelemetry::innerIterations() const {
+    int result = 0;
+    for (int i = 0; i < _innerIterationsPerMu.size(); i ++)
+        result += _innerIterationsPerMu[i];
+    return result;
+}
+
+// wall time of all phases
+double SolverTelemetry::totalSeconds() const {
+    return _initializeSeconds + _feasibilitySeconds + _optimizationSeconds + _finalizeSeconds;
+}
+
+// wall time since start
+double SolverTelemetry::secondsSince(const std::chrono::steady_clock::time_point &start) {
+    std::chrono::duration<double> elapsed = std::chrono::steady_clock::now() - start;
+    return elapsed.count();
+}
@@ -0,0 +1,88 @@
+/***********************************************************************
+ * Copyright (c) 2014 Energy Adaptive Networks Corp. All rights reserved.
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License v2 or Energy Adaptive Networks
+ * Commercial License, which accompanies this distribution.
+ * Any use, reproduction or distribution of the program constitutes the
+ * recipient’s acceptance of this agreement.
+ * http://www.eclipse.org/legal/epl-v20.html
+ *
+ * Contributors:
+ *    Energy Adaptive Networks Corp. - dev API
+ *    Lingwen Gan - initial flow implementation
+ *    Peter Enescu - initial implementation, test, docs
+ *
+ * Project OpenOPFV - Optimal Power Flow Visualizer – 7/20/2019
+ * Module SolverTelemetry.h
+ *
+ ***********************************************************************/
+
+#ifndef __OptimalPowerFlowVisualization__SolverTelemetry__
+#define __OptimalPowerFlowVisualization__SolverTelemetry__
+
+#include "BasicDataType.h"
+
+// work done by fast or slow control, for a single solve or accumulated over many
+class SolverTelemetry {
+public:
+    /******************************
+     counts
+     ******************************/
+    int _numberOfSolves;                    // solves recorded
+    int _outerIterations;                   // barrier values the inner loop ran with after a feasible point is found
+    vector<double> _muValues;               // barrier values of the last solve recorded
+    vector<double> _dualityGaps;            // duality gaps measured after each of them, adaptive continuation only
+    vector<int> _innerIterationsPerMu;      // inner loop iterations at every barrier value, added by position over solves
+    int _feasibilityRounds;                 // inner loops run to find a feasible point
+    int _feasibilityIterations;             // inner loop iterations in those rounds
+    int _lineSearchBacktracks;              // step sizes backed off in line searches
+    int _powerFlowEvaluations;              // power flows solved, one per time slot
+    int _voltVarFallbacks;                  // solves out of time that set PV by Volt/VAR droop curves instead
+    int _cacheLookups;                      // solves that looked for a solution of past days to start from
+    int _cacheHits;                         // solves that found one
+    int _cacheIterationsSaved;              // inner loop iterations they saved over the solves their solutions descend from
+    
+    
+    /******************************
+     wall time in seconds
+     ******************************/
+    double _initializeSeconds;              // set up of the start point and its power flow, and load prediction in Simulator
+    double _feasibilitySeconds;             // search for a feasible point
+    double _optimizationSeconds;            // inner loops over the barrier values
+    double _finalizeSeconds;                // applying the result and keeping what the next solve reuses
+    double _maxTotalSeconds;                // longest solve recorded
+    
+    
+public:
+    /******************************
+     basic functions
+     ******************************/
+    
+    // default constructor
+    SolverTelemetry();
+    
+    // forget everything recorded
+    void clear();
+    
+    // print counts and times, per solve if more than one solve is recorded
+    friend ostream &operator<<(ostream &cout, const SolverTelemetry &telemetry);
+    
+    
+    /******************************
+     record and query
+     ******************************/
+    
+    // add the record of a solve or of other solves
+    void accumulate(const SolverTelemetry &telemetry);
+    
+    // inner loop iterations over all barrier values, not counting the feasibility rounds
+    int innerIterations() const;
+    
+    // wall time of all phases
+    double totalSeconds() const;
+    
+    // wall time since start
+    static double secondsSince(const std::chrono::steady_clock::time_point &start);
+};
+
+#endif /* defined(__OptimalPowerFlowVisualization__SolverTelemetry__) */
@@ -0,0 +1,118 @@
+/***********************************************************************
+ * Copyright (c) 2014 Energy Adaptive Networks Corp. All rights reserved.
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License v2 or Energy Adaptive Networks
+ * Commercial License, which accompanies this distribution.
+ * Any use, reproduction or distribution of the program constitutes the
+ * recipient’s acceptance of this agreement.
+ * http://www.eclipse.org/legal/epl-v20.html
+ *
+ * Contributors:
+ *    Energy Adaptive Networks Corp. - dev API
+ *    Lingwen Gan - initial flow implementation
+ *    Peter Enescu - initial implementation, test, docs
+ *
+ * Project OpenOPFV - Optimal Power Flow Visualizer – 7/20/2019
+ * Module ThreadPool.cpp
+ *
+ ***********************************************************************/
+
+#include "ThreadPool.h"
+
+/******************************
+ basic functions
+ ******************************/
+
+// constructor
+ThreadPool::ThreadPool(int numberOfThreads) :
+_numberOfThreads(numberOfThreads < 1 ? 1 : numberOfThreads),
+_task(NULL),
+_nextIndex(0),
+_endIndex(0),
+_generation(0),
+_numberOfBusyWorkers(0),
+_stop(false) {
+    // the calling thread takes threadId 0
+    for (int threadId = 1; threadId < _numberOfThreads; threadId ++) {
+        _workers.push_back(std::thread(&ThreadPool::workerLoop, this, threadId));
+    }
+}
+
+// deconstructor
+ThreadPool::~ThreadPool() {
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _stop = true;
+    }
+    _taskReady.notify_all();
+    for (int workerId = 0; workerId < _workers.size(); workerId ++) {
+        _workers[workerId].join();
+    }
+}
+
+
+/******************************
+ task execution
+ ******************************/
+
+void ThreadPool::parallelFor(int beginIndex, int endIndex, const std::function<void(int, int)> &task) {
+    if (beginIndex >= endIndex)
+        return;
+
+    // nothing to share, run on the calling thread
+    if (_workers.empty() || endIndex - beginIndex == 1) {
+        for (int index = beginIndex; index < endIndex; index ++) {
+            task(index, 0);
+        }
+        return;
+    }
+
+    // hand the task to the workers
+    {
+        std::unique_lock<std::mutex> lock(_mutex);
+        _task = &task;
+        _nextIndex = beginIndex;
+        _endIndex = endIndex;
+        _numberOfBusyWorkers = int( _workers.size() );
+        _generation ++;
+    }
+    _taskReady.notify_all();
+
+    // the calling thread works as well
+    runTask(0);
+
+    // wait for the workers
+    std::unique_lock<std::mutex> lock(_mutex);
+    _taskDone.wait(lock, [this] { return _numberOfBusyWorkers == 0; });
+    _task = NULL;
+}
+
+void ThreadPool::runTask(int threadId) {
+    while ( true ) {
+        int index = _nextIndex ++;
+        if (index >= _endIndex)
+            break;
+        (*_task)(index, threadId);
+    }
+}
+
+void ThreadPool::workerLoop(int threadId) {
+    int generation = 0;
+    while ( true ) {
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _taskReady.wait(lock, [this, generation] { return _stop || _generation != generation; });
+            if (_stop)
+                return;
+            generation = _generation;
+        }
+
+        runTask(threadId);
+
+        {
+            std::unique_lock<std::mutex> lock(_mutex);
+            _numberOfBusyWorkers --;
+        }
+        _taskDone.notify_one();
+    }
+}
@@ -0,0 +1,88 @@
+/***********************************************************************
+ * Copyright (c) 2014 Energy Adaptive Networks Corp. All rights reserved.
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License v2 or Energy Adaptive Networks
+ * Commercial License, which accompanies this distribution.
+ * Any use, reproduction or distribution of the program constitutes the
+ * recipient’s acceptance of this agreement.
+ * http://www.eclipse.org/legal/epl-v20.html
+ *
+ * Contributors:
+ *    Energy Adaptive Networks Corp. - dev API
+ *    Lingwen Gan - initial flow implementation
+ *    Peter Enescu - initial implementation, test, docs
+ *
+ * Project OpenOPFV - Optimal Power Flow Visualizer – 7/20/2019
+ * Module ThreadPool.h
+ *
+ ***********************************************************************/
+
+#ifndef __OptimalPowerFlowVisualization__ThreadPool__
+#define __OptimalPowerFlowVisualization__ThreadPool__
+
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include "BasicDataType.h"
+
+class ThreadPool {
+public:
+    /******************************
+     worker description
+     ******************************/
+    int _numberOfThreads;                           // including the calling thread
+    vector<std::thread> _workers;                   // threads other than the calling thread
+
+
+    /******************************
+     task description
+     ******************************/
+    const std::function<void(int, int)> *_task;     // task of the running parallelFor
+    std::atomic<int> _nextIndex;                    // next index to be taken by a thread
+    int _endIndex;                                  // one past the last index
+    int _generation;                                // number of parallelFor calls so far
+    int _numberOfBusyWorkers;                       // workers still running the task
+    bool _stop;                                     // true when workers should quit
+    std::mutex _mutex;
+    std::condition_variable _taskReady;
+    std::condition_variable _taskDone;
+
+
+public:
+    /******************************
+     basic functions
+     ******************************/
+
+    // constructor
+    // numberOfThreads <= 1 runs every task on the calling thread
+    ThreadPool(int numberOfThreads = 1);
+
+    // deconstructor
+    ~ThreadPool();
+
+
+    /******************************
+     task execution
+     ******************************/
+
+    // call task(index, threadId) for every index in [beginIndex, endIndex)
+    // threadId is in [0, numberOfThreads), and no two concurrent calls share a threadId
+    // returns when all indices are done
+    void parallelFor(int beginIndex, int endIndex, const std::function<void(int, int)> &task);
+
+
+private:
+    // take indices from _nextIndex until none is left
+    void runTask(int threadId);
+
+    // loop of each worker thread
+    void workerLoop(int threadId);
+
+    // not copyable
+    ThreadPool(const ThreadPool &pool);
+    void operator=(const ThreadPool &pool);
+};
+
+#endif /* defined(__OptimalPowerFlowVisualization__ThreadPool__) */
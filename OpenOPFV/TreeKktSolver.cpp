@@ -0,0 +1,392 @@
+/***********************************************************************
+ * Copyright (c) 2014 Energy Adaptive Networks Corp. All rights reserved.
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License v2 or Energy Adaptive Networks
+ * Commercial License, which accompanies this distribution.
+ * Any use, reproduction or distribution of the program constitutes the
+ * recipient’s acceptance of this agreement.
+ * http://www.eclipse.org/legal/epl-v20.html
+ *
+ * Contributors:
+ *    Energy Adaptive Networks Corp. - dev API
+ *    Lingwen Gan - initial flow implementation
+ *    Peter Enescu - initial implementation, test, docs
+ *
+ * Project OpenOPFV - Optimal Power Flow Visualizer – 7/20/2019
+ * Module TreeKktSolver.cpp
+ *
+ ***********************************************************************/
+
+#include <algorithm>
+#include "TreeKktSolver.h"
+#include "VoltageSensitivity.h"
+
+// solve matrix * solutions = rightHandSides by Gaussian elimination with partial pivoting
+// matrix is size x size and rightHandSides is size x numberOfColumns, both row major and overwritten
+// return false if the matrix is singular
+static bool solveLinearSystems(vector<double> &matrix, int size, vector<double> &rightHandSides, int numberOfColumns) {
+    for (int pivotId = 0; pivotId < size; pivotId ++) {
+        // pick the largest pivot
+        int bestRow = pivotId;
+        for (int row = pivotId + 1; row < size; row ++) {
+            if (fabs(matrix[row * size + pivotId]) > fabs(matrix[bestRow * size + pivotId]))
+                bestRow = row;
+        }
+        if (fabs(matrix[bestRow * size + pivotId]) < 1e-300)
+            return false;
+        if (bestRow != pivotId) {
+            for (int col = 0; col < size; col ++)
+                std::swap(matrix[bestRow * size + col], matrix[pivotId * size + col]);
+            for (int col = 0; col < numberOfColumns; col ++)
+                std::swap(rightHandSides[bestRow * numberOfColumns + col], rightHandSides[pivotId * numberOfColumns + col]);
+        }
+
+        // eliminate below the pivot
+        double pivot = matrix[pivotId * size + pivotId];
+        for (int row = pivotId + 1; row < size; row ++) {
+            double factor = matrix[row * size + pivotId] / pivot;
+            if (factor == 0.0)
+                continue;
+            for (int col = pivotId; col < size; col ++)
+                matrix[row * size + col] -= factor * matrix[pivotId * size + col];
+            for (int col = 0; col < numberOfColumns; col ++)
+                rightHandSides[row * numberOfColumns + col] -= factor * rightHandSides[pivotId * numberOfColumns + col];
+        }
+    }
+
+    // back substitution
+    for (int row = size - 1; row >= 0; row --) {
+        for (int col = 0; col < numberOfColumns; col ++) {
+            double value = rightHandSides[row * numberOfColumns + col];
+            for (int k = row + 1; k < size; k ++)
+                value -= matrix[row * size + k] * rightHandSides[k * numberOfColumns + col];
+            rightHandSides[row * numberOfColumns + col] = value / matrix[row * size + row];
+        }
+    }
+    return true;
+}
+
+
+/******************************
+ basic functions
+ ******************************/
+
+// default constructor
+TreeKktSolver::TreeKktSolver() : _numberOfPhasesAtRoot(0) {
+}
+
+// forget the network
+void TreeKktSolver::clear() {
+    _parentIds.clear();
+    _numberOfPhasesAtRoot = 0;
+    _lineSensitivities.clear();
+    _voltageCurvatures.clear();
+    _loadCompliances.clear();
+    _loadGradients.clear();
+    _rootCurvatures.clear();
+    _flowPrices.clear();
+    _subtreeQuadratics.clear();
+    _subtreeLinears.clear();
+    _priceResponses.clear();
+    _priceOffsets.clear();
+    _voltages.clear();
+}
+
+// set up topology and line sensitivities
+void TreeKktSolver::initialize(const VoltageSensitivity &sensitivity) {
+    clear();
+    _parentIds = sensitivity._parentIds;
+    _numberOfPhasesAtRoot = sensitivity._numberOfPhasesAtRoot;
+    int numberOfBus = int( _parentIds.size() );
+    int numberOfPhases = _numberOfPhasesAtRoot;
+    int numberOfFlows = numberOfFlowComponents();
+
+    // the line into every bus, in root phases
+    _lineSensitivities.assign(numberOfBus * numberOfPhases * numberOfFlows, 0.0);
+    for (int busId = 1; busId < numberOfBus; busId ++) {
+        double *lineSensitivity = &_lineSensitivities[busId * numberOfPhases * numberOfFlows];
+        for (int observedPhaseId = 0; observedPhaseId < numberOfPhases; observedPhaseId ++) {
+            for (int injectedPhaseId = 0; injectedPhaseId < numberOfPhases; injectedPhaseId ++) {
+                complex_type value = sensitivity.lineSensitivity(busId, observedPhaseId, injectedPhaseId);
+                lineSensitivity[observedPhaseId * numberOfFlows + injectedPhaseId] = value.real();
+                lineSensitivity[observedPhaseId * numberOfFlows + numberOfPhases + injectedPhaseId] = value.imag();
+            }
+        }
+    }
+
+    int numberOfDuals = numberOfPhases + numberOfFlows;
+    int numberOfUnknowns = 2 * numberOfFlows;
+    _subtreeQuadratics.assign(numberOfBus * numberOfDuals * numberOfDuals, 0.0);
+    _subtreeLinears.assign(numberOfBus * numberOfDuals, 0.0);
+    _priceResponses.assign(numberOfBus * numberOfUnknowns * numberOfDuals, 0.0);
+    _priceOffsets.assign(numberOfBus * numberOfUnknowns, 0.0);
+    _voltages.assign(numberOfBus * numberOfPhases, 0.0);
+    _flowPrices.assign(numberOfBus * numberOfFlows, 0.0);
+    reset();
+}
+
+// zero the Newton system for a new step
+void TreeKktSolver::reset() {
+    int numberOfBus = int( _parentIds.size() );
+    _voltageCurvatures.assign(numberOfBus * _numberOfPhasesAtRoot, 0.0);
+    _loadCompliances.assign(numberOfBus * numberOfFlowComponents(), 0.0);
+    _loadGradients.assign(numberOfBus * numberOfFlowComponents(), 0.0);
+    _rootCurvatures.assign(numberOfFlowComponents(), 0.0);
+}
+
+
+/******************************
+ solve
+ ******************************/
+
+int TreeKktSolver::numberOfFlowComponents() const {
+    return 2 * _numberOfPhasesAtRoot;
+}
+
+// every subtree is summarized by V_i(u_p, lambda_p), the stationary value of its part of the Lagrangian,
+// a quadratic in z = (u_p, lambda_p), where lambda_p prices F_i at the parent
+// with y = (F_i, lambda_i) and z_i = (u_i, lambda_i) = M y + N u_p, the part of bus i is
+//      W(z_i) + lambda_p^T F_i - lambda_i^T F_i
+// where W sums the own terms and the children, so y solves G y = -(T z + M^T b_W) with
+//      G = M^T Q_W M + J,      T = [M^T Q_W N, L],      J and L couple F_i to the prices
+bool TreeKktSolver::solve() {
+    int numberOfBus = int( _parentIds.size() );
+    int numberOfPhases = _numberOfPhasesAtRoot;
+    int numberOfFlows = numberOfFlowComponents();
+    int numberOfDuals = numberOfPhases + numberOfFlows;     // size of z
+    int numberOfUnknowns = 2 * numberOfFlows;               // size of y
+    if (numberOfBus == 0)
+        return true;
+
+    // own terms of every bus: voltage curvatures, and loads stepping against their gradients and the flow price
+    std::fill(_subtreeQuadratics.begin(), _subtreeQuadratics.end(), 0.0);
+    std::fill(_subtreeLinears.begin(), _subtreeLinears.end(), 0.0);
+    for (int busId = 1; busId < numberOfBus; busId ++) {
+        double *quadratic = &_subtreeQuadratics[busId * numberOfDuals * numberOfDuals];
+        double *linear = &_subtreeLinears[busId * numberOfDuals];
+        for (int phaseId = 0; phaseId < numberOfPhases; phaseId ++)
+            quadratic[phaseId * numberOfDuals + phaseId] = _voltageCurvatures[busId * numberOfPhases + phaseId];
+        for (int flowId = 0; flowId < numberOfFlows; flowId ++) {
+            int dualId = numberOfPhases + flowId;
+            quadratic[dualId * numberOfDuals + dualId] = - _loadCompliances[busId * numberOfFlows + flowId];
+            linear[dualId] = - _loadGradients[busId * numberOfFlows + flowId];
+        }
+    }
+
+    // eliminate from the leaves, children come after their parents in breadth first search order
+    vector<double> embedding(numberOfDuals * numberOfUnknowns);             // M
+    vector<double> embeddedQuadratic(numberOfDuals * numberOfUnknowns);     // Q_W M
+    vector<double> system(numberOfUnknowns * numberOfUnknowns);             // G
+    vector<double> rightHandSides(numberOfUnknowns * (numberOfDuals + 1));  // [T, M^T b_W]
+    for (int busId = numberOfBus - 1; busId > 0; busId --) {
+        const double *lineSensitivity = &_lineSensitivities[busId * numberOfPhases * numberOfFlows];
+        const double *quadratic = &_subtreeQuadratics[busId * numberOfDuals * numberOfDuals];
+        const double *linear = &_subtreeLinears[busId * numberOfDuals];
+
+        // M maps (F_i, lambda_i) to (u_i - u_p, lambda_i)
+        std::fill(embedding.begin(), embedding.end(), 0.0);
+        for (int phaseId = 0; phaseId < numberOfPhases; phaseId ++) {
+            for (int flowId = 0; flowId < numberOfFlows; flowId ++)
+                embedding[phaseId * numberOfUnknowns + flowId] = - lineSensitivity[phaseId * numberOfFlows + flowId];
+        }
+        for (int flowId = 0; flowId < numberOfFlows; flowId ++)
+            embedding[(numberOfPhases + flowId) * numberOfUnknowns + numberOfFlows + flowId] = 1.0;
+
+        // G = M^T Q_W M + J
+        for (int row = 0; row < numberOfDuals; row ++) {
+            for (int col = 0; col < numberOfUnknowns; col ++) {
+                double value = 0.0;
+                for (int k = 0; k < numberOfDuals; k ++)
+                    value += quadratic[row * numberOfDuals + k] * embedding[k * numberOfUnknowns + col];
+                embeddedQuadratic[row * numberOfUnknowns + col] = value;
+            }
+        }
+        for (int row = 0; row < numberOfUnknowns; row ++) {
+            for (int col = 0; col < numberOfUnknowns; col ++) {
+                double value = 0.0;
+                for (int k = 0; k < numberOfDuals; k ++)
+                    value += embedding[k * numberOfUnknowns + row] * embeddedQuadratic[k * numberOfUnknowns + col];
+                system[row * numberOfUnknowns + col] = value;
+            }
+        }
+        for (int flowId = 0; flowId < numberOfFlows; flowId ++) {
+            system[flowId * numberOfUnknowns + numberOfFlows + flowId] -= 1.0;
+            system[(numberOfFlows + flowId) * numberOfUnknowns + flowId] -= 1.0;
+        }
+
+        // T = [M^T Q_W N, L] and M^T b_W, where N picks u_p and L picks lambda_p
+        int numberOfColumns = numberOfDuals + 1;
+        std::fill(rightHandSides.begin(), rightHandSides.end(), 0.0);
+        for (int row = 0; row < numberOfUnknowns; row ++) {
+            for (int phaseId = 0; phaseId < numberOfPhases; phaseId ++)
+                rightHandSides[row * numberOfColumns + phaseId] = embeddedQuadratic[phaseId * numberOfUnknowns + row];
+            double value = 0.0;
+            for (int k = 0; k < numberOfDuals; k ++)
+                value += embedding[k * numberOfUnknowns + row] * linear[k];
+            rightHandSides[row * numberOfColumns + numberOfDuals] = value;
+        }
+        for (int flowId = 0; flowId < numberOfFlows; flowId ++)
+            rightHandSides[flowId * numberOfColumns + numberOfPhases + flowId] = 1.0;
+        vector<double> responses(rightHandSides);
+
+        if ( ! solveLinearSystems(system, numberOfUnknowns, responses, numberOfColumns) )
+            return false;
+        double *priceResponse = &_priceResponses[busId * numberOfUnknowns * numberOfDuals];
+        double *priceOffset = &_priceOffsets[busId * numberOfUnknowns];
+        for (int row = 0; row < numberOfUnknowns; row ++) {
+            for (int col = 0; col < numberOfDuals; col ++)
+                priceResponse[row * numberOfDuals + col] = responses[row * numberOfColumns + col];
+            priceOffset[row] = responses[row * numberOfColumns + numberOfDuals];
+        }
+
+        // V_i = [N^T Q_W N, 0; 0, 0] - T^T G^-1 T in quadratic, [N^T b_W; 0] - T^T G^-1 M^T b_W in linear,
+        // added to the parent
+        double *parentQuadratic = &_subtreeQuadratics[_parentIds[busId] * numberOfDuals * numberOfDuals];
+        double *parentLinear = &_subtreeLinears[_parentIds[busId] * numberOfDuals];
+        for (int row = 0; row < numberOfPhases; row ++) {
+            for (int col = 0; col < numberOfPhases; col ++)
+                parentQuadratic[row * numberOfDuals + col] += quadratic[row * numberOfDuals + col];
+            parentLinear[row] += linear[row];
+        }
+        for (int row = 0; row < numberOfDuals; row ++) {
+            for (int col = 0; col < numberOfDuals; col ++) {
+                double value = 0.0;
+                for (int k = 0; k < numberOfUnknowns; k ++)
+                    value += rightHandSides[k * numberOfColumns + row] * priceResponse[k * numberOfDuals + col];
+                parentQuadratic[row * numberOfDuals + col] -= value;
+            }
+            double value = 0.0;
+            for (int k = 0; k < numberOfUnknowns; k ++)
+                value += rightHandSides[k * numberOfColumns + row] * priceOffset[k];
+            parentLinear[row] -= value;
+        }
+    }
+
+    // at the substation u_0 = 0, and F_0 = r o lambda_0 meets F_0 = Q_lambda lambda_0 + b_lambda
+    vector<double> rootSystem(numberOfFlows * numberOfFlows, 0.0);
+    vector<double> rootPrice(numberOfFlows, 0.0);
+    const double *rootQuadratic = &_subtreeQuadratics[0];
+    const double *rootLinear = &_subtreeLinears[0];
+    for (int row = 0; row < numberOfFlows; row ++) {
+        for (int col = 0; col < numberOfFlows; col ++)
+            rootSystem[row * numberOfFlows + col] = (row == col ? 1.0 : 0.0) - _rootCurvatures[row] * rootQuadratic[(numberOfPhases + row) * numberOfDuals + numberOfPhases + col];
+        rootPrice[row] = _rootCurvatures[row] * rootLinear[numberOfPhases + row];
+    }
+    if ( ! solveLinearSystems(rootSystem, numberOfFlows, rootPrice, 1) )
+        return false;
+    for (int flowId = 0; flowId < numberOfFlows; flowId ++)
+        _flowPrices[flowId] = rootPrice[flowId];
+    for (int phaseId = 0; phaseId < numberOfPhases; phaseId ++)
+        _voltages[phaseId] = 0.0;
+
+    // recover prices and voltages towards the leaves, y = -(T z + M^T b_W)
+    vector<double> dual(numberOfDuals);
+    vector<double> flow(numberOfFlows);
+    for (int busId = 1; busId < numberOfBus; busId ++) {
+        int parentId = _parentIds[busId];
+        for (int phaseId = 0; phaseId < numberOfPhases; phaseId ++)
+            dual[phaseId] = _voltages[parentId * numberOfPhases + phaseId];
+        for (int flowId = 0; flowId < numberOfFlows; flowId ++)
+            dual[numberOfPhases + flowId] = _flowPrices[parentId * numberOfFlows + flowId];
+        const double *priceResponse = &_priceResponses[busId * numberOfUnknowns * numberOfDuals];
+        const double *priceOffset = &_priceOffsets[busId * numberOfUnknowns];
+        const double *lineSensitivity = &_lineSensitivities[busId * numberOfPhases * numberOfFlows];
+        for (int row = 0; row < numberOfUnknowns; row ++) {
+            double value = priceOffset[row];
+            for (int col = 0; col < numberOfDuals; col ++)
+                value += priceResponse[row * numberOfDuals + col] * dual[col];
+            if (row >= numberOfFlows)
+                _flowPrices[busId * numberOfFlows + row - numberOfFlows] = - value;
+            else
+                flow[row] = - value;
+        }
+        for (int phaseId = 0; phaseId < numberOfPhases; phaseId ++) {
+            double value = dual[phaseId];
+            for (int flowId = 0; flowId < numberOfFlows; flowId ++)
+                value -= lineSensitivity[phaseId * numberOfFlows + flowId] * flow[flowId];
+            _voltages[busId * numberOfPhases + phaseId] = value;
+        }
+    }
+    return true;
+}
+
+// the KKT system of the Newton step in all unknowns, per bus i the block (F_i, lambda_i, u_i, nu_i),
+// where nu_i prices u_i = u_parent - C_i F_i and every free component j steps by d_j = -(g_j + lambda_i[c(j)]) / delta
+//      F_i:        - lambda_i + lambda_parent + C_i^T nu_i = 0,       at the substation r o F_0 - lambda_0 = 0
+//      lambda_i:   - F_i + sum of F_c over children c - compliance o lambda_i = load gradient
+//      u_i:        h_i o u_i + nu_i - sum of nu_c over children c = 0,    at the substation u_0 = 0
+//      nu_i:       u_i - u_parent + C_i F_i = 0,                       at the substation nu_0 = 0
+double TreeKktSolver::denseSolveError() const {
+    int numberOfBus = int( _parentIds.size() );
+    int numberOfPhases = _numberOfPhasesAtRoot;
+    int numberOfFlows = numberOfFlowComponents();
+    int blockSize = 2 * numberOfFlows + 2 * numberOfPhases;
+    int size = numberOfBus * blockSize;
+    if (numberOfBus == 0)
+        return 0.0;
+    
+    // offsets of the unknowns, and of their rows, in the block of a bus
+    int flowOffset = 0;
+    int priceOffset = numberOfFlows;
+    int voltageOffset = 2 * numberOfFlows;
+    int multiplierOffset = 2 * numberOfFlows + numberOfPhases;
+    
+    vector<double> matrix(size * size, 0.0);
+    vector<double> rightHandSides(size, 0.0);
+    for (int busId = 0; busId < numberOfBus; busId ++) {
+        int base = busId * blockSize;
+        int parentBase = _parentIds[busId] * blockSize;
+        const double *lineSensitivity = &_lineSensitivities[busId * numberOfPhases * numberOfFlows];
+        for (int flowId = 0; flowId < numberOfFlows; flowId ++) {
+            int row = base + flowOffset + flowId;
+            matrix[row * size + base + priceOffset + flowId] = -1.0;
+            if (busId == 0)
+                matrix[row * size + base + flowOffset + flowId] = _rootCurvatures[flowId];
+            else {
+                matrix[row * size + parentBase + priceOffset + flowId] = 1.0;
+                for (int phaseId = 0; phaseId < numberOfPhases; phaseId ++)
+                    matrix[row * size + base + multiplierOffset + phaseId] = lineSensitivity[phaseId * numberOfFlows + flowId];
+            }
+            
+            row = base + priceOffset + flowId;
+            matrix[row * size + base + flowOffset + flowId] = -1.0;
+            matrix[row * size + base + priceOffset + flowId] = - _loadCompliances[busId * numberOfFlows + flowId];
+            rightHandSides[row] = _loadGradients[busId * numberOfFlows + flowId];
+            if (busId > 0)
+                matrix[(parentBase + priceOffset + flowId) * size + base + flowOffset + flowId] = 1.0;
+        }
+        for (int phaseId = 0; phaseId < numberOfPhases; phaseId ++) {
+            int row = base + voltageOffset + phaseId;
+            if (busId == 0) {
+                matrix[row * size + base + voltageOffset + phaseId] = 1.0;
+                row = base + multiplierOffset + phaseId;
+                matrix[row * size + base + multiplierOffset + phaseId] = 1.0;
+                continue;
+            }
+            matrix[row * size + base + voltageOffset + phaseId] = _voltageCurvatures[busId * numberOfPhases + phaseId];
+            matrix[row * size + base + multiplierOffset + phaseId] = 1.0;
+            if (_parentIds[busId] > 0)
+                matrix[(parentBase + voltageOffset + phaseId) * size + base + multiplierOffset + phaseId] = -1.0;
+            
+            row = base + multiplierOffset + phaseId;
+            matrix[row * size + base + voltageOffset + phaseId] = 1.0;
+            matrix[row * size + parentBase + voltageOffset + phaseId] = -1.0;
+            for (int flowId = 0; flowId < numberOfFlows; flowId ++)
+                matrix[row * size + base + flowOffset + flowId] = lineSensitivity[phaseId * numberOfFlows + flowId];
+        }
+    }
+    if ( ! solveLinearSystems(matrix, size, rightHandSides, 1) )
+        return -1.0;
+    
+    // largest difference of flow prices, relative to the largest price
+    double error = 0.0;
+    double scale = 0.0;
+    for (int busId = 0; busId < numberOfBus; busId ++) {
+        for (int flowId = 0; flowId < numberOfFlows; flowId ++) {
+            double price = rightHandSides[busId * blockSize + priceOffset + flowId];
+            error = std::max(error, fabs(price - _flowPrices[busId * numberOfFlows + flowId]));
+            scale = std::max(scale, fabs(price));
+        }
+    }
+    return scale > 0.0 ? error / scale : error;
+}
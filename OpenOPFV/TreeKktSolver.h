@@ -0,0 +1,108 @@
+/***********************************************************************
+ * Copyright (c) 2014 Energy Adaptive Networks Corp. All rights reserved.
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License v2 or Energy Adaptive Networks
+ * Commercial License, which accompanies this distribution.
+ * Any use, reproduction or distribution of the program constitutes the
+ * recipient’s acceptance of this agreement.
+ * http://www.eclipse.org/legal/epl-v20.html
+ *
+ * Contributors:
+ *    Energy Adaptive Networks Corp. - dev API
+ *    Lingwen Gan - initial flow implementation
+ *    Peter Enescu - initial implementation, test, docs
+ *
+ * Project OpenOPFV - Optimal Power Flow Visualizer – 7/20/2019
+ * Module TreeKktSolver.h
+ *
+ ***********************************************************************/
+
+#ifndef __OptimalPowerFlowVisualization__TreeKktSolver__
+#define __OptimalPowerFlowVisualization__TreeKktSolver__
+
+#include "DataType.h"
+
+class VoltageSensitivity;
+
+// Newton system of the barrier problem on a radial network, solved in time linear in the number of buses
+// the step d of the controllable load components minimizes the quadratic model
+//      1/2 delta |d|^2 + g^T d + 1/2 sum_i u_i^T diag(h_i) u_i + 1/2 F_0^T diag(r) F_0
+// subject to the linearized branch flow model in root phases
+//      F_i = A_i d_i + sum of F_c over children c of i,    u_i = u_parent - C_i F_i,    u_0 = 0
+// where F_i is the change of real and reactive power flowing into bus i, u_i the change of voltage magnitudes,
+// and C_i the voltage sensitivities of the line into bus i
+// the KKT system is eliminated from the leaves to the substation, where every subtree is summarized by a quadratic
+// function of the voltage of its parent and the price of flow at its parent, then prices are recovered from the
+// substation to the leaves, and every free component j at bus i steps by -(g_j + lambda_i[c(j)]) / delta
+class TreeKktSolver {
+public:
+    /******************************
+     network description
+     ******************************/
+    vector<int> _parentIds;                         // parent bus index in breadth first search order, -1 at the substation
+    int _numberOfPhasesAtRoot;
+    vector<double> _lineSensitivities;              // C_i, numberOfPhasesAtRoot x 2 numberOfPhasesAtRoot per bus, row major
+
+
+    /******************************
+     Newton system, set before solve
+     ******************************/
+    vector<double> _voltageCurvatures;              // h_i, per bus and root phase
+    vector<double> _loadCompliances;                // sum of 1 / delta over free components, per bus and flow component
+    vector<double> _loadGradients;                  // sum of g_j / delta over free components, per bus and flow component
+    vector<double> _rootCurvatures;                 // r, per flow component at the substation
+
+
+    /******************************
+     solution
+     ******************************/
+    vector<double> _flowPrices;                     // lambda_i, per bus and flow component
+
+
+private:
+    /******************************
+     elimination data
+     ******************************/
+    vector<double> _subtreeQuadratics;              // quadratic of every subtree in (voltage, flow price) of the bus
+    vector<double> _subtreeLinears;                 // linear part of the above
+    vector<double> _priceResponses;                 // solution of the bus system, per unit of parent voltage and price
+    vector<double> _priceOffsets;                   // solution of the bus system at zero parent voltage and price
+    vector<double> _voltages;                       // u_i, recovered with the prices
+
+
+public:
+    /******************************
+     basic functions
+     ******************************/
+
+    // default constructor
+    TreeKktSolver();
+
+    // forget the network
+    void clear();
+
+    // set up topology and line sensitivities
+    // flow components are ordered as real power of the root phases, then reactive power of the root phases
+    void initialize(const VoltageSensitivity &sensitivity);
+
+    // zero the Newton system for a new step
+    void reset();
+
+
+    /******************************
+     solve
+     ******************************/
+
+    // number of flow components per bus
+    int numberOfFlowComponents() const;
+
+    // eliminate the KKT system and recover _flowPrices
+    // return false if the system is singular
+    bool solve();
+    
+    // solve the same KKT system densely, in time cubic in the number of buses, as a reference for small networks
+    // return the largest difference from _flowPrices of solve(), relative to the largest price, negative if singular
+    double denseSolveError() const;
+};
+
+#endif /* defined(__OptimalPowerFlowVisualization__TreeKktSolver__) */
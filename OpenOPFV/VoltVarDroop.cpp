@@ -0,0 +1,139 @@
+/***********************************************************************
+ * Copyright (c) 2014 Energy Adaptive Networks Corp. All rights reserved.
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License v2 or Energy Adaptive Networks
+ * Commercial License, which accompanies this distribution.
+ * Any use, reproduction or distribution of the program constitutes the
+ * recipient’s acceptance of this agreement.
+ * http://www.eclipse.org/legal/epl-v20.html
+ *
+ * Contributors:
+ *    Energy Adaptive Networks Corp. - dev API
+ *    Lingwen Gan - initial flow implementation
+ *    Peter Enescu - initial implementation, test, docs
+ *
+ * Project OpenOPFV - Optimal Power Flow Visualizer – 7/20/2019
+ * Module VoltVarDroop.cpp
+ *
+ ***********************************************************************/
+
+#include <algorithm>
+#include "VoltVarDroop.h"
+#include "PhotoVoltaicController.h"
+#include "BusController.h"
+#include "Bus.h"
+
+/******************************
+ basic functions
+ ******************************/
+
+// default constructor
+VoltVarDroop::VoltVarDroop() {
+    _forgettingFactor = 0.9;
+    _maxSlope = 20.0;
+    _numberOfSamples = 0;
+}
+
+// forget the PV and the fits
+void VoltVarDroop::clear() {
+    _devices.clear();
+    _phaseIds.clear();
+    _offsets.clear();
+    _slopes.clear();
+    _numberOfSamples = 0;
+    _sumWeights.clear();
+    _sumVoltages.clear();
+    _sumReactivePowers.clear();
+    _sumVoltageSquares.clear();
+    _sumProducts.clear();
+    _voltages.clear();
+    _capacities.clear();
+    _reactivePowers.clear();
+}
+
+// one entry per phase of every PV
+void VoltVarDroop::initialize(const vector<PhotoVoltaicController *> &devices) {
+    clear();
+    for (int deviceId = 0; deviceId < devices.size(); deviceId ++) {
+        for (int phaseId = 0; phaseId < devices[deviceId]->_phaseIndicesInLocationBus.size(); phaseId ++) {
+            _devices.push_back(devices[deviceId]);
+            _phaseIds.push_back(phaseId);
+        }
+    }
+    int numberOfEntries = int( _devices.size() );
+    _offsets.assign(numberOfEntries, 0.0);
+    _slopes.assign(numberOfEntries, 0.0);
+    _sumWeights.assign(numberOfEntries, 0.0);
+    _sumVoltages.assign(numberOfEntries, 0.0);
+    _sumReactivePowers.assign(numberOfEntries, 0.0);
+    _sumVoltageSquares.assign(numberOfEntries, 0.0);
+    _sumProducts.assign(numberOfEntries, 0.0);
+    _voltages.assign(numberOfEntries, 0.0);
+    _capacities.assign(numberOfEntries, 0.0);
+    _reactivePowers.assign(numberOfEntries, 0.0);
+}
+
+
+/******************************
+ fit and apply
+ ******************************/
+
+// add a sample and refit
+void VoltVarDroop::addSample() {
+    _numberOfSamples ++;
+    for (int entryId = 0; entryId < _devices.size(); entryId ++) {
+        PhotoVoltaicController *device = _devices[entryId];
+        int phaseId = _phaseIds[entryId];
+        double voltage = std::abs(device->_locationBus->_voltages[0]._data[device->_phaseIndicesInLocationBus[phaseId]]) - 1.0;
+        double reactivePower = device->_valueArray[0]._power._data[phaseId].imag();
+        
+        _sumWeights[entryId] = _forgettingFactor * _sumWeights[entryId] + 1.0;
+        _sumVoltages[entryId] = _forgettingFactor * _sumVoltages[entryId] + voltage;
+        _sumReactivePowers[entryId] = _forgettingFactor * _sumReactivePowers[entryId] + reactivePower;
+        _sumVoltageSquares[entryId] = _forgettingFactor * _sumVoltageSquares[entryId] + voltage * voltage;
+        _sumProducts[entryId] = _forgettingFactor * _sumProducts[entryId] + voltage * reactivePower;
+        
+        // weighted least squares, a flat curve through the mean if the voltage hardly varied
+        double meanVoltage = _sumVoltages[entryId] / _sumWeights[entryId];
+        double meanReactivePower = _sumReactivePowers[entryId] / _sumWeights[entryId];
+        double variance = _sumVoltageSquares[entryId] / _sumWeights[entryId] - meanVoltage * meanVoltage;
+        double covariance = _sumProducts[entryId] / _sumWeights[entryId] - meanVoltage * meanReactivePower;
+        double slope = variance > 1e-10 ? covariance / variance : 0.0;
+        _slopes[entryId] = std::min(std::max(slope, 0.0), _maxSlope * device->_nameplate);
+        _offsets[entryId] = meanReactivePower - _slopes[entryId] * meanVoltage;
+    }
+}
+
+// whether there are samples to follow
+bool VoltVarDroop::fitted() const {
+    return _numberOfSamples > 0;
+}
+
+// set the reactive power of slot 0 of every PV
+void VoltVarDroop::apply() {
+    int numberOfEntries = int( _devices.size() );
+    
+    // gather measurements
+    for (int entryId = 0; entryId < numberOfEntries; entryId ++) {
+        PhotoVoltaicController *device = _devices[entryId];
+        int phaseId = _phaseIds[entryId];
+        const ColumnVector<complex_type> &voltage = device->_locationBus->_bus->voltage();
+        double realPower = device->_valueArray[0]._power._data[phaseId].real();
+        _voltages[entryId] = std::abs(voltage._data[device->_phaseIndicesInLocationBus[phaseId]]) - 1.0;
+        _capacities[entryId] = std::sqrt(device->_nameplate * device->_nameplate - realPower * realPower);
+    }
+    
+    // droop curves, projected as in PhotoVoltaicController
+    for (int entryId = 0; entryId < numberOfEntries; entryId ++) {
+        double reactivePower = _offsets[entryId] + _slopes[entryId] * _voltages[entryId];
+        if (reactivePower > _capacities[entryId])
+            reactivePower = _capacities[entryId];
+        else if (reactivePower < - _capacities[entryId])
+            reactivePower = - _capacities[entryId];
+        _reactivePowers[entryId] = reactivePower;
+    }
+    
+    // scatter set-points
+    for (int entryId = 0; entryId < numberOfEntries; entryId ++)
+        _devices[entryId]->_valueArray[0]._power._data[_phaseIds[entryId]].imag(_reactivePowers[entryId]);
+}
@@ -0,0 +1,94 @@
+/***********************************************************************
+ * Copyright (c) 2014 Energy Adaptive Networks Corp. All rights reserved.
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License v2 or Energy Adaptive Networks
+ * Commercial License, which accompanies this distribution.
+ * Any use, reproduction or distribution of the program constitutes the
+ * recipient’s acceptance of this agreement.
+ * http://www.eclipse.org/legal/epl-v20.html
+ *
+ * Contributors:
+ *    Energy Adaptive Networks Corp. - dev API
+ *    Lingwen Gan - initial flow implementation
+ *    Peter Enescu - initial implementation, test, docs
+ *
+ * Project OpenOPFV - Optimal Power Flow Visualizer – 7/20/2019
+ * Module VoltVarDroop.h
+ *
+ ***********************************************************************/
+
+#ifndef __OptimalPowerFlowVisualization__VoltVarDroop__
+#define __OptimalPowerFlowVisualization__VoltVarDroop__
+
+#include "BasicDataType.h"
+
+class PhotoVoltaicController;
+
+// Volt/VAR droop curves of PV, one per PV phase, fitted to recent fast control solutions
+// the reactive power consumption of a PV phase follows the voltage magnitude measured at its bus,
+//      Q = offset + slope * (|V| - 1),     0 <= slope <= _maxSlope * nameplate
+// within the capacity left by its real power, and the curve is the least squares fit to the set-points
+// and voltage magnitudes of past solutions, where every new solution discounts the older ones by _forgettingFactor
+// entries are kept as arrays over all PV phases, so that the policy runs in one pass of constant work per entry
+class VoltVarDroop {
+public:
+    /******************************
+     curves
+     ******************************/
+    vector<PhotoVoltaicController *> _devices;      // PV of every entry
+    vector<int> _phaseIds;                          // phase of the PV of every entry
+    vector<double> _offsets;                        // reactive power at 1.0 p.u.
+    vector<double> _slopes;                         // reactive power per p.u. of voltage above 1.0
+    
+    
+    /******************************
+     least squares fit
+     ******************************/
+    double _forgettingFactor;                       // weight of a solution after every newer one
+    double _maxSlope;                               // steepest curve fitted, in nameplates per p.u. of voltage
+    int _numberOfSamples;                           // solutions fitted to since initialize
+    vector<double> _sumWeights;                     // discounted number of solutions
+    vector<double> _sumVoltages;                    // discounted sums of |V| - 1, of Q, of (|V| - 1)^2, and of (|V| - 1) Q
+    vector<double> _sumReactivePowers;
+    vector<double> _sumVoltageSquares;
+    vector<double> _sumProducts;
+    
+    
+    /******************************
+     pass buffers
+     ******************************/
+    vector<double> _voltages;                       // measured |V| - 1 of every entry
+    vector<double> _capacities;                     // reactive power capacity of every entry
+    vector<double> _reactivePowers;                 // reactive power set by the policy
+    
+    
+public:
+    /******************************
+     basic functions
+     ******************************/
+    
+    // default constructor
+    VoltVarDroop();
+    
+    // forget the PV and the fits
+    void clear();
+    
+    // one entry per phase of every PV, with flat curves until the first fit
+    void initialize(const vector<PhotoVoltaicController *> &devices);
+    
+    
+    /******************************
+     fit and apply
+     ******************************/
+    
+    // add the reactive power of slot 0 of every PV, and the voltage magnitude under it at its bus, then refit
+    void addSample();
+    
+    // whether there are samples to follow
+    bool fitted() const;
+    
+    // set the reactive power of slot 0 of every PV from the voltage magnitude measured at its bus
+    void apply();
+};
+
+#endif /* defined(__OptimalPowerFlowVisualization__VoltVarDroop__) */
@@ -0,0 +1,265 @@
+/***********************************************************************
+ * Copyright (c) 2014 Energy Adaptive Networks Corp. All rights reserved.
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License v2 or Energy Adaptive Networks
+ * Commercial License, which accompanies this distribution.
+ * Any use, reproduction or distribution of the program constitutes the
+ * recipient’s acceptance of this agreement.
+ * http://www.eclipse.org/legal/epl-v20.html
+ *
+ * Contributors:
+ *    Energy Adaptive Networks Corp. - dev API
+ *    Lingwen Gan - initial flow implementation
+ *    Peter Enescu - initial implementation, test, docs
+ *
+ * Project OpenOPFV - Optimal Power Flow Visualizer – 7/20/2019
+ * Module VoltageSensitivity.cpp
+ *
+ ***********************************************************************/
+
+#include "VoltageSensitivity.h"
+#include "BusController.h"
+#include "LineController.h"
+#include "Bus.h"
+
+/******************************
+ basic functions
+ ******************************/
+
+// default constructor
+VoltageSensitivity::VoltageSensitivity() : _numberOfPhasesAtRoot(0) {
+}
+
+// forget the network and the cached rows
+void VoltageSensitivity::clear() {
+    _buses.clear();
+    _busIds.clear();
+    _parentIds.clear();
+    _depths.clear();
+    _phaseIndicesInRoot.clear();
+    _phaseOffsets.clear();
+    _numberOfPhasesAtRoot = 0;
+    _betaAtRoot.clear();
+    _pathImpedances.clear();
+    _lineSensitivities.clear();
+    _rowCache.clear();
+}
+
+// set up path impedances of buses sorted by breadth first search
+void VoltageSensitivity::initialize(const vector<BusController *> &buses, const vector<vector<int>> &busPhaseIndicesInRoot) {
+    clear();
+    if (buses.empty())
+        return;
+    _buses = buses;
+    _phaseIndicesInRoot = busPhaseIndicesInRoot;
+    int numberOfBus = int( _buses.size() );
+
+    // nominal phase angles at the root
+    string rootPhase = _buses[0]->_bus->phase();
+    _numberOfPhasesAtRoot = int( rootPhase.size() );
+    for (int phaseId = 0; phaseId < _numberOfPhasesAtRoot; phaseId ++) {
+        double angle = - M_PI * 2 / 3 * (rootPhase[phaseId] - 'a');
+        _betaAtRoot.push_back(complex_type(cos(angle), sin(angle)));
+    }
+
+    // topology, parents come before children in breadth first search order
+    int phaseOffset = 0;
+    for (int busId = 0; busId < numberOfBus; busId ++) {
+        BusController *bus = _buses[busId];
+        _busIds[bus] = busId;
+        _phaseOffsets.push_back(phaseOffset);
+        phaseOffset += int( _phaseIndicesInRoot[busId].size() );
+        if (busId == 0) {
+            _parentIds.push_back(-1);
+            _depths.push_back(0);
+        }
+        else {
+            int parentId = _busIds[bus->_fromLine->_fromBus];
+            _parentIds.push_back(parentId);
+            _depths.push_back(_depths[parentId] + 1);
+        }
+    }
+    _phaseOffsets.push_back(phaseOffset);
+
+    // accumulate line impedances from the substation
+    int blockSize = _numberOfPhasesAtRoot * _numberOfPhasesAtRoot;
+    _pathImpedances.assign(numberOfBus * blockSize, complex_type(0.0, 0.0));
+    for (int busId = 1; busId < numberOfBus; busId ++) {
+        complex_type *pathImpedance = &_pathImpedances[busId * blockSize];
+        const complex_type *parentPathImpedance = &_pathImpedances[_parentIds[busId] * blockSize];
+        for (int entryId = 0; entryId < blockSize; entryId ++) {
+            pathImpedance[entryId] = parentPathImpedance[entryId];
+        }
+        const SquareMatrix<complex_type> &impedance = _buses[busId]->_fromLine->_impedance;
+        const vector<int> &phaseIndicesInRoot = _phaseIndicesInRoot[busId];
+        for (int row = 0; row < phaseIndicesInRoot.size(); row ++) {
+            for (int col = 0; col < phaseIndicesInRoot.size(); col ++) {
+                pathImpedance[phaseIndicesInRoot[row] * _numberOfPhasesAtRoot + phaseIndicesInRoot[col]] += impedance._data[row][col];
+            }
+        }
+    }
+    
+    // sensitivities through every line, the difference of path sensitivities of the bus and its parent
+    _lineSensitivities.assign(numberOfBus * blockSize, complex_type(0.0, 0.0));
+    for (int busId = 1; busId < numberOfBus; busId ++) {
+        for (int observedPhaseId = 0; observedPhaseId < _numberOfPhasesAtRoot; observedPhaseId ++) {
+            for (int injectedPhaseId = 0; injectedPhaseId < _numberOfPhasesAtRoot; injectedPhaseId ++) {
+                _lineSensitivities[busId * blockSize + observedPhaseId * _numberOfPhasesAtRoot + injectedPhaseId] =
+                    sensitivity(busId, observedPhaseId, injectedPhaseId) - sensitivity(_parentIds[busId], observedPhaseId, injectedPhaseId);
+            }
+        }
+    }
+}
+
+
+/******************************
+ queries
+ ******************************/
+
+// index of bus in the network
+int VoltageSensitivity::busIndex(BusController *bus) const {
+    unordered_map<BusController *, int>::const_iterator it = _busIds.find(bus);
+    if (it == _busIds.end())
+        return -1;
+    return it->second;
+}
+
+// index of the deepest bus shared by the paths from the substation to two buses
+int VoltageSensitivity::commonAncestor(int busId1, int busId2) const {
+    while (_depths[busId1] > _depths[busId2])
+        busId1 = _parentIds[busId1];
+    while (_depths[busId2] > _depths[busId1])
+        busId2 = _parentIds[busId2];
+    while (busId1 != busId2) {
+        busId1 = _parentIds[busId1];
+        busId2 = _parentIds[busId2];
+    }
+    return busId1;
+}
+
+complex_type VoltageSensitivity::sensitivity(int ancestorId, int observedRootPhaseId, int injectedRootPhaseId) const {
+    complex_type impedance = _pathImpedances[(ancestorId * _numberOfPhasesAtRoot + observedRootPhaseId) * _numberOfPhasesAtRoot + injectedRootPhaseId];
+    return impedance * _betaAtRoot[injectedRootPhaseId] * std::conj(_betaAtRoot[observedRootPhaseId]);
+}
+
+// sensitivities of a voltage magnitude to an injection
+double VoltageSensitivity::voltageToRealPower(int observedBusId, int observedPhaseId, int injectedBusId, int injectedPhaseId) const {
+    int ancestorId = commonAncestor(observedBusId, injectedBusId);
+    return sensitivity(ancestorId,
+                       _phaseIndicesInRoot[observedBusId][observedPhaseId],
+                       _phaseIndicesInRoot[injectedBusId][injectedPhaseId]).real();
+}
+
+double VoltageSensitivity::voltageToReactivePower(int observedBusId, int observedPhaseId, int injectedBusId, int injectedPhaseId) const {
+    int ancestorId = commonAncestor(observedBusId, injectedBusId);
+    return sensitivity(ancestorId,
+                       _phaseIndicesInRoot[observedBusId][observedPhaseId],
+                       _phaseIndicesInRoot[injectedBusId][injectedPhaseId]).imag();
+}
+
+// sensitivities of all voltage magnitudes to an injection
+const SensitivityRow &VoltageSensitivity::row(int injectedBusId, int injectedPhaseId) {
+    int key = _phaseOffsets[injectedBusId] + injectedPhaseId;
+    unordered_map<int, SensitivityRow>::iterator it = _rowCache.find(key);
+    if (it != _rowCache.end())
+        return it->second;
+
+    // mark the path from the injection to the substation
+    int numberOfBus = int( _buses.size() );
+    vector<int> ancestorIds(numberOfBus, -1);
+    for (int busId = injectedBusId; busId >= 0; busId = _parentIds[busId])
+        ancestorIds[busId] = busId;
+
+    // every other bus shares the path of its parent, which comes first in breadth first search order
+    SensitivityRow &result = _rowCache[key];
+    result._toRealPower.assign(_phaseOffsets.back(), 0.0);
+    result._toReactivePower.assign(_phaseOffsets.back(), 0.0);
+    int injectedRootPhaseId = _phaseIndicesInRoot[injectedBusId][injectedPhaseId];
+    for (int busId = 0; busId < numberOfBus; busId ++) {
+        if (ancestorIds[busId] < 0)
+            ancestorIds[busId] = ancestorIds[_parentIds[busId]];
+        const vector<int> &phaseIndicesInRoot = _phaseIndicesInRoot[busId];
+        for (int phaseId = 0; phaseId < phaseIndicesInRoot.size(); phaseId ++) {
+            complex_type value = sensitivity(ancestorIds[busId], phaseIndicesInRoot[phaseId], injectedRootPhaseId);
+            result._toRealPower[_phaseOffsets[busId] + phaseId] = value.real();
+            result._toReactivePower[_phaseOffsets[busId] + phaseId] = value.imag();
+        }
+    }
+    return result;
+}
+
+// sensitivity through the line into bus, which is the difference of path impedances to bus and its parent
+complex_type VoltageSensitivity::lineSensitivity(int busId, int observedRootPhaseId, int injectedRootPhaseId) const {
+    return _lineSensitivities[(busId * _numberOfPhasesAtRoot + observedRootPhaseId) * _numberOfPhasesAtRoot + injectedRootPhaseId];
+}
+
+// changes of all voltage magnitudes due to changes of injections at every bus
+// a line carries the injections of the subtree below it, and adds their drop to the change at its parent
+void VoltageSensitivity::voltageChanges(vector<complex_type> &injections, vector<double> &voltageChanges) const {
+    int numberOfBus = int( _buses.size() );
+    int numberOfPhases = _numberOfPhasesAtRoot;
+    for (int busId = numberOfBus - 1; busId > 0; busId --) {
+        complex_type *parentInjection = &injections[_parentIds[busId] * numberOfPhases];
+        for (int phaseId = 0; phaseId < numberOfPhases; phaseId ++)
+            parentInjection[phaseId] += injections[busId * numberOfPhases + phaseId];
+    }
+    voltageChanges.assign(numberOfBus * numberOfPhases, 0.0);
+    for (int busId = 1; busId < numberOfBus; busId ++) {
+        const complex_type *lineSensitivity = &_lineSensitivities[busId * numberOfPhases * numberOfPhases];
+        const complex_type *injection = &injections[busId * numberOfPhases];
+        for (int observedPhaseId = 0; observedPhaseId < numberOfPhases; observedPhaseId ++) {
+            double change = voltageChanges[_parentIds[busId] * numberOfPhases + observedPhaseId];
+            for (int injectedPhaseId = 0; injectedPhaseId < numberOfPhases; injectedPhaseId ++) {
+                complex_type value = lineSensitivity[observedPhaseId * numberOfPhases + injectedPhaseId];
+                change += value.real() * injection[injectedPhaseId].real() + value.imag() * injection[injectedPhaseId].imag();
+            }
+            voltageChanges[busId * numberOfPhases + observedPhaseId] = change;
+        }
+    }
+}
+
+// prices of injections for weights on the voltage magnitudes
+// a line prices the injections below it by the weights of the subtree below it, on top of the price at its parent
+void VoltageSensitivity::injectionPrices(vector<double> &voltageWeights, vector<complex_type> &injectionPrices) const {
+    int numberOfBus = int( _buses.size() );
+    int numberOfPhases = _numberOfPhasesAtRoot;
+    for (int busId = numberOfBus - 1; busId > 0; busId --) {
+        double *parentWeight = &voltageWeights[_parentIds[busId] * numberOfPhases];
+        for (int phaseId = 0; phaseId < numberOfPhases; phaseId ++)
+            parentWeight[phaseId] += voltageWeights[busId * numberOfPhases + phaseId];
+    }
+    injectionPrices.assign(numberOfBus * numberOfPhases, complex_type(0.0, 0.0));
+    for (int busId = 1; busId < numberOfBus; busId ++) {
+        const complex_type *lineSensitivity = &_lineSensitivities[busId * numberOfPhases * numberOfPhases];
+        const double *weight = &voltageWeights[busId * numberOfPhases];
+        for (int injectedPhaseId = 0; injectedPhaseId < numberOfPhases; injectedPhaseId ++) {
+            complex_type price = injectionPrices[_parentIds[busId] * numberOfPhases + injectedPhaseId];
+            for (int observedPhaseId = 0; observedPhaseId < numberOfPhases; observedPhaseId ++)
+                price += lineSensitivity[observedPhaseId * numberOfPhases + injectedPhaseId] * weight[observedPhaseId];
+            injectionPrices[busId * numberOfPhases + injectedPhaseId] = price;
+        }
+    }
+}
+
+// additional real power that can be injected before some voltage reaches its upper bound
+double VoltageSensitivity::realPowerHostingCapacityAtTime(int busId, int phaseId, int timeSlotId) {
+    const SensitivityRow &sensitivities = row(busId, phaseId);
+    double capacity = -1.0;
+    for (int observedBusId = 0; observedBusId < _buses.size(); observedBusId ++) {
+        BusController *bus = _buses[observedBusId];
+        if (! bus->_hasVoltageConstraint)
+            continue;
+        for (int observedPhaseId = 0; observedPhaseId < _phaseIndicesInRoot[observedBusId].size(); observedPhaseId ++) {
+            double sensitivity = sensitivities._toRealPower[_phaseOffsets[observedBusId] + observedPhaseId];
+            if (sensitivity <= 0.0)
+                continue;
+            double voltageMagnitude = std::sqrt( std::norm( bus->_voltages[timeSlotId]._data[observedPhaseId] ) );
+            if (voltageMagnitude >= bus->_voltageMax)
+                return 0.0;
+            double thisCapacity = (bus->_voltageMax - voltageMagnitude) / sensitivity;
+            if (capacity < 0.0 || thisCapacity < capacity)
+                capacity = thisCapacity;
+        }
+    }
+    return capacity;
+}
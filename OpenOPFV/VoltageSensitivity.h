@@ -0,0 +1,124 @@
+/***********************************************************************
+ * Copyright (c) 2014 Energy Adaptive Networks Corp. All rights reserved.
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License v2 or Energy Adaptive Networks
+ * Commercial License, which accompanies this distribution.
+ * Any use, reproduction or distribution of the program constitutes the
+ * recipient’s acceptance of this agreement.
+ * http://www.eclipse.org/legal/epl-v20.html
+ *
+ * Contributors:
+ *    Energy Adaptive Networks Corp. - dev API
+ *    Lingwen Gan - initial flow implementation
+ *    Peter Enescu - initial implementation, test, docs
+ *
+ * Project OpenOPFV - Optimal Power Flow Visualizer – 7/20/2019
+ * Module VoltageSensitivity.h
+ *
+ ***********************************************************************/
+
+#ifndef __OptimalPowerFlowVisualization__VoltageSensitivity__
+#define __OptimalPowerFlowVisualization__VoltageSensitivity__
+
+#include "DataType.h"
+
+class BusController;
+
+// sensitivities of all voltage magnitudes to one injection
+// entries are indexed by phase offset of the observed bus plus phase index at that bus
+struct SensitivityRow {
+    vector<double> _toRealPower;        // d|V| / dP
+    vector<double> _toReactivePower;    // d|V| / dQ
+};
+
+// linearized voltage sensitivities of a radial network
+// voltages are linearized around the flat profile 1.0 p.u. with balanced phase angles, as in the gradient,
+// so the change of |V| at bus i, phase x, due to injection P + jQ at bus k, phase y is
+//      Re(Z * beta_y * conj(beta_x)) * P + Im(Z * beta_y * conj(beta_x)) * Q
+// where Z is entry (x, y) of the impedance shared by the paths from the substation to i and k
+// injections are power flowing into the network, i.e. minus the load consumption
+class VoltageSensitivity {
+public:
+    /******************************
+     network description
+     ******************************/
+    vector<BusController *> _buses;                 // buses sorted by breadth first search
+    unordered_map<BusController *, int> _busIds;    // position of buses in _buses
+    vector<int> _parentIds;                         // parent bus index, -1 at the substation
+    vector<int> _depths;                            // number of lines to the substation
+    vector<vector<int>> _phaseIndicesInRoot;        // position of bus phases at the root
+    vector<int> _phaseOffsets;                      // position of the first bus phase in a SensitivityRow
+    int _numberOfPhasesAtRoot;
+    vector<complex_type> _betaAtRoot;               // nominal phase angles at the root
+
+
+    /******************************
+     sensitivity data
+     ******************************/
+    vector<complex_type> _pathImpedances;           // impedance from the substation to every bus, in root phases
+    vector<complex_type> _lineSensitivities;        // lineSensitivity of every bus, in root phases
+    unordered_map<int, SensitivityRow> _rowCache;   // rows computed so far, keyed by phase offset of the injection
+
+
+public:
+    /******************************
+     basic functions
+     ******************************/
+
+    // default constructor
+    VoltageSensitivity();
+
+    // forget the network and the cached rows
+    void clear();
+
+    // set up path impedances of buses sorted by breadth first search
+    // cost is linear in the number of buses
+    void initialize(const vector<BusController *> &buses, const vector<vector<int>> &busPhaseIndicesInRoot);
+
+
+    /******************************
+     queries
+     ******************************/
+
+    // index of bus in the network, -1 if not found
+    int busIndex(BusController *bus) const;
+
+    // index of the deepest bus shared by the paths from the substation to two buses
+    // cost is linear in the depth of the buses
+    int commonAncestor(int busId1, int busId2) const;
+
+    // sensitivities of |V| at (observedBusId, observedPhaseId) to injection at (injectedBusId, injectedPhaseId)
+    // phase indices are local to the buses, cost is linear in the depth of the buses
+    double voltageToRealPower(int observedBusId, int observedPhaseId, int injectedBusId, int injectedPhaseId) const;
+    double voltageToReactivePower(int observedBusId, int observedPhaseId, int injectedBusId, int injectedPhaseId) const;
+
+    // sensitivities of all voltage magnitudes to injection at (injectedBusId, injectedPhaseId)
+    // computed in linear time on first request, then served from the cache
+    const SensitivityRow &row(int injectedBusId, int injectedPhaseId);
+
+    // complex sensitivity of voltage root phase x to injection root phase y through the line into busId alone,
+    // real part to real power and imaginary part to reactive power, 0 at the substation
+    complex_type lineSensitivity(int busId, int observedRootPhaseId, int injectedRootPhaseId) const;
+
+    // additional real power that can be injected at (busId, phaseId) before some voltage reaches its upper bound,
+    // starting from the voltages at timeSlotId
+    // returns 0 if a voltage is already above its bound, and a negative number if no voltage rises
+    double realPowerHostingCapacityAtTime(int busId, int phaseId, int timeSlotId);
+    
+    // changes of all voltage magnitudes due to changes of injections at every bus,
+    // both indexed by bus times numberOfPhasesAtRoot plus root phase, in a pass from the leaves and one from the substation
+    // injections is overwritten by the injections summed over the subtree of every bus
+    void voltageChanges(vector<complex_type> &injections, vector<double> &voltageChanges) const;
+    
+    // prices of injections at every bus for weights on the voltage magnitudes, the transpose of voltageChanges,
+    // where real parts price real power and imaginary parts reactive power
+    // voltageWeights is overwritten by the weights summed over the subtree of every bus
+    void injectionPrices(vector<double> &voltageWeights, vector<complex_type> &injectionPrices) const;
+
+
+private:
+    // complex sensitivity of voltage phase x to injection phase y through the impedance shared up to ancestorId
+    complex_type sensitivity(int ancestorId, int observedRootPhaseId, int injectedRootPhaseId) const;
+};
+
+#endif /* defined(__OptimalPowerFlowVisualization__VoltageSensitivity__) */
@@ -0,0 +1,122 @@
+/***********************************************************************
+ * Copyright (c) 2014 Energy Adaptive Networks Corp. All rights reserved.
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License v2 or Energy Adaptive Networks
+ * Commercial License, which accompanies this distribution.
+ * Any use, reproduction or distribution of the program constitutes the
+ * recipient’s acceptance of this agreement.
+ * http://www.eclipse.org/legal/epl-v20.html
+ *
+ * Contributors:
+ *    Energy Adaptive Networks Corp. - dev API
+ *    Lingwen Gan - initial flow implementation
+ *    Peter Enescu - initial implementation, test, docs
+ *
+ * Project OpenOPFV - Optimal Power Flow Visualizer – 7/20/2019
+ * Module VoltageViolationCollector.cpp
+ *
+ ***********************************************************************/
+
+#include <algorithm>
+#include "VoltageViolationCollector.h"
+#include "BusController.h"
+#include "Bus.h"
+
+// order violations by severity, used as a min-heap on violation size
+static bool moreSevere(const VoltageViolation &violation1, const VoltageViolation &violation2) {
+    return violation1._violationSize > violation2._violationSize;
+}
+
+
+/******************************
+ basic functions
+ ******************************/
+
+// default constructor
+VoltageViolationCollector::VoltageViolationCollector(int capacity) :
+_numberOfRecords(0),
+_sink(NULL) {
+    setCapacity(capacity);
+}
+
+// set the number of violations kept, and allocate the buffer
+void VoltageViolationCollector::setCapacity(int capacity) {
+    _capacity = capacity < 0 ? 0 : capacity;
+    _violations.clear();
+    _violations.reserve(_capacity);
+    _numberOfRecords = 0;
+}
+
+// set the stream that recorded violations are printed to
+void VoltageViolationCollector::setSink(ostream *sink) {
+    _sink = sink;
+}
+
+// forget recorded violations, keeping the buffer
+void VoltageViolationCollector::clear() {
+    _violations.clear();
+    _numberOfRecords = 0;
+}
+
+
+/******************************
+ record and query
+ ******************************/
+
+void VoltageViolationCollector::record(const BusController *bus, int phaseId, int timeSlotId,
+                                       double voltageMagnitude, double voltageMin, double voltageMax) {
+    VoltageViolation violation;
+    violation._bus = bus;
+    violation._phaseId = phaseId;
+    violation._timeSlotId = timeSlotId;
+    violation._voltageMagnitude = voltageMagnitude;
+    violation._violationSize = voltageMagnitude < voltageMin ? voltageMin - voltageMagnitude : voltageMagnitude - voltageMax;
+
+    _numberOfRecords ++;
+    if (_sink != NULL)
+        print(*_sink, violation);
+
+    // keep the most severe violations
+    if (_violations.size() < _capacity) {
+        _violations.push_back(violation);
+        std::push_heap(_violations.begin(), _violations.end(), moreSevere);
+    }
+    else if (_capacity > 0 && moreSevere(violation, _violations.front())) {
+        std::pop_heap(_violations.begin(), _violations.end(), moreSevere);
+        _violations.back() = violation;
+        std::push_heap(_violations.begin(), _violations.end(), moreSevere);
+    }
+}
+
+bool VoltageViolationCollector::empty() const {
+    return _numberOfRecords == 0;
+}
+
+int VoltageViolationCollector::numberOfRecords() const {
+    return _numberOfRecords;
+}
+
+void VoltageViolationCollector::worstViolations(int k, vector<VoltageViolation> &result) const {
+    if (k > _violations.size())
+        k = int( _violations.size() );
+    if (k < 0)
+        k = 0;
+    result.resize(k);
+    std::partial_sort_copy(_violations.begin(), _violations.end(), result.begin(), result.end(), moreSevere);
+}
+
+void VoltageViolationCollector::print(ostream &cout, const VoltageViolation &violation) {
+    Bus *bus = violation._bus->_bus;
+    cout << "bus " << bus->name() << " (" << bus->phase()[violation._phaseId] << ")\n";
+    cout << "\tvoltage = " << violation._voltageMagnitude << " at time slot with index " << violation._timeSlotId << '\n';
+}
+
+void VoltageViolationCollector::print(ostream &cout) const {
+    vector<VoltageViolation> violations;
+    worstViolations(int( _violations.size() ), violations);
+    for (int violationId = 0; violationId < violations.size(); violationId ++) {
+        print(cout, violations[violationId]);
+    }
+    if (_numberOfRecords > violations.size())
+        cout << _numberOfRecords - violations.size() << " less severe violations are not kept\n";
+}
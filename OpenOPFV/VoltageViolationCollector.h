@@ -0,0 +1,91 @@
+/***********************************************************************
+ * Copyright (c) 2014 Energy Adaptive Networks Corp. All rights reserved.
+ * This program and the accompanying materials are made available under
+ * the terms of the Eclipse Public License v2 or Energy Adaptive Networks
+ * Commercial License, which accompanies this distribution.
+ * Any use, reproduction or distribution of the program constitutes the
+ * recipient’s acceptance of this agreement.
+ * http://www.eclipse.org/legal/epl-v20.html
+ *
+ * Contributors:
+ *    Energy Adaptive Networks Corp. - dev API
+ *    Lingwen Gan - initial flow implementation
+ *    Peter Enescu - initial implementation, test, docs
+ *
+ * Project OpenOPFV - Optimal Power Flow Visualizer – 7/20/2019
+ * Module VoltageViolationCollector.h
+ *
+ ***********************************************************************/
+
+#ifndef __OptimalPowerFlowVisualization__VoltageViolationCollector__
+#define __OptimalPowerFlowVisualization__VoltageViolationCollector__
+
+#include "BasicDataType.h"
+
+class BusController;
+
+// a voltage magnitude outside of its range
+struct VoltageViolation {
+    const BusController *_bus;      // bus where the violation happens
+    int _phaseId;                   // phase index at the bus
+    int _timeSlotId;                // time slot index
+    double _voltageMagnitude;       // violating voltage magnitude
+    double _violationSize;          // distance from voltage magnitude to the range
+};
+
+class VoltageViolationCollector {
+public:
+    /******************************
+     member variables
+     ******************************/
+    int _capacity;                          // maximum number of violations kept
+    vector<VoltageViolation> _violations;   // the most severe violations, as a heap with the least severe in front
+    int _numberOfRecords;                   // number of violations recorded since last clear, including those not kept
+    ostream *_sink;                         // if not NULL, every recorded violation is printed here
+
+
+public:
+    /******************************
+     basic functions
+     ******************************/
+
+    // default constructor
+    VoltageViolationCollector(int capacity = 64);
+
+    // set the number of violations kept, and allocate the buffer
+    void setCapacity(int capacity);
+
+    // set the stream that recorded violations are printed to, NULL to print nothing
+    void setSink(ostream *sink);
+
+    // forget recorded violations, keeping the buffer
+    void clear();
+
+
+    /******************************
+     record and query
+     ******************************/
+
+    // record a violation of range [voltageMin, voltageMax]
+    // when the buffer is full, the least severe violation is dropped
+    void record(const BusController *bus, int phaseId, int timeSlotId,
+                double voltageMagnitude, double voltageMin, double voltageMax);
+
+    // true if nothing is recorded since last clear
+    bool empty() const;
+
+    // number of violations recorded since last clear
+    int numberOfRecords() const;
+
+    // the k most severe violations kept, most severe first
+    // result is resized but keeps its capacity, so it can be reused across calls
+    void worstViolations(int k, vector<VoltageViolation> &result) const;
+
+    // print a violation in the format of the sink
+    static void print(ostream &cout, const VoltageViolation &violation);
+
+    // print all violations kept, most severe first
+    void print(ostream &cout) const;
+};
+
+#endif /* defined(__OptimalPowerFlowVisualization__VoltageViolationCollector__) */